@@ -252,21 +252,22 @@ void inverse_kinematics(float* target, plan_line_data_t* pl_data, float* positio
     dx         = target[X_AXIS] - position[X_AXIS];
     dy         = target[Y_AXIS] - position[Y_AXIS];
     dz         = target[Z_AXIS] - position[Z_AXIS];
-    float dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
+    float dist = sqrtf((dx * dx) + (dy * dy) + (dz * dz));
 
+    memcpy(motors, target, sizeof(motors));  // Axes past Z are passed through
     motors[X_AXIS] = geometry_factor * target[X_AXIS] + target[Y_AXIS];
     motors[Y_AXIS] = geometry_factor * target[X_AXIS] - target[Y_AXIS];
-    motors[Z_AXIS] = target[Z_AXIS];
 
     float motor_distance = three_axis_dist(motors, last_motors);
 
-    if (!pl_data->motion.rapidMotion) {
+    if (!pl_data->motion.rapidMotion && dist > 0.0) {
         pl_data->feed_rate *= (motor_distance / dist);
     }
 
     memcpy(last_motors, motors, sizeof(motors));
 
     mc_line(motors, pl_data);
+    pl_data->feed_rate = feed_rate;  // the caller's feed rate is used for the next move
 }
 
 // motors -> cartesian
@@ -302,6 +303,6 @@ void user_m30() {}
 
 // Determine the unit distance between (2) 3D points
 float three_axis_dist(float* point1, float* point2) {
-    return sqrt(((point1[0] - point2[0]) * (point1[0] - point2[0])) + ((point1[1] - point2[1]) * (point1[1] - point2[1])) +
-                ((point1[2] - point2[2]) * (point1[2] - point2[2])));
+    return sqrtf(((point1[0] - point2[0]) * (point1[0] - point2[0])) + ((point1[1] - point2[1]) * (point1[1] - point2[1])) +
+                 ((point1[2] - point2[2]) * (point1[2] - point2[2])));
 }
@@ -85,6 +85,10 @@ bool user_defined_homing(uint8_t cycle_mask) {
     target = an N_AXIS array of target positions (where the move is supposed to go)
     pl_data = planner data (see the definition of this type to see what it is)
     position = an N_AXIS array of where the machine is starting from for this move
+
+  mc_kinematics_line() does the splitting and the feed rate for you, if you give
+  it a function that converts a batch of points. See CoreXY.cpp, parallel_delta.cpp
+  and polar_coaster.cpp.
 */
 void inverse_kinematics(float* target, plan_line_data_t* pl_data, float* position) {
     // this simply moves to the target. Replace with your kinematics.
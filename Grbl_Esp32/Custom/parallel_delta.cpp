@@ -85,7 +85,12 @@ float re;  // radius of end effector side (length of linkages)
 float f;   // sized of fixed side triangel
 float e;   // size of end effector side triangle
 
-static float last_angle[3]          = { 0.0, 0.0, 0.0 };  // A place to save the previous motor angles for distance/feed rate calcs
+// worked out from the geometry by read_settings() for delta_calcAngleYZ()
+static float delta_y1;       // -f/2 * tg 30
+static float delta_e_shift;  // e/2 * tg 30
+static float delta_k;        // rf^2 - re^2 - y1^2
+
+static float last_angle[MAX_N_AXIS] = { 0.0 };  // A place to save the previous motor angles for distance/feed rate calcs
 static float last_cartesian[N_AXIS] = {
     0.0, 0.0, 0.0
 };  // A place to save the previous motor angles for distance/feed rate calcs                             // Z offset of the effector from the arm centers
@@ -94,7 +99,6 @@ static float last_cartesian[N_AXIS] = {
 int            calc_forward_kinematics(float* angles, float* cartesian);
 KinematicError delta_calcInverse(float* cartesian, float* angles);
 KinematicError delta_calcAngleYZ(float x0, float y0, float z0, float& theta);
-float          three_axis_dist(float* point1, float* point2);
 void           read_settings();
 
 void machine_init() {
@@ -145,31 +149,33 @@ void inverse_kinematics(float* position) {
     position[2] = motor_angles[2];
 }
 
+// Converts points for mc_kinematics_line(), up to the first one out of reach
+static uint16_t inverse_kinematics_batch(float (*points)[MAX_N_AXIS], uint16_t count) {
+    float motor_angles[3];
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (delta_calcInverse(points[i], motor_angles) != KinematicError::NONE) {
+            return i;
+        }
+        points[i][X_AXIS] = motor_angles[0];
+        points[i][Y_AXIS] = motor_angles[1];
+        points[i][Z_AXIS] = motor_angles[2];
+    }
+    return count;
+}
+
 // This function is used by Grbl
 void inverse_kinematics(float* target, plan_line_data_t* pl_data, float* position)  //The target and position are provided in MPos
 {
-    float dx, dy, dz;  // distances in each cartesian axis
     float motor_angles[3];
 
-    float seg_target[3];                  // The target of the current segment
-    float feed_rate  = pl_data->feed_rate;  // save original feed rate
-    bool  show_error = true;                // shows error once
-
-    KinematicError status;
-
     read_settings();
 
     // grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Start %3.3f %3.3f %3.3f", position[0], position[1], position[2]);
     // grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Target %3.3f %3.3f %3.3f", target[0], target[1], target[2]);
 
-    status = delta_calcInverse(position, motor_angles);
-    if (status == KinematicError::OUT_OF_RANGE) {
-        //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Start position error %3.3f %3.3f %3.3f", position[0], position[1], position[2]);
-        //start_position_error = true;
-    }
-
     // Check the destination to see if it is in work area
-    status = delta_calcInverse(target, motor_angles);
+    KinematicError status = delta_calcInverse(target, motor_angles);
     if (status == KinematicError::OUT_OF_RANGE) {
         grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Target unreachable  error %3.3f %3.3f %3.3f", target[0], target[1], target[2]);
     }
@@ -178,53 +184,9 @@ void inverse_kinematics(float* target, plan_line_data_t* pl_data, float* positio
     position[Y_AXIS] += gc_state.coord_offset[Y_AXIS];
     position[Z_AXIS] += gc_state.coord_offset[Z_AXIS];
 
-    // calculate cartesian move distance for each axis
-    dx         = target[X_AXIS] - position[X_AXIS];
-    dy         = target[Y_AXIS] - position[Y_AXIS];
-    dz         = target[Z_AXIS] - position[Z_AXIS];
-    float dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
-
-    // determine the number of segments we need	... round up so there is at least 1 (except when dist is 0)
-    uint32_t segment_count = ceil(dist / kinematic_segment_len->get());
-
-    float segment_dist = dist / ((float)segment_count);  // distance of each segment...will be used for feedrate conversion
-
-    for (uint32_t segment = 1; segment <= segment_count; segment++) {
-        // determine this segment's target
-        seg_target[X_AXIS] = position[X_AXIS] + (dx / float(segment_count) * segment);
-        seg_target[Y_AXIS] = position[Y_AXIS] + (dy / float(segment_count) * segment);
-        seg_target[Z_AXIS] = position[Z_AXIS] + (dz / float(segment_count) * segment);
-
-        // calculate the delta motor angles
-        KinematicError status = delta_calcInverse(seg_target, motor_angles);
-
-        if (status == KinematicError ::NONE) {
-            float delta_distance = three_axis_dist(motor_angles, last_angle);
-
-            // save angles for next distance calc
-            memcpy(last_angle, motor_angles, sizeof(motor_angles));
-
-            if (pl_data->motion.rapidMotion) {
-                pl_data->feed_rate = feed_rate;
-            } else {
-                pl_data->feed_rate = (feed_rate * delta_distance / segment_dist);
-            }
-
-            mc_line(motor_angles, pl_data);
-
-        } else {
-            if (show_error) {
-                // grbl_msg_sendf(CLIENT_SERIAL,
-                //                MsgLevel::Info,
-                //                "Error:%d, Angs X:%4.3f Y:%4.3f Z:%4.3f",
-                //                status,
-                //                motor_angles[0],
-                //                motor_angles[1],
-                //                motor_angles[2]);
-                show_error = false;
-            }
-        }
-    }
+    // Segments that are out of reach are skipped
+    mc_kinematics_t kins = { inverse_kinematics_batch, kinematic_segment_len->get(), 0.0, last_angle };
+    mc_kinematics_line(target, pl_data, position, &kins);
 }
 
 // this is used used by Grbl soft limits to see if the range of the machine is exceeded.
@@ -331,19 +293,20 @@ int calc_forward_kinematics(float* angles, float* catesian) {
 }
 // helper functions, calculates angle theta1 (for YZ-pane)
 KinematicError delta_calcAngleYZ(float x0, float y0, float z0, float& theta) {
-    float y1 = -0.5 * 0.57735 * f;  // f/2 * tg 30
-    y0 -= 0.5 * 0.57735 * e;        // shift center to edge
+    float y1 = delta_y1;
+    y0 -= delta_e_shift;  // shift center to edge
     // z = a + b*y
-    float a = (x0 * x0 + y0 * y0 + z0 * z0 + rf * rf - re * re - y1 * y1) / (2 * z0);
-    float b = (y1 - y0) / z0;
+    float inv_z0 = 1.0f / z0;
+    float a      = (x0 * x0 + y0 * y0 + z0 * z0 + delta_k) * 0.5f * inv_z0;
+    float b      = (y1 - y0) * inv_z0;
     // discriminant
     float d = -(a + b * y1) * (a + b * y1) + rf * (b * b * rf + rf);
     if (d < 0)
-        return KinematicError::OUT_OF_RANGE;          // non-existing point
-    float yj = (y1 - a * b - sqrt(d)) / (b * b + 1);  // choosing outer point
+        return KinematicError::OUT_OF_RANGE;           // non-existing point
+    float yj = (y1 - a * b - sqrtf(d)) / (b * b + 1);  // choosing outer point
     float zj = a + b * yj;
     //theta    = 180.0 * atan(-zj / (y1 - yj)) / M_PI + ((yj > y1) ? 180.0 : 0.0);
-    theta = atan(-zj / (y1 - yj)) + ((yj > y1) ? M_PI : 0.0);
+    theta = atanf(-zj / (y1 - yj)) + ((yj > y1) ? (float)M_PI : 0.0f);
 
     if (theta < MAX_NEGATIVE_ANGLE) {
         return KinematicError::ANGLE_TOO_NEGATIVE;
@@ -356,11 +319,6 @@ KinematicError delta_calcAngleYZ(float x0, float y0, float z0, float& theta) {
     return KinematicError::NONE;
 }
 
-// Determine the unit distance between (2) 3D points
-float three_axis_dist(float* point1, float* point2) {
-    return sqrt(((point1[0] - point2[0]) * (point1[0] - point2[0])) + ((point1[1] - point2[1]) * (point1[1] - point2[1])) +
-                ((point1[2] - point2[2]) * (point1[2] - point2[2])));
-}
 // called by reporting for WPos status
 void forward_kinematics(float* position) {
     float calc_fwd[N_AXIS];
@@ -369,8 +327,8 @@ void forward_kinematics(float* position) {
     read_settings();
 
     // convert the system position in steps to radians
-    float   position_radians[N_AXIS];
-    int32_t position_steps[N_AXIS];  // Copy current state of the system position variable
+    float   position_radians[MAX_N_AXIS];
+    int32_t position_steps[MAX_N_AXIS];  // Copy current state of the system position variable
     memcpy(position_steps, sys_position, sizeof(sys_position));
     system_convert_array_steps_to_mpos(position_radians, position_steps);
 
@@ -437,9 +395,21 @@ void kinematics_post_homing() {
 
 void user_m30() {}
 
+// Reads the geometry settings, and works out what delta_calcAngleYZ() needs from them when they change.
 void read_settings() {
-    rf = delta_crank_len->get();          // radius of the fixed side (length of motor cranks)
-    re = delta_link_len->get();           // radius of end effector side (length of linkages)
-    f  = delta_crank_side_len->get();     // sized of fixed side triangel
-    e  = delta_effector_side_len->get();  // size of end effector side triangle
+    float crank_len         = delta_crank_len->get();
+    float link_len          = delta_link_len->get();
+    float crank_side_len    = delta_crank_side_len->get();
+    float effector_side_len = delta_effector_side_len->get();
+    if (crank_len == rf && link_len == re && crank_side_len == f && effector_side_len == e) {
+        return;
+    }
+    rf = crank_len;          // radius of the fixed side (length of motor cranks)
+    re = link_len;           // radius of end effector side (length of linkages)
+    f  = crank_side_len;     // sized of fixed side triangel
+    e  = effector_side_len;  // size of end effector side triangle
+
+    delta_y1      = -0.5 * 0.57735 * f;
+    delta_e_shift = 0.5 * 0.57735 * e;
+    delta_k       = rf * rf - re * re - delta_y1 * delta_y1;
 }
@@ -57,8 +57,7 @@
 void  calc_polar(float* target_xyz, float* polar, float last_angle);
 float abs_angle(float ang);
 
-static float last_angle  = 0;
-static float last_radius = 0;
+static float last_motors[MAX_N_AXIS] = {};  // the last point planned, for the feed rate and the polar angle counted past 360
 
 // this get called before homing
 // return false to complete normal home
@@ -69,9 +68,30 @@ bool kinematics_pre_homing(uint8_t cycle_mask) {
 
 void kinematics_post_homing() {
     // sync the X axis (do not need sync but make it for the fail safe)
-    last_radius = sys_position[X_AXIS];
+    last_motors[RADIUS_AXIS] = sys_position[X_AXIS];
     // reset the internal angle value
-    last_angle = 0;
+    last_motors[POLAR_AXIS] = 0;
+}
+
+// Converts points for mc_kinematics_line(). The X and Z offsets are taken off for the conversion
+// and put back on the radius and Z. Each angle follows on from the one before it, starting from the
+// last point planned, so points converted but not planned leave nothing behind.
+static uint16_t inverse_kinematics_batch(float (*points)[MAX_N_AXIS], uint16_t count) {
+    float polar[MAX_N_AXIS];  // target location in polar coordinates
+    float last_angle = last_motors[POLAR_AXIS];
+    float x_offset   = gc_state.coord_system[X_AXIS] + gc_state.coord_offset[X_AXIS];  // offset from machine coordinate system
+    float z_offset   = gc_state.coord_system[Z_AXIS] + gc_state.coord_offset[Z_AXIS];  // offset from machine coordinate system
+
+    for (uint16_t i = 0; i < count; i++) {
+        points[i][X_AXIS] -= x_offset;
+        points[i][Z_AXIS] -= z_offset;
+        calc_polar(points[i], polar, last_angle);
+        last_angle             = polar[POLAR_AXIS];
+        points[i][RADIUS_AXIS] = polar[RADIUS_AXIS] + x_offset;
+        points[i][POLAR_AXIS]  = polar[POLAR_AXIS];
+        points[i][Z_AXIS]      = polar[Z_AXIS] + z_offset;
+    }
+    return count;
 }
 
 /*
@@ -86,64 +106,13 @@ void kinematics_post_homing() {
 
 */
 void inverse_kinematics(float* target, plan_line_data_t* pl_data, float* position) {
-    //static float last_angle = 0;
-    //static float last_radius = 0;
-    float    dx, dy, dz;          // distances in each cartesian axis
-    float    p_dx, p_dy, p_dz;    // distances in each polar axis
-    float    dist, polar_dist;    // the distances in both systems...used to determine feed rate
-    uint32_t segment_count;       // number of segments the move will be broken in to.
-    float    seg_target[N_AXIS];  // The target of the current segment
-    float    polar[N_AXIS];       // target location in polar coordinates
-    float    x_offset = gc_state.coord_system[X_AXIS] + gc_state.coord_offset[X_AXIS];  // offset from machine coordinate system
-    float    z_offset = gc_state.coord_system[Z_AXIS] + gc_state.coord_offset[Z_AXIS];  // offset from machine coordinate system
-    //grbl_sendf(CLIENT_SERIAL, "Position: %4.2f %4.2f %4.2f \r\n", position[X_AXIS] - x_offset, position[Y_AXIS], position[Z_AXIS]);
-    //grbl_sendf(CLIENT_SERIAL, "Target: %4.2f %4.2f %4.2f \r\n", target[X_AXIS] - x_offset, target[Y_AXIS], target[Z_AXIS]);
-    // calculate cartesian move distance for each axis
-    dx = target[X_AXIS] - position[X_AXIS];
-    dy = target[Y_AXIS] - position[Y_AXIS];
-    dz = target[Z_AXIS] - position[Z_AXIS];
-    // calculate the total X,Y axis move distance
-    // Z axis is the same in both coord systems, so it is ignored
-    dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
-    if (pl_data->motion.rapidMotion) {
-        segment_count = 1;  // rapid G0 motion is not used to draw, so skip the segmentation
-    } else {
-        segment_count = ceil(dist / SEGMENT_LENGTH);  // determine the number of segments we need	... round up so there is at least 1
-    }
-    dist /= segment_count;  // segment distance
-    for (uint32_t segment = 1; segment <= segment_count; segment++) {
-        // determine this segment's target
-        seg_target[X_AXIS] = position[X_AXIS] + (dx / float(segment_count) * segment) - x_offset;
-        seg_target[Y_AXIS] = position[Y_AXIS] + (dy / float(segment_count) * segment);
-        seg_target[Z_AXIS] = position[Z_AXIS] + (dz / float(segment_count) * segment) - z_offset;
-        calc_polar(seg_target, polar, last_angle);
-        // begin determining new feed rate
-        // calculate move distance for each axis
-        p_dx                      = polar[RADIUS_AXIS] - last_radius;
-        p_dy                      = polar[POLAR_AXIS] - last_angle;
-        p_dz                      = dz;
-        polar_dist                = sqrt((p_dx * p_dx) + (p_dy * p_dy) + (p_dz * p_dz));  // calculate the total move distance
-        float polar_rate_multiply = 1.0;                                                  // fail safe rate
-        if (polar_dist == 0 || dist == 0) {
-            // prevent 0 feed rate and division by 0
-            polar_rate_multiply = 1.0;  // default to same feed rate
-        } else {
-            // calc a feed rate multiplier
-            polar_rate_multiply = polar_dist / dist;
-            if (polar_rate_multiply < 0.5) {
-                // prevent much slower speed
-                polar_rate_multiply = 0.5;
-            }
-        }
-        pl_data->feed_rate *= polar_rate_multiply;  // apply the distance ratio between coord systems
-        // end determining new feed rate
-        polar[RADIUS_AXIS] += x_offset;
-        polar[Z_AXIS] += z_offset;
-        last_radius = polar[RADIUS_AXIS];
-        last_angle  = polar[POLAR_AXIS];
-        mc_line(polar, pl_data);
-    }
-    // TO DO don't need a feedrate for rapids
+    mc_kinematics_t kins;
+    kins.inverse = inverse_kinematics_batch;
+    // rapid G0 motion is not used to draw, so skip the segmentation
+    kins.segment_length = pl_data->motion.rapidMotion ? 0.0 : SEGMENT_LENGTH;
+    kins.min_feed_scale = 0.5;  // prevent much slower speed
+    kins.last_motors    = last_motors;
+    mc_kinematics_line(target, pl_data, position, &kins);
 }
 
 /*
@@ -161,8 +130,8 @@ converted = position with forward kinematics applied.
 */
 void forward_kinematics(float* position) {
     float   original_position[N_AXIS];  // temporary storage of original
-    float   print_position[N_AXIS];
-    int32_t current_position[N_AXIS];  // Copy current state of the system position variable
+    float   print_position[MAX_N_AXIS];
+    int32_t current_position[MAX_N_AXIS];  // Copy current state of the system position variable
     memcpy(current_position, sys_position, sizeof(sys_position));
     system_convert_array_steps_to_mpos(print_position, current_position);
     original_position[X_AXIS] = print_position[X_AXIS] - gc_state.coord_system[X_AXIS] + gc_state.coord_offset[X_AXIS];
@@ -194,30 +163,27 @@ void calc_polar(float* target_xyz, float* polar, float last_angle) {
     if (polar[RADIUS_AXIS] == 0) {
         polar[POLAR_AXIS] = last_angle;  // don't care about angle at center
     } else {
-        polar[POLAR_AXIS] = atan2(target_xyz[Y_AXIS], target_xyz[X_AXIS]) * 180.0 / M_PI;
+        polar[POLAR_AXIS] = atan2f(target_xyz[Y_AXIS], target_xyz[X_AXIS]) * (float)(180.0 / M_PI);
         // no negative angles...we want the absolute angle not -90, use 270
         polar[POLAR_AXIS] = abs_angle(polar[POLAR_AXIS]);
     }
     polar[Z_AXIS] = target_xyz[Z_AXIS];  // Z is unchanged
     delta_ang     = polar[POLAR_AXIS] - abs_angle(last_angle);
     // if the delta is above 180 degrees it means we are crossing the 0 degree line
-    if (fabs(delta_ang) <= 180.0)
+    if (fabsf(delta_ang) <= 180.0f)
         polar[POLAR_AXIS] = last_angle + delta_ang;
     else {
-        if (delta_ang > 0.0) {
+        if (delta_ang > 0.0f) {
             // crossing zero counter clockwise
-            polar[POLAR_AXIS] = last_angle - (360.0 - delta_ang);
+            polar[POLAR_AXIS] = last_angle - (360.0f - delta_ang);
         } else
-            polar[POLAR_AXIS] = last_angle + delta_ang + 360.0;
+            polar[POLAR_AXIS] = last_angle + delta_ang + 360.0f;
     }
 }
 
 // Return a 0-360 angle ... fix above 360 and below zero
 float abs_angle(float ang) {
-    ang = fmod(ang, 360.0);  // 0-360 or 0 to -360
-    if (ang < 0.0)
-        ang = 360.0 + ang;
-    return ang;
+    return ang - 360.0f * floorf(ang / 360.0f);  // 0-360, below zero too
 }
 
 // Polar coaster has macro buttons, this handles those button pushes.
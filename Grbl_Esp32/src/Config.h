@@ -131,6 +131,25 @@ const int MAX_N_AXIS = 6;
 //#define ENABLE_AUTHENTICATION
 //CONFIGURE_EYECATCH_END (DO NOT MODIFY THIS LINE)
 
+// The host simulator (see sim/ at the top of the repo) compiles the motion core
+// for Linux. It has no radios, no SD card and no web services.
+#ifdef GRBL_SIM
+#    undef ENABLE_BLUETOOTH
+#    undef ENABLE_SD_CARD
+#    undef ENABLE_WIFI
+#    undef WIFI_OR_BLUETOOTH
+#    undef ENABLE_HTTP
+#    undef ENABLE_OTA
+#    undef ENABLE_TELNET
+#    undef ENABLE_TELNET_WELCOME_MSG
+#    undef ENABLE_MDNS
+#    undef ENABLE_SSDP
+#    undef ENABLE_NOTIFICATIONS
+#    undef ENABLE_SERIAL2SOCKET_IN
+#    undef ENABLE_SERIAL2SOCKET_OUT
+#    undef ENABLE_CAPTIVE_PORTAL
+#endif
+
 #ifdef ENABLE_AUTHENTICATION
 const char* const DEFAULT_ADMIN_PWD   = "admin";
 const char* const DEFAULT_USER_PWD    = "user";
@@ -353,6 +372,13 @@ const int REPORT_OVR_REFRESH_IDLE_COUNT = 10;  // (1-255) Must be less than or e
 const int REPORT_WCO_REFRESH_BUSY_COUNT = 30;  // (2-255)
 const int REPORT_WCO_REFRESH_IDLE_COUNT = 10;  // (2-255) Must be less than or equal to the busy count
 
+// Instead of polling '?' and parsing status reports, a client can ask for compact binary telemetry
+// frames pushed at a fixed rate, up to 100Hz. $TM=ms starts them for the client that sends it, $TM=ms,C
+// only sends a frame when something in it changed (or once a second), and $TM=0 stops them. The frames
+// go out between text messages on the same connection; see Telemetry.h for their format and for the
+// clients and rates that keep up.
+#define ENABLE_TELEMETRY  // Default enabled. Comment to disable.
+
 // The temporal resolution of the acceleration management subsystem. A higher number gives smoother
 // acceleration, particularly noticeable on machines that run at very high feedrates, but may negatively
 // impact performance. The correct value for this parameter is machine dependent, so it's advised to
@@ -436,6 +462,30 @@ const int N_ARC_CORRECTION = 12;  // Integer (1-255)
 // much greater than this. The default setting should capture most, if not all, full arc error situations.
 const double ARC_ANGULAR_TRAVEL_EPSILON = 5E-7;  // Float (radians)
 
+// Plans each G2/G3 arc as a single block and has segment prep step along the circle itself, instead
+// of breaking the arc into arc_tolerance chords that each take a planner block. Large arcs then leave
+// the look-ahead buffer to the moves around them, and their speed is capped once for centripetal
+// acceleration. Step segments are shortened where needed to keep within arc_tolerance. Arcs that
+// also move axes outside their plane, and machines with kinematics, still use chords.
+// NOTE: An arc runs at the rate and acceleration of the axis that limits it most anywhere on its
+// sweep, where each chord was limited by its own direction. Arcs fed faster than an axis' $11x max
+// rate therefore run slower than as chords: in the simulator, arcs_arrows.nc takes 990 s instead of
+// 944 s, and a full circle of radius 50 at F3000 takes 22.0 s instead of 20.1 s.
+// #define PLANNER_NATIVE_ARCS  // Default disabled. Uncomment to enable.
+
+// Joins runs of G1 moves into one planner block each, where every vertex lies within
+// $GCode/PathTolerance of a single line or, with PLANNER_NATIVE_ARCS, a single arc. CAM output made
+// of dense polylines then fills the planner with far fewer blocks and slows down at far fewer
+// junctions. Up to PATH_SMOOTHING_MOVES moves wait in MotionControl for the next one to decide;
+// anything else that moves or waits for motion sends them on first. When input stops, they wait
+// PATH_SMOOTHING_HOLD_MS for the next line, enough for a sender that waits for each "ok" over USB,
+// unless the planner is down to its last block. Senders slower than that, or slower than the moves
+// they send, get no joining. A tolerance of 0, the default, turns it off, and machines
+// with kinematics do not use it. $PT reports how many blocks it saved.
+#define PATH_SMOOTHING  // Default enabled. Comment to disable.
+// #define PATH_SMOOTHING_MOVES 16  // Uncomment to override default in MotionControl.h
+// #define PATH_SMOOTHING_HOLD_MS 20  // Uncomment to override default in MotionControl.h
+
 // Time delay increments performed during a dwell. The default value is set at 50ms, which provides
 // a maximum time delay of roughly 55 minutes, more than enough for most any application. Increasing
 // this delay will increase the maximum dwell time linearly, but also reduces the responsiveness of
@@ -463,20 +513,68 @@ const int DWELL_TIME_STEP = 50;  // Integer (1-255) (milliseconds)
 // must use #define USE_RMT_STEPS for this to work
 //#define STEP_PULSE_DELAY 10 // Step pulse delay in microseconds. Default disabled.
 
+// Step pins on plain GPIOs and RMT channels are switched together by direct register writes,
+// using masks built at startup. Other motor types are stepped one at a time through their
+// step() and unstep() methods. Uncomment to step every motor the slow way, e.g. to compare the
+// CPU cycles per step reported by $Motors/StepTime with STEPPER_ISR_STATS.
+// #define DISABLE_STEP_PIN_MASKS // Default disabled. Uncomment to enable.
+
+// Times every step timer interrupt with the CPU cycle counter. $ISR reports the minimum, average
+// and maximum time, a histogram, how often an ISR ran longer than the step period after it, and
+// how often the segment buffer ran dry mid-motion. $ISR=R starts over. REPORT_FIELD_ISR_STATS adds
+// the average, maximum, missed and underrun counts to status reports as |Isr:. I2S streaming
+// steps from a callback instead of the timer interrupt and is not timed. $Motors/StepTime reports
+// the cycles spent in motors_step() and motors_unstep() alone. Compiled out when disabled.
+// #define STEPPER_ISR_STATS // Default disabled. Uncomment to enable.
+// #define REPORT_FIELD_ISR_STATS // Default disabled. Uncomment to enable.
+
+// Times realtime commands from the moment they are taken in to the moment they take effect: feed
+// hold, safety door and jog cancel to protocol_exec_rt_system(), to the first decelerating segment
+// queued by segment prep and to the stepper ISR starting that segment, and cycle start and reset to
+// protocol_exec_rt_system(). $RT reports a histogram for each, and $RT=R starts over.
+// #define REALTIME_LATENCY_STATS // Default disabled. Uncomment to enable.
+
 // The number of linear motions in the planner buffer to be planned at any give time. The vast
 // majority of RAM that Grbl uses is based on this buffer size. Only increase if there is extra
 // available RAM, like when re-compiling for a Mega2560. Or decrease if the Arduino begins to
 // crash due to the lack of available RAM or if the CPU is having trouble keeping up with planning
 // new incoming motions as they are executed.
+// On the ESP32 the buffer can hold hundreds of blocks, which gives files made of very short
+// segments enough look-ahead to keep up speed. Buffers of 64 blocks or more are placed in PSRAM
+// on boards that have it. Each block takes about 100 bytes.
 // #define BLOCK_BUFFER_SIZE 16 // Uncomment to override default in planner.h.
 
+// With a deep planner buffer, the reverse pass of the planner can take long enough per new block
+// to starve the step segment buffer. This limits how many blocks it visits per new block. The
+// rest of the pass is resumed by the next new blocks, as many blocks at a time, and finished when
+// the main loop is idle; $Planner/Stats shows how often.
+// #define PLANNER_REVERSE_PASS_LIMIT 64 // Uncomment to override default (whole buffer, up to 64) in planner.h.
+
 // Governs the size of the intermediary step segment buffer between the step execution algorithm
 // and the planner blocks. Each segment is set of steps executed at a constant velocity over a
 // fixed time defined by ACCELERATION_TICKS_PER_SECOND. They are computed such that the planner
 // block velocity profile is traced exactly. The size of this buffer governs how much step
 // execution lead time there is for other Grbl processes have to compute and do their thing
 // before having to come back and refill this buffer, currently at ~50msec of step moves.
+// $Stepper/SegmentBuffer sets the size at run time, up to SEGMENT_BUFFER_MAX, and $SB reports
+// how often the buffer ran dry in the middle of a motion.
 // #define SEGMENT_BUFFER_SIZE 6 // Uncomment to override default in stepper.h.
+// #define SEGMENT_BUFFER_MAX 128 // Uncomment to override default in stepper.h.
+
+// Does the step segment ramp math in single precision. The ESP32 FPU has no double precision,
+// so by default some of the math in st_prep_buffer() runs in software. Every step is still taken,
+// but rounding in the ramps builds up, so step timing can drift: in the sim's bench-prep, steps in
+// raster_tree.nc land up to 14.4 ms from where they do in double precision (over 4660 s of motion),
+// and in arcs_arrows.nc up to 3.2 us.
+// #define STEPPER_SINGLE_PRECISION_PREP // Default disabled. Uncomment to enable.
+
+// Refills the step segment buffer from a task of its own, pinned to the core that runs the main
+// loop at a higher priority. The stepper ISR wakes it when the buffer has drained to half its
+// depth, so a slow parse, settings write or report no longer starves the steppers. The main loop
+// still tops the buffer up as before. When disabled, segments are only prepped from the main loop.
+// NOTE: The host simulator never runs the task, so only the main loop's prep is covered there.
+// Try it on your machine with feed holds, overrides and jogging before relying on it.
+// #define SEGMENT_PREP_TASK  // Default disabled. Uncomment to enable.
 
 // Line buffer size from the serial input stream to be executed. Also, governs the size of
 // each of the startup blocks, as they are each stored as a string of this size.
@@ -485,6 +583,20 @@ const int DWELL_TIME_STEP = 50;  // Integer (1-255) (milliseconds)
 // support up to 256 characters.
 // #define LINE_BUFFER_SIZE 80  // Uncomment to override default in protocol.h
 
+// While a g-code line waits for room in the planner, the lines that follow it from the same
+// client are read, stripped of comments and split into words, so that parsing overlaps motion.
+// This sets how many such lines can wait. Each takes about 330 bytes of RAM.
+// #define PARSER_LOOKAHEAD_LINES 8  // Uncomment to override default in protocol.h
+
+// The main loop serves the clients in the order of CLIENT_PRIORITY, one turn each. While another
+// client or an SD card job has input waiting, a turn ends after the client's quota of lines, so
+// that a streaming client cannot starve the others. A lone client is never cut short.
+// By default a sender on Serial or Telnet goes first and the WebUI console gets a smaller quota.
+// $CS reports the lines per second of each client, the turns cut short by the quota and how long
+// input waited for a turn. Quotas are in client number order: Serial, BT, WebUI, Telnet, Input.
+// #define CLIENT_PRIORITY { CLIENT_SERIAL, CLIENT_TELNET, CLIENT_BT, CLIENT_WEBUI, CLIENT_INPUT }  // Uncomment to override
+// #define CLIENT_LINE_QUOTA { 32, 32, 8, 32, 32 }  // Uncomment to override
+
 // Serial send and receive buffer size. The receive buffer is often used as another streaming
 // buffer to store incoming blocks to be processed by Grbl when its ready. Most streaming
 // interfaces will character count and track each block send to each block response. So,
@@ -495,8 +607,41 @@ const int DWELL_TIME_STEP = 50;  // Integer (1-255) (milliseconds)
 // 115200 baud will take 5 msec to transmit a typical 55 character report. Worst case reports are
 // around 90-100 characters. As long as the serial TX buffer doesn't get continually maxed, Grbl
 // will continue operating efficiently. Size the TX buffer around the size of a worst-case report.
-// #define RX_BUFFER_SIZE 128 // (1-254) Uncomment to override defaults in serial.h
-// #define TX_BUFFER_SIZE 100 // (1-254)
+// #define RX_BUFFER_SIZE 128 // (power of 2) Uncomment to override defaults in serial.h
+// #define TX_BUFFER_SIZE 1024 // (power of 2) Uncomment to override defaults in serial.h
+
+// Output to each client is queued in a TX ring of TX_BUFFER_SIZE bytes, and serialTxTask writes it
+// to the transport, so the protocol loop does not wait for a slow telnet peer, a Bluetooth link or
+// the UART. What piles up while a transport is busy goes out in one write.
+// When a ring is full, clients in CLIENT_TX_DROP lose whole messages, which suits consoles that
+// only watch. The others wait for room, unless their transport has made no progress for
+// TX_STALL_MS, in which case they drop too until their ring has emptied. Replies to realtime
+// commands, such as status reports, are dropped rather than wait, so that serialCheckTask keeps
+// reading realtime commands.
+// NOTE: The host simulator writes queued output at once instead of running serialTxTask, so
+// the task itself is untested there. Without it, output is written by whoever sends it.
+// #define SERIAL_TX_TASK  // Default disabled. Uncomment to enable.
+// #define CLIENT_TX_DROP (1 << CLIENT_WEBUI)  // Uncomment to override default in serial.h
+
+// Output to the WebUI goes out as a websocket frame when SERIAL2SOCKET_FLUSH_POLICY says so, when
+// SERIAL2SOCKET_FLUSH_BYTES of it are waiting, or when it has waited SERIAL2SOCKET_FLUSH_MS.
+// Newline sends every message as it comes, for the lowest latency. Status and Size trade latency
+// for fewer, larger frames; keep SERIAL2SOCKET_FLUSH_BYTES below TX_BUFFER_SIZE with them. With
+// SERIAL_TX_TASK the frames are sent straight from the TX ring, without another copy, unless the
+// output wraps around its end. Telemetry frames go out at once, whatever the policy.
+// #define SERIAL2SOCKET_FLUSH_POLICY WebUI::SocketFlush::Newline  // Uncomment to override default in Serial2Socket.h
+// #define SERIAL2SOCKET_FLUSH_MS 50  // Uncomment to override default in Serial2Socket.h
+// #define SERIAL2SOCKET_FLUSH_BYTES 512  // Uncomment to override default in Serial2Socket.h
+
+// Wakes serialCheckTask as soon as a client that can signal new data has some, instead of leaving
+// it for the next poll a tick later. Bluetooth, telnet and the WebUI signal; the UART cannot with
+// the Arduino core's HardwareSerial, so it is still polled every tick. The task reads clients one
+// priority above the main loop so that a wake-up takes effect at once, and realtime commands from
+// those clients are acted on without waiting for the main loop's time slice to end. It drops to the
+// main loop's priority to run the WebUI, WiFi and Bluetooth handlers, which can run long.
+// NOTE: The radios are compiled out of the host simulator, so it does not cover these wake-ups.
+// Without it, serialCheckTask polls every client once per tick as before.
+// #define SERIAL_EVENT_WAKE  // Default disabled. Uncomment to enable.
 
 // A simple software debouncing feature for hard limit switches. When enabled, the limit
 // switch interrupt unblock a waiting task which will recheck the limit switch pins after
@@ -82,6 +82,10 @@
 #    define DEFAULT_ARC_TOLERANCE 0.002  // $12 mm
 #endif
 
+#ifndef DEFAULT_PATH_TOLERANCE
+#    define DEFAULT_PATH_TOLERANCE 0.0  // $GCode/PathTolerance mm, 0 is off
+#endif
+
 #ifndef DEFAULT_REPORT_INCHES
 #    define DEFAULT_REPORT_INCHES 0  // $13 false
 #endif
@@ -304,6 +308,31 @@
 #    define DEFAULT_C_ACCELERATION 200.0
 #endif
 
+// ============== Axis Jerk =========
+#define SEC_PER_MIN_CU (60.0 * 60.0 * 60.0)  // Seconds Per Minute Cubed, for jerk conversion
+// Default jerks are expressed in mm/sec^3. Zero keeps acceleration ramps linear.
+// Every ramp starts and ends at zero acceleration within its own block, so paths
+// of many very short moves run slower with a jerk limit; path smoothing
+// ($GCode/PathTolerance) joins such moves into longer ones.
+#ifndef DEFAULT_X_JERK
+#    define DEFAULT_X_JERK 0.0
+#endif
+#ifndef DEFAULT_Y_JERK
+#    define DEFAULT_Y_JERK 0.0
+#endif
+#ifndef DEFAULT_Z_JERK
+#    define DEFAULT_Z_JERK 0.0
+#endif
+#ifndef DEFAULT_A_JERK
+#    define DEFAULT_A_JERK 0.0
+#endif
+#ifndef DEFAULT_B_JERK
+#    define DEFAULT_B_JERK 0.0
+#endif
+#ifndef DEFAULT_C_JERK
+#    define DEFAULT_C_JERK 0.0
+#endif
+
 // ========= AXIS MAX TRAVEL ============
 
 #ifndef DEFAULT_X_MAX_TRAVEL
@@ -109,19 +109,115 @@ void collapseGCode(char* line) {
     *outPtr = '\0';
 }
 
-// Executes one line of NUL-terminated G-Code.
+// Reads the words of a packed line. See GC_PACKED_LINE.
+static void unpack_line(const char* line, gc_tokens_t* tokens) {
+    uint8_t char_counter = 1;  // Skip GC_PACKED_LINE
+    while (line[char_counter] != 0) {
+        char letter = line[char_counter++];
+        if (letter < 'A' || letter > 'Z') {
+            tokens->status = Error::ExpectedCommandLetter;
+            return;
+        }
+        bool isnegative = line[char_counter] == '-';
+        if (isnegative) {
+            char_counter++;
+        }
+        int16_t places = 0;
+        while (line[char_counter] >= 'w' && line[char_counter] <= 'z') {
+            places += line[char_counter++] - 'w' + 1;
+        }
+        uint32_t intval = 0;
+        uint8_t  ndigit = 0;
+        while (1) {
+            char c = line[char_counter];
+            if (c >= '0' && c <= '9') {
+                c -= '0';
+            } else if (c >= 'a' && c <= 'v') {
+                c -= 'a' - 10;
+            } else {
+                break;
+            }
+            intval = (intval << 5) | c;
+            ndigit++;
+            char_counter++;
+        }
+        // read_float() keeps at most MAX_INT_DIGITS decimal digits, which fit in 6 base 32 digits.
+        if (ndigit == 0 || ndigit > 6 || places > MAX_INT_DIGITS) {
+            tokens->status = Error::BadNumberFormat;
+            return;
+        }
+        if (tokens->n_words == GC_MAX_WORDS) {
+            tokens->status = Error::Overflow;
+            return;
+        }
+        float value                           = decimal_to_float(intval, -places);
+        tokens->words[tokens->n_words].letter = letter;
+        tokens->words[tokens->n_words].value  = isnegative ? -value : value;
+        tokens->n_words++;
+    }
+}
+
+// Splits one line of NUL-terminated G-Code into its words, without interpreting them.
 // The line may contain whitespace and comments, which are first removed,
 // and lower case characters, which are converted to upper case.
-// In this function, all units and positions are converted and
-// exported to grbl's internal functions in terms of (mm, mm/min) and absolute machine
-// coordinates, respectively.
-Error gc_execute_line(char* line, uint8_t client) {
+// This does not depend on the parser state, so it can run ahead of execution.
+// A malformed word ends the line; the error is kept in tokens->status and returned
+// by gc_execute_tokens() once the words before it have been checked, as a single
+// pass over the line would. Packed lines are decoded instead.
+void gc_tokenize_line(char* line, uint8_t client, gc_tokens_t* tokens) {
+    tokens->n_words = 0;
+    tokens->status  = Error::Ok;
+    tokens->jog     = false;
+    if (line[0] == GC_PACKED_LINE) {
+#ifdef REPORT_ECHO_LINE_RECEIVED
+        report_echo_line_received(line, client);
+#endif
+        unpack_line(line, tokens);
+        return;
+    }
     // Step 0 - remove whitespace and comments and convert to upper case
     collapseGCode(line);
 #ifdef REPORT_ECHO_LINE_RECEIVED
     report_echo_line_received(line, client);
 #endif
+    tokens->jog = line[0] == '$';  // NOTE: `$J=` already parsed when passed to this function.
+
+    uint8_t char_counter = tokens->jog ? 3 : 0;  // Start parsing after `$J=`
+    while (line[char_counter] != 0) {
+        // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
+        char letter = line[char_counter];
+        if ((letter < 'A') || (letter > 'Z')) {
+            tokens->status = Error::ExpectedCommandLetter;  // [Expected word letter]
+            return;
+        }
+        char_counter++;
+        float value;
+        if (!read_float(line, &char_counter, &value)) {
+            tokens->status = Error::BadNumberFormat;  // [Expected word value]
+            return;
+        }
+        if (tokens->n_words == GC_MAX_WORDS) {
+            tokens->status = Error::Overflow;  // Repeats or modal group violations, whatever the words
+            return;
+        }
+        tokens->words[tokens->n_words].letter = letter;
+        tokens->words[tokens->n_words].value  = value;
+        tokens->n_words++;
+    }
+}
 
+// Executes one line of NUL-terminated G-Code.
+Error gc_execute_line(char* line, uint8_t client) {
+    gc_tokens_t tokens;  // On the stack, as settings and WebUI commands call this from other tasks
+    gc_tokenize_line(line, client, &tokens);
+    return gc_execute_tokens(&tokens, client);
+}
+
+// Executes the words of one line, as read by gc_tokenize_line().
+// In this function, all units and positions are converted and
+// exported to grbl's internal functions in terms of (mm, mm/min) and absolute machine
+// coordinates, respectively.
+Error gc_execute_tokens(const gc_tokens_t* tokens, uint8_t client) {
     /* -------------------------------------------------------------------------------------
        STEP 1: Initialize parser block struct and copy current g-code state modes. The parser
        updates these modes and commands as the block line is parser and will only be used and
@@ -145,7 +241,7 @@ Error gc_execute_line(char* line, uint8_t client) {
     uint8_t  pValue;                  // Integer value of P word
 
     // Determine if the line is a jogging motion or a normal g-code block.
-    if (line[0] == '$') {  // NOTE: `$J=` already parsed when passed to this function.
+    if (tokens->jog) {
         // Set G1 and G94 enforced modes to ensure accurate error checks.
         gc_parser_flags |= GCParserJogMotion;
         gc_block.modal.motion    = Motion::Linear;
@@ -162,26 +258,13 @@ Error gc_execute_line(char* line, uint8_t client) {
        words, and for negative values set for the value words F, N, P, T, and S. */
     ModalGroup mg_word_bit;  // Bit-value for assigning tracking variables
     uint32_t   bitmask = 0;
-    uint8_t    char_counter;
     char       letter;
     float      value;
     uint8_t    int_value = 0;
     uint16_t   mantissa  = 0;
-    if (gc_parser_flags & GCParserJogMotion) {
-        char_counter = 3;  // Start parsing after `$J=`
-    } else {
-        char_counter = 0;
-    }
-    while (line[char_counter] != 0) {  // Loop until no more g-code words in line.
-        // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
-        letter = line[char_counter];
-        if ((letter < 'A') || (letter > 'Z')) {
-            FAIL(Error::ExpectedCommandLetter);  // [Expected word letter]
-        }
-        char_counter++;
-        if (!read_float(line, &char_counter, &value)) {
-            FAIL(Error::BadNumberFormat);  // [Expected word value]
-        }
+    for (uint8_t word = 0; word < tokens->n_words; word++) {  // Loop until no more g-code words in line.
+        letter = tokens->words[word].letter;
+        value  = tokens->words[word].value;
         // Convert values to smaller uint8 significand and mantissa values for parsing this word.
         // NOTE: Mantissa is multiplied by 100 to catch non-integer command values. This is more
         // accurate than the NIST gcode requirement of x10 when used for commands, but not quite
@@ -692,6 +775,9 @@ Error gc_execute_line(char* line, uint8_t client) {
                 value_words |= bitmask;  // Flag to indicate parameter assigned.
         }
     }
+    if (tokens->status != Error::Ok) {
+        FAIL(tokens->status);  // Malformed word that ended the line
+    }
     // Parsing complete!
     /* -------------------------------------------------------------------------------------
        STEP 3: Error-check all commands and values passed in this block. This step ensures all of
@@ -1504,7 +1590,7 @@ Error gc_execute_line(char* line, uint8_t client) {
             GCUpdatePos gc_update_pos = GCUpdatePos::Target;
             if (gc_state.modal.motion == Motion::Linear) {
                 //mc_line(gc_block.values.xyz, pl_data);
-                mc_line_kins(gc_block.values.xyz, pl_data, gc_state.position);
+                mc_smooth_line(gc_block.values.xyz, pl_data, gc_state.position, axis_0, axis_1, axis_linear);
             } else if (gc_state.modal.motion == Motion::Seek) {
                 pl_data->motion.rapidMotion = 1;  // Set rapid motion flag.
                 //mc_line(gc_block.values.xyz, pl_data);
@@ -298,11 +298,45 @@ enum class AxisCommand : uint8_t {
     ToolLengthOffset = 3,
 };
 
+// A g-code word as read from the line: its letter and value, not yet interpreted.
+typedef struct {
+    char  letter;
+    float value;
+} gc_word_t;
+
+// No valid line has more words than there are value letters and modal groups.
+const int GC_MAX_WORDS = 40;
+
+// A packed line starts with GC_PACKED_LINE and holds words that are already split, so that it
+// skips comment stripping, case conversion and decimal digit parsing. Each word is an upper case
+// letter, then '-' if the value is negative, then the decimal places of the value, then the value
+// with its decimal point removed, in base 32 digits (0-9 a-v), most significant first. The places
+// are given by characters w, x, y and z, for 1 to 4 places each, which add up. The value is scaled
+// as read_float() would scale the same digits, so a packed line runs exactly like its text.
+// There are no spaces or comments. doc/script/pack_gcode.py writes them.
+// Example: "G1 X10.5 F800" (13 characters) is "@G1Xw39Fp0" (10 characters).
+// The line stays printable text because the clients take realtime commands (?, !, ~, 0x18 and
+// bytes from 0x80) out of the input stream before it reaches the line buffer, and lines end at
+// the first NUL, so binary floats would not arrive intact.
+const char GC_PACKED_LINE = '@';
+
+typedef struct {
+    gc_word_t words[GC_MAX_WORDS];
+    uint8_t   n_words;
+    Error     status;  // Why reading stopped early, if it did
+    bool      jog;     // Line started with $J=
+} gc_tokens_t;
+
 // Initialize the parser
 void gc_init();
 
 // Execute one block of rs275/ngc/g-code
 Error gc_execute_line(char* line, uint8_t client);
 
+// The two halves of gc_execute_line(). Reading the words does not depend on the parser state,
+// so lines can be read ahead of their execution.
+void  gc_tokenize_line(char* line, uint8_t client, gc_tokens_t* tokens);
+Error gc_execute_tokens(const gc_tokens_t* tokens, uint8_t client);
+
 // Set g-code parser position. Input in steps.
 void gc_sync_position();
@@ -101,11 +101,15 @@ static void reset_variables() {
     coolant_init();
     limits_init();
     probe_init();
-    plan_reset();  // Clear block buffer and planner variables
-    st_reset();    // Clear stepper subsystem variables
-    // Sync cleared gcode and planner positions to current system position.
-    plan_sync_position();
-    gc_sync_position();
+    {
+        StPrepLock lock;  // Segment prep must not run between the resets
+        plan_reset();     // Clear block buffer and planner variables
+        mc_smooth_reset();
+        st_reset();       // Clear stepper subsystem variables
+        // Sync cleared gcode and planner positions to current system position.
+        plan_sync_position();
+        gc_sync_position();
+    }
     report_init_message(CLIENT_ALL);
 }
 
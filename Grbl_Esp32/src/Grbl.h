@@ -53,8 +53,10 @@ const char* const GRBL_VERSION_BUILD = "20201124";
 #include "Limits.h"
 #include "MotionControl.h"
 #include "Protocol.h"
+#include "RealtimeLatency.h"
 #include "Report.h"
 #include "Serial.h"
+#include "Telemetry.h"
 #include "Pins.h"
 #include "Spindles/Spindle.h"
 #include "Motors/Motors.h"
@@ -33,6 +33,8 @@
 
 SquaringMode ganged_mode = SquaringMode::Dual;
 
+static void mc_plan_line(float* target, plan_line_data_t* pl_data);
+
 // this allows kinematics to be used.
 void mc_line_kins(float* target, plan_line_data_t* pl_data, float* position) {
 #ifndef USE_KINEMATICS
@@ -42,6 +44,106 @@ void mc_line_kins(float* target, plan_line_data_t* pl_data, float* position) {
 #endif
 }
 
+#ifdef USE_KINEMATICS
+// Plans a segment end point converted by mc_kinematics_line(), with the feed rate scaled by how far
+// the motors move for the segment. Returns false on a system abort.
+static bool mc_kinematics_plan(float* motors, plan_line_data_t* pl_data, float feed_rate, float segment_dist, const mc_kinematics_t* kins) {
+    float motor_dist = 0.0f;
+    for (uint8_t idx = X_AXIS; idx <= Z_AXIS; idx++) {
+        float d = motors[idx] - kins->last_motors[idx];
+        motor_dist += d * d;
+    }
+    memcpy(kins->last_motors, motors, MAX_N_AXIS * sizeof(float));
+    if (!pl_data->motion.rapidMotion && motor_dist > 0.0f && segment_dist > 0.0f) {
+        pl_data->feed_rate = feed_rate * MAX(sqrtf(motor_dist) / segment_dist, kins->min_feed_scale);
+    }
+    mc_line(motors, pl_data);
+    return !sys.abort;
+}
+
+void mc_kinematics_line(float* target, plan_line_data_t* pl_data, float* position, const mc_kinematics_t* kins) {
+    float   points[KINEMATICS_BATCH][MAX_N_AXIS];
+    float   delta[MAX_N_AXIS];
+    float   feed_rate = pl_data->feed_rate;
+    float   dist      = 0.0f;
+    uint8_t idx;
+
+    // The kinematics map X, Y and Z, so the feed rate follows their distances only.
+    for (idx = X_AXIS; idx <= Z_AXIS; idx++) {
+        float d = target[idx] - position[idx];
+        dist += d * d;
+    }
+    dist = sqrtf(dist);
+
+    if (kins->segment_length == 0.0f) {
+        // Not split, so only the target needs converting.
+        memcpy(points[0], target, sizeof(points[0]));
+        if (kins->inverse(points, 1)) {
+            mc_kinematics_plan(points[0], pl_data, feed_rate, dist, kins);
+        }
+        pl_data->feed_rate = feed_rate;
+        return;
+    }
+
+    auto     n_axis       = number_axis->get();
+    uint32_t segments     = MAX(ceilf(dist / kins->segment_length), 1);
+    float    inv_segments = 1.0f / segments;
+    float    segment_dist = dist * inv_segments;
+    for (idx = 0; idx < n_axis; idx++) {
+        delta[idx] = target[idx] - position[idx];
+    }
+    for (uint32_t first = 1; first <= segments; first += KINEMATICS_BATCH) {
+        uint16_t count = MIN(segments - first + 1, KINEMATICS_BATCH);
+        for (uint16_t i = 0; i < count; i++) {
+            if (first + i == segments) {
+                memcpy(points[i], target, sizeof(points[i]));  // Arrive at the target exactly
+            } else {
+                float fraction = (first + i) * inv_segments;
+                for (idx = 0; idx < n_axis; idx++) {
+                    points[i][idx] = position[idx] + delta[idx] * fraction;
+                }
+            }
+        }
+        uint16_t done = 0;
+        while (done < count) {
+            uint16_t end = done + kins->inverse(points + done, count - done);
+            for (; done < end; done++) {
+                if (!mc_kinematics_plan(points[done], pl_data, feed_rate, segment_dist, kins)) {
+                    pl_data->feed_rate = feed_rate;
+                    return;
+                }
+            }
+            done++;  // Skip the point out of reach, if any
+        }
+    }
+    pl_data->feed_rate = feed_rate;
+}
+#endif
+
+// Waits for room in the planner buffer. Returns false on a system abort.
+static bool mc_wait_for_planner() {
+    // If the buffer is full: good! That means we are well ahead of the robot.
+    // Remain in this loop until there is room in the buffer. Being ahead also means there is time
+    // to finish any planning deferred by PLANNER_REVERSE_PASS_LIMIT and to read the next lines
+    // before waiting.
+    if (plan_check_full_buffer()) {
+        plan_finish_recalculate();
+        protocol_read_ahead();
+    }
+    do {
+        protocol_execute_realtime();  // Check for any run-time commands
+        if (sys.abort) {
+            return false;
+        }
+        if (plan_check_full_buffer()) {
+            protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
+            protocol_read_ahead();        // Meanwhile, tokenize the lines that follow this one.
+        } else {
+            return true;
+        }
+    } while (1);
+}
+
 // Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
 // unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
 // (1 minute)/feed_rate time.
@@ -50,6 +152,11 @@ void mc_line_kins(float* target, plan_line_data_t* pl_data, float* position) {
 // mc_line and plan_buffer_line is done primarily to place non-planner-type functions from being
 // in the planner and to let backlash compensation or canned cycle integration simple and direct.
 void mc_line(float* target, plan_line_data_t* pl_data) {
+    mc_smooth_flush();  // Moves held back for path smoothing go first
+    mc_plan_line(target, pl_data);
+}
+
+static void mc_plan_line(float* target, plan_line_data_t* pl_data) {
     // If enabled, check for soft limit violations. Placed here all line motions are picked up
     // from everywhere in Grbl.
     if (soft_limits->get()) {
@@ -75,24 +182,80 @@ void mc_line(float* target, plan_line_data_t* pl_data) {
     // indicates to Grbl what is a backlash compensation motion, so that Grbl executes the move but
     // doesn't update the machine position values. Since the position values used by the g-code
     // parser and planner are separate from the system machine positions, this is doable.
-    // If the buffer is full: good! That means we are well ahead of the robot.
-    // Remain in this loop until there is room in the buffer.
-    do {
-        protocol_execute_realtime();  // Check for any run-time commands
-        if (sys.abort) {
-            return;  // Bail, if system abort.
-        }
-        if (plan_check_full_buffer()) {
-            protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
-        } else {
-            break;
-        }
-    } while (1);
+    if (!mc_wait_for_planner()) {
+        return;  // Bail, if system abort.
+    }
     // Plan and queue motion into planner buffer
     // uint8_t plan_status; // Not used in normal operation.
     plan_buffer_line(target, pl_data);
 }
 
+#if defined(PLANNER_NATIVE_ARCS) && !defined(USE_KINEMATICS)
+// Queues an arc block. Check mode and waiting for room are as for a line.
+static void mc_plan_arc(float* target, plan_line_data_t* pl_data, plan_arc_t* arc) {
+    if (sys.state == State::CheckMode) {
+        return;
+    }
+    if (!mc_wait_for_planner()) {
+        return;  // Bail, if system abort.
+    }
+    plan_buffer_arc(target, pl_data, arc);
+}
+
+// Queues an arc as one planner block, which segment prep steps along. Returns false, leaving the
+// arc to be broken into chords, if an axis outside the arc has to move as well.
+static bool mc_arc_native(float*            target,
+                          plan_line_data_t* pl_data,
+                          float*            position,
+                          float*            offset,
+                          float             radius,
+                          float             angular_travel,
+                          uint8_t           axis_0,
+                          uint8_t           axis_1,
+                          uint8_t           axis_linear) {
+    auto n_axis = number_axis->get();
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        if (idx != axis_0 && idx != axis_1 && idx != axis_linear && target[idx] != position[idx]) {
+            return false;
+        }
+    }
+    plan_arc_t arc;
+    arc.axis_0         = axis_0;
+    arc.axis_1         = axis_1;
+    arc.axis_linear    = axis_linear;
+    arc.center[0]      = position[axis_0] + offset[axis_0];
+    arc.center[1]      = position[axis_1] + offset[axis_1];
+    arc.start[0]       = -offset[axis_0];
+    arc.start[1]       = -offset[axis_1];
+    arc.radius         = radius;
+    arc.angular_travel = angular_travel;
+    arc.linear_start   = position[axis_linear];
+    arc.linear_travel  = target[axis_linear] - position[axis_linear];
+
+    // The arc stays within the soft limits if its end and the points where it turns on an axis do.
+    if (soft_limits->get() && sys.state != State::Jog) {
+        float extreme[MAX_N_AXIS];
+        memcpy(extreme, target, sizeof(extreme));
+        float start_angle = atan2(arc.start[1], arc.start[0]);
+        for (int quadrant = 0; quadrant < 4; quadrant++) {
+            float turn = quadrant * M_PI_2 - start_angle;  // Angle from the start to this axis crossing
+            turn -= 2 * M_PI * floor(turn / (2 * M_PI));   // Counterclockwise, 0 to 2pi
+            if (angular_travel < 0 && turn > 0) {
+                turn -= 2 * M_PI;  // Clockwise
+            }
+            if (fabs(turn) < fabs(angular_travel)) {
+                extreme[axis_0] = arc.center[0] + radius * cos(quadrant * M_PI_2);
+                extreme[axis_1] = arc.center[1] + radius * sin(quadrant * M_PI_2);
+                limits_soft_check(extreme);
+            }
+        }
+        limits_soft_check(target);
+    }
+    mc_plan_arc(target, pl_data, &arc);
+    return true;
+}
+#endif
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_X defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, isclockwise boolean. Used
@@ -109,6 +272,7 @@ void mc_arc(float*            target,
             uint8_t           axis_1,
             uint8_t           axis_linear,
             uint8_t           is_clockwise_arc) {
+    mc_smooth_flush();  // Moves held back for path smoothing go first
     float center_axis0 = position[axis_0] + offset[axis_0];
     float center_axis1 = position[axis_1] + offset[axis_1];
     float r_axis0      = -offset[axis_0];  // Radius vector from center to current location
@@ -136,6 +300,11 @@ void mc_arc(float*            target,
             angular_travel += 2 * M_PI;
         }
     }
+#if defined(PLANNER_NATIVE_ARCS) && !defined(USE_KINEMATICS)
+    if (mc_arc_native(target, pl_data, position, offset, radius, angular_travel, axis_0, axis_1, axis_linear)) {
+        return;
+    }
+#endif
     // NOTE: Segment end points are on the arc, which can lead to the arc diameter being smaller by up to
     // (2x) arc_tolerance. For 99% of users, this is just fine. If a different arc segment fit
     // is desired, i.e. least-squares, midpoint on arc, just change the mm_per_arc_segment calculation.
@@ -223,6 +392,298 @@ void mc_arc(float*            target,
     mc_line_kins(target, pl_data, previous_position);
 }
 
+#if defined(PATH_SMOOTHING) && !defined(USE_KINEMATICS)
+// G1 moves wait here as a polyline, from smooth.points[0] through smooth.points[smooth.count], for
+// as long as every vertex stays within path_tolerance of one line, or of one arc, from its start to
+// its end. That line or arc then goes to the planner as a single block. Whatever else moves or
+// waits for motion sends the held moves on first, and so does input that stops for longer than
+// PATH_SMOOTHING_HOLD_MS.
+
+// Moves that may wait without fitting a line, as they might still be the start of an arc
+#    ifdef PLANNER_NATIVE_ARCS
+static const int PATH_UNFIT_MOVES = 2;
+#    else
+static const int PATH_UNFIT_MOVES = 1;
+#    endif
+
+// Single precision cannot tell a vertex's distance from larger circles to within the tolerance.
+static const float PATH_ARC_MAX_RADIUS_RATIO = 1E5;
+
+enum class PathFit : uint8_t {
+    None,  // Neither yet, see PATH_UNFIT_MOVES
+    Line,
+    Arc,
+};
+
+static struct {
+    float            points[PATH_SMOOTHING_MOVES + 1][MAX_N_AXIS];
+    plan_line_data_t pl_data[PATH_SMOOTHING_MOVES + 1];  // Of the move that ends at each point
+    uint8_t          count;                              // Moves held
+    PathFit          fit;
+    uint8_t          axis_0;  // Plane for arcs, as for G2/G3
+    uint8_t          axis_1;
+    uint8_t          axis_linear;
+    float            center[2];  // Of the arc, when fit is PathFit::Arc
+    float            radius;
+    float            angular_travel;
+    uint32_t         held_ms;  // millis() when the last move was taken
+} smooth;
+
+static mc_smooth_stats_t smooth_stats;
+
+// Whether points[1] through points[n - 1] lie within tolerance of the line from points[0] to
+// points[n], in order along it.
+static bool smooth_fits_line(uint8_t n, float tolerance) {
+    auto  n_axis = number_axis->get();
+    float chord[MAX_N_AXIS];
+    float length = 0.0;
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        chord[idx] = smooth.points[n][idx] - smooth.points[0][idx];
+        length += chord[idx] * chord[idx];
+    }
+    length = sqrt(length);
+    if (length == 0.0) {
+        return false;
+    }
+    float last_along = 0.0;
+    for (uint8_t i = 1; i < n; i++) {
+        float along    = 0.0;
+        float dist_sqr = 0.0;
+        for (uint8_t idx = 0; idx < n_axis; idx++) {
+            float delta = smooth.points[i][idx] - smooth.points[0][idx];
+            along += delta * chord[idx];
+            dist_sqr += delta * delta;
+        }
+        along /= length;
+        dist_sqr -= along * along;
+        if (along <= last_along || along >= length || dist_sqr > tolerance * tolerance) {
+            return false;
+        }
+        last_along = along;
+    }
+    return true;
+}
+
+#    ifdef PLANNER_NATIVE_ARCS
+// Whether points[0] through points[n] lie on an arc in the plane that turns one way through less than
+// a full circle, with the vertices and the chords between them within tolerance of it. The circle is
+// the one through the first, middle and last points. Sets the arc in smooth if so.
+static bool smooth_fits_arc(uint8_t n, float tolerance) {
+    auto          n_axis = number_axis->get();
+    const uint8_t a0     = smooth.axis_0;
+    const uint8_t a1     = smooth.axis_1;
+    for (uint8_t i = 1; i <= n; i++) {
+        for (uint8_t idx = 0; idx < n_axis; idx++) {
+            if (idx != a0 && idx != a1 && smooth.points[i][idx] != smooth.points[0][idx]) {
+                return false;
+            }
+        }
+    }
+    float bx = smooth.points[n / 2][a0] - smooth.points[0][a0];
+    float by = smooth.points[n / 2][a1] - smooth.points[0][a1];
+    float cx = smooth.points[n][a0] - smooth.points[0][a0];
+    float cy = smooth.points[n][a1] - smooth.points[0][a1];
+    float d  = 2 * (bx * cy - by * cx);
+    if (d == 0.0) {
+        return false;
+    }
+    float b_sqr  = bx * bx + by * by;
+    float c_sqr  = cx * cx + cy * cy;
+    float ux     = (cy * b_sqr - by * c_sqr) / d;  // Center relative to points[0]
+    float uy     = (bx * c_sqr - cx * b_sqr) / d;
+    float radius = sqrt(ux * ux + uy * uy);
+    if (radius > tolerance * PATH_ARC_MAX_RADIUS_RATIO) {
+        return false;
+    }
+    float center_0    = smooth.points[0][a0] + ux;
+    float center_1    = smooth.points[0][a1] + uy;
+    float last_angle  = atan2(-uy, -ux);
+    float travel      = 0.0;
+    float max_error   = 0.0;
+    float max_sagitta = 0.0;
+    for (uint8_t i = 1; i <= n; i++) {
+        float r_0   = smooth.points[i][a0] - center_0;
+        float r_1   = smooth.points[i][a1] - center_1;
+        float angle = atan2(r_1, r_0);
+        float turn  = angle - last_angle;
+        if (turn > M_PI) {
+            turn -= 2 * M_PI;
+        } else if (turn <= -M_PI) {
+            turn += 2 * M_PI;
+        }
+        if (turn == 0.0 || (travel != 0.0 && (turn > 0) != (travel > 0))) {
+            return false;
+        }
+        travel += turn;
+        last_angle = angle;
+
+        float chord_0         = smooth.points[i][a0] - smooth.points[i - 1][a0];
+        float chord_1         = smooth.points[i][a1] - smooth.points[i - 1][a1];
+        float half_chord_sqr  = 0.25 * (chord_0 * chord_0 + chord_1 * chord_1);
+        if (half_chord_sqr >= radius * radius) {
+            return false;
+        }
+        max_error   = MAX(max_error, fabs(sqrt(r_0 * r_0 + r_1 * r_1) - radius));
+        max_sagitta = MAX(max_sagitta, radius - sqrt(radius * radius - half_chord_sqr));
+    }
+    if (fabs(travel) >= 2 * M_PI || max_error + max_sagitta > tolerance) {
+        return false;
+    }
+    smooth.center[0]      = center_0;
+    smooth.center[1]      = center_1;
+    smooth.radius         = radius;
+    smooth.angular_travel = travel;
+    return true;
+}
+#    endif
+
+static PathFit smooth_fit(uint8_t n) {
+    float tolerance = path_tolerance->get();
+    if (smooth_fits_line(n, tolerance)) {
+        return PathFit::Line;
+    }
+#    ifdef PLANNER_NATIVE_ARCS
+    if (n > PATH_UNFIT_MOVES && smooth_fits_arc(n, tolerance)) {
+        return PathFit::Arc;
+    }
+#    endif
+    return PathFit::None;
+}
+
+// Sends the held moves on as one block if they fit one, or else just the first of them.
+static void smooth_send() {
+    uint8_t n = smooth.fit == PathFit::None ? 1 : smooth.count;
+#    ifdef PLANNER_NATIVE_ARCS
+    if (smooth.fit == PathFit::Arc) {
+        plan_arc_t arc;
+        arc.axis_0         = smooth.axis_0;
+        arc.axis_1         = smooth.axis_1;
+        arc.axis_linear    = smooth.axis_linear;
+        arc.center[0]      = smooth.center[0];
+        arc.center[1]      = smooth.center[1];
+        arc.start[0]       = smooth.points[0][smooth.axis_0] - smooth.center[0];
+        arc.start[1]       = smooth.points[0][smooth.axis_1] - smooth.center[1];
+        arc.radius         = smooth.radius;
+        arc.angular_travel = smooth.angular_travel;
+        arc.linear_start   = smooth.points[0][smooth.axis_linear];
+        arc.linear_travel  = 0.0;
+        mc_plan_arc(smooth.points[n], &smooth.pl_data[1], &arc);
+        smooth_stats.arcs++;
+    } else
+#    endif
+    {
+        mc_plan_line(smooth.points[n], &smooth.pl_data[1]);
+    }
+    smooth_stats.blocks++;
+    // The end of what was sent starts what is left.
+    smooth.count -= n;
+    memmove(smooth.points[0], smooth.points[n], (smooth.count + 1) * sizeof(smooth.points[0]));
+    memmove(&smooth.pl_data[1], &smooth.pl_data[n + 1], smooth.count * sizeof(smooth.pl_data[0]));
+    smooth.fit = smooth.count ? smooth_fit(smooth.count) : PathFit::None;
+}
+
+// Whether a move can join the held ones: it starts where they end, in the same plane, and only its
+// line number differs in pl_data.
+static bool smooth_joins(float* position, plan_line_data_t* pl_data, uint8_t axis_0, uint8_t axis_1) {
+    const plan_line_data_t& held = smooth.pl_data[1];
+    return memcmp(position, smooth.points[smooth.count], sizeof(smooth.points[0])) == 0 && axis_0 == smooth.axis_0 &&
+           axis_1 == smooth.axis_1 && pl_data->feed_rate == held.feed_rate && pl_data->spindle_speed == held.spindle_speed &&
+           pl_data->motion.noFeedOverride == held.motion.noFeedOverride && pl_data->spindle == held.spindle &&
+           pl_data->coolant.Mist == held.coolant.Mist && pl_data->coolant.Flood == held.coolant.Flood;
+}
+
+void mc_smooth_line(float* target, plan_line_data_t* pl_data, float* position, uint8_t axis_0, uint8_t axis_1, uint8_t axis_linear) {
+    // Only feed moves are smoothed, and not while checking g-code.
+    if (path_tolerance->get() == 0.0 || sys.state == State::CheckMode || pl_data->motion.rapidMotion || pl_data->motion.inverseTime) {
+        mc_line(target, pl_data);
+        return;
+    }
+    if (smooth.count && !smooth_joins(position, pl_data, axis_0, axis_1)) {
+        mc_smooth_flush();
+        if (sys.abort) {
+            return;
+        }
+    }
+    if (!smooth.count) {
+        memcpy(smooth.points[0], position, sizeof(smooth.points[0]));
+        smooth.axis_0      = axis_0;
+        smooth.axis_1      = axis_1;
+        smooth.axis_linear = axis_linear;
+    }
+    if (soft_limits->get()) {
+        limits_soft_check(target);  // Checked now, so that an alarm comes with the line that caused it
+        if (sys.abort) {
+            return;
+        }
+    }
+    smooth_stats.moves++;
+    smooth.held_ms = millis();
+    for (;;) {
+        uint8_t n = smooth.count + 1;
+        if (n <= PATH_SMOOTHING_MOVES) {
+            memcpy(smooth.points[n], target, sizeof(smooth.points[n]));
+            smooth.pl_data[n] = *pl_data;
+            PathFit fit       = smooth_fit(n);
+            if (fit != PathFit::None || n <= PATH_UNFIT_MOVES) {
+                smooth.count = n;
+                smooth.fit   = fit;
+                return;
+            }
+        }
+        // The move does not join the held ones. Send them, or the first of them, and try again.
+        smooth_send();
+        if (sys.abort) {
+            return;
+        }
+    }
+}
+
+void mc_smooth_flush() {
+    while (smooth.count && !sys.abort) {
+        smooth_send();
+    }
+}
+
+void mc_smooth_idle() {
+    if (smooth.count && (plan_get_block_buffer_count() < 2 || millis() - smooth.held_ms >= PATH_SMOOTHING_HOLD_MS)) {
+        mc_smooth_flush();
+    }
+}
+
+bool mc_smooth_pending() {
+    return smooth.count != 0;
+}
+
+void mc_smooth_reset() {
+    smooth.count = 0;
+}
+
+mc_smooth_stats_t mc_get_smooth_stats() {
+    return smooth_stats;
+}
+
+#else
+
+void mc_smooth_line(float* target, plan_line_data_t* pl_data, float* position, uint8_t axis_0, uint8_t axis_1, uint8_t axis_linear) {
+    mc_line_kins(target, pl_data, position);
+}
+
+void mc_smooth_flush() {}
+
+void mc_smooth_idle() {}
+
+bool mc_smooth_pending() {
+    return false;
+}
+
+void mc_smooth_reset() {}
+
+mc_smooth_stats_t mc_get_smooth_stats() {
+    return {};
+}
+
+#endif
+
 // Execute dwell in seconds.
 void mc_dwell(float seconds) {
     if (sys.state == State::CheckMode) {
@@ -439,9 +900,12 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, uint8_t par
     sys_probe_state = Probe::Off;  // Ensure probe state monitor is disabled.
     protocol_execute_realtime();   // Check and execute run-time commands
     // Reset the stepper and planner buffers to remove the remainder of the probe motion.
-    st_reset();            // Reset step segment buffer.
-    plan_reset();          // Reset planner buffer. Zero planner positions. Ensure probing motion is cleared.
-    plan_sync_position();  // Sync planner position to current machine position.
+    {
+        StPrepLock lock;       // Segment prep must not run between the resets
+        st_reset();            // Reset step segment buffer.
+        plan_reset();          // Reset planner buffer. Zero planner positions. Ensure probing motion is cleared.
+        plan_sync_position();  // Sync planner position to current machine position.
+    }
 #ifdef MESSAGE_PROBE_COORDINATES
     // All done! Output the probe position as message.
     report_probe_parameters(CLIENT_ALL);
@@ -38,6 +38,62 @@ const int PARKING_MOTION_LINE_NUMBER = 0;
 void mc_line_kins(float* target, plan_line_data_t* pl_data, float* position);
 void mc_line(float* target, plan_line_data_t* pl_data);
 
+#ifdef USE_KINEMATICS
+// Segment end points converted by one call to mc_kinematics_t::inverse.
+const int KINEMATICS_BATCH = 16;
+
+// What mc_kinematics_line() needs from a machine's inverse kinematics.
+typedef struct {
+    // Converts count cartesian points, in order and in place, to motor positions. Returns how many
+    // it converted before the first one the machine cannot reach.
+    uint16_t (*inverse)(float (*points)[MAX_N_AXIS], uint16_t count);
+    float  segment_length;  // (mm) 0 to convert only the target, for moves that need not be straight
+    float  min_feed_scale;  // Lower bound for the ratio of motor to cartesian distance
+    float* last_motors;     // Motor position at the end of the previous move, updated here
+} mc_kinematics_t;
+
+// Plans a cartesian move from position to target for a machine with kinematics. The move is split
+// into segments no longer than segment_length, whose end points are converted KINEMATICS_BATCH at a
+// time and planned with mc_line(). Each segment's feed rate is scaled by how far the motors move
+// for it. Points out of reach are skipped. With a segment_length of 0 the move is not split.
+void mc_kinematics_line(float* target, plan_line_data_t* pl_data, float* position, const mc_kinematics_t* kins);
+#endif
+
+// Path smoothing, if PATH_SMOOTHING is defined. Takes a G1 move from the g-code parser and holds
+// it back, as long as it and the moves held before it fit one line or arc within the path tolerance,
+// so that they reach the planner as one block. Without it, or with a tolerance of 0, this is
+// mc_line_kins(). axis_0, axis_1 and axis_linear are the arc plane, as for mc_arc().
+void mc_smooth_line(float* target, plan_line_data_t* pl_data, float* position, uint8_t axis_0, uint8_t axis_1, uint8_t axis_linear);
+
+// Sends any moves held back by mc_smooth_line() to the planner. Called before anything else moves
+// or waits for motion.
+void mc_smooth_flush();
+
+// Called when the main loop runs out of input. Held moves wait up to PATH_SMOOTHING_HOLD_MS for the
+// next line, so that senders that wait for each "ok" still get their moves joined, but go at once
+// if the planner is down to its last block.
+void mc_smooth_idle();
+
+// Whether mc_smooth_line() holds any moves, and dropping them on a reset.
+bool mc_smooth_pending();
+void mc_smooth_reset();
+
+#ifndef PATH_SMOOTHING_MOVES
+#    define PATH_SMOOTHING_MOVES 16
+#endif
+
+#ifndef PATH_SMOOTHING_HOLD_MS
+#    define PATH_SMOOTHING_HOLD_MS 20
+#endif
+
+typedef struct {
+    uint32_t moves;   // G1 moves taken by mc_smooth_line() with smoothing on
+    uint32_t blocks;  // Planner blocks they became
+    uint32_t arcs;    // Of those, how many were arcs
+} mc_smooth_stats_t;
+
+mc_smooth_stats_t mc_get_smooth_stats();
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_XXX defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, is_clockwise_arc boolean. Used
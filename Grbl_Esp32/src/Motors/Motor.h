@@ -83,6 +83,14 @@ namespace Motors {
         // states of the step pins are unknown.
         virtual void unstep() {}
 
+        // step_masks() is called once from init_motors().  A motor
+        // whose step pin is an ordinary GPIO or RMT channel fills in
+        // the register bits that start its step pulse and returns
+        // true.  motors_step() and motors_unstep() then drive the
+        // pin directly together with all the others, and do not
+        // call step() or unstep() for it.
+        virtual bool step_masks(StepPinMasks& active) { return false; }
+
         // test(), called from init(), checks to see if a motor is
         // responsive, returning true on failure.  Typical
         // implementations also display messages to show the result.
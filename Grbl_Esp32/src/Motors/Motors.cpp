@@ -43,7 +43,71 @@
 #include "Dynamixel2.h"
 #include "TrinamicDriver.h"
 
+#include <soc/gpio_struct.h>
+#include <xtensa/hal.h>
+
 Motors::Motor*      myMotor[MAX_AXES][MAX_GANGED];  // number of axes (normal and ganged)
+
+// Step pin register masks built by init_step_masks(). Motors without masks are
+// flagged in virtual_step_axes and stepped through step() and unstep().
+static StepPinMasks step_on_masks[MAX_AXES][MAX_GANGED];
+static StepPinMasks step_off_mask;  // Every masked step pin in its idle state
+static uint8_t      virtual_step_axes[MAX_GANGED];
+
+#ifdef STEPPER_ISR_STATS
+static MotorsStepTime step_time;
+#endif
+
+static void init_step_masks() {
+    auto n_axis = number_axis->get();
+    memset(step_on_masks, 0, sizeof(step_on_masks));
+    memset(&step_off_mask, 0, sizeof(step_off_mask));
+    for (uint8_t gang_index = 0; gang_index < MAX_GANGED; gang_index++) {
+        virtual_step_axes[gang_index] = 0;
+        for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+            StepPinMasks& on = step_on_masks[axis][gang_index];
+#ifdef DISABLE_STEP_PIN_MASKS
+            bool masked = false;
+#else
+            bool masked = myMotor[axis][gang_index]->step_masks(on);
+#endif
+            if (!masked) {
+                on = {};
+                bitnum_true(virtual_step_axes[gang_index], axis);
+                continue;
+            }
+            step_off_mask.set_lo |= on.clear_lo;
+            step_off_mask.clear_lo |= on.set_lo;
+            step_off_mask.set_hi |= on.clear_hi;
+            step_off_mask.clear_hi |= on.set_hi;
+            // RMT pulses end by themselves, so step_off_mask has no channels.
+        }
+    }
+}
+
+static inline void IRAM_ATTR write_step_masks(const StepPinMasks& masks) {
+    if (masks.set_lo) {
+        GPIO.out_w1ts = masks.set_lo;
+    }
+    if (masks.clear_lo) {
+        GPIO.out_w1tc = masks.clear_lo;
+    }
+    if (masks.set_hi) {
+        GPIO.out1_w1ts.val = masks.set_hi;
+    }
+    if (masks.clear_hi) {
+        GPIO.out1_w1tc.val = masks.clear_hi;
+    }
+#ifdef USE_RMT_STEPS
+    for (uint8_t channels = masks.rmt_channels, chan = 0; channels; channels >>= 1, chan++) {
+        if (channels & 1) {
+            RMT.conf_ch[chan].conf1.mem_rd_rst = 1;
+            RMT.conf_ch[chan].conf1.tx_start   = 1;
+        }
+    }
+#endif
+}
+
 void init_motors() {
     grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Init Motors");
 
@@ -277,6 +341,8 @@ void init_motors() {
             myMotor[axis][gang_index]->init();
         }
     }
+
+    init_step_masks();
 }
 
 void motors_set_disable(bool disable) {
@@ -332,7 +398,24 @@ uint8_t motors_set_homing_mode(uint8_t homing_mask, bool isHoming) {
     return can_home;
 }
 
+// Steps a motor without masks right away, or adds its masks to the ones to write.
+static inline void IRAM_ATTR step_motor(uint8_t axis, uint8_t gang_index, StepPinMasks& on) {
+    if (bitnum_istrue(virtual_step_axes[gang_index], axis)) {
+        myMotor[axis][gang_index]->step();
+        return;
+    }
+    const StepPinMasks& masks = step_on_masks[axis][gang_index];
+    on.set_lo |= masks.set_lo;
+    on.clear_lo |= masks.clear_lo;
+    on.set_hi |= masks.set_hi;
+    on.clear_hi |= masks.clear_hi;
+    on.rmt_channels |= masks.rmt_channels;
+}
+
 void motors_step(uint8_t step_mask, uint8_t dir_mask) {
+#ifdef STEPPER_ISR_STATS
+    uint32_t start = xthal_get_ccount();
+#endif
     auto n_axis = number_axis->get();
     //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "motors_set_direction_pins:0x%02X", onMask);
 
@@ -348,23 +431,62 @@ void motors_step(uint8_t step_mask, uint8_t dir_mask) {
             myMotor[axis][1]->set_direction(thisDir);
         }
     }
-    // Turn on step pulses for motors that are supposed to step now
+    // Turn on step pulses for motors that are supposed to step now. Motors with
+    // step pin masks are collected and switched together afterwards.
+    StepPinMasks on = {};
     for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
         if (bitnum_istrue(step_mask, axis)) {
             if ((ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::A)) {
-                myMotor[axis][0]->step();
+                step_motor(axis, 0, on);
             }
             if ((ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::B)) {
-                myMotor[axis][1]->step();
+                step_motor(axis, 1, on);
             }
         }
     }
+    write_step_masks(on);
+
+#ifdef STEPPER_ISR_STATS
+    uint32_t cycles = xthal_get_ccount() - start;
+    step_time.steps++;
+    step_time.step_total += cycles;
+    if (cycles > step_time.step_max) {
+        step_time.step_max = cycles;
+    }
+#endif
 }
 // Turn all stepper pins off
 void motors_unstep() {
+#ifdef STEPPER_ISR_STATS
+    uint32_t start = xthal_get_ccount();
+#endif
     auto n_axis = number_axis->get();
+    write_step_masks(step_off_mask);
     for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
-        myMotor[axis][0]->unstep();
-        myMotor[axis][1]->unstep();
+        if (bitnum_istrue(virtual_step_axes[0], axis)) {
+            myMotor[axis][0]->unstep();
+        }
+        if (bitnum_istrue(virtual_step_axes[1], axis)) {
+            myMotor[axis][1]->unstep();
+        }
+    }
+
+#ifdef STEPPER_ISR_STATS
+    uint32_t cycles = xthal_get_ccount() - start;
+    step_time.unsteps++;
+    step_time.unstep_total += cycles;
+    if (cycles > step_time.unstep_max) {
+        step_time.unstep_max = cycles;
     }
+#endif
 }
+
+#ifdef STEPPER_ISR_STATS
+// The counters are updated from the step ISR, so a step can occasionally be
+// lost between the copy and the reset. That is fine for a statistic.
+MotorsStepTime motors_take_step_time() {
+    MotorsStepTime taken = step_time;
+    memset(&step_time, 0, sizeof(step_time));
+    return taken;
+}
+#endif
@@ -31,6 +31,29 @@
 
 #include "../Grbl.h"
 
+// Step pin bits for the GPIO W1TS/W1TC registers. The low bank is GPIO 0-31 and
+// the high bank is GPIO 32-39, with bit 0 for GPIO 32. With USE_RMT_STEPS the
+// pulses come from RMT channels instead, one bit per channel.
+struct StepPinMasks {
+    uint32_t set_lo;
+    uint32_t clear_lo;
+    uint32_t set_hi;
+    uint32_t clear_hi;
+    uint8_t  rmt_channels;
+};
+
+#ifdef STEPPER_ISR_STATS
+// CPU cycles spent in motors_step() and motors_unstep(), for comparing step strategies.
+struct MotorsStepTime {
+    uint32_t steps;
+    uint32_t step_max;
+    uint64_t step_total;
+    uint32_t unsteps;
+    uint32_t unstep_max;
+    uint64_t unstep_total;
+};
+#endif
+
 // These are used for setup and to talk to the motors as a group.
 void    init_motors();
 uint8_t get_next_trinamic_driver_index();
@@ -43,4 +66,9 @@ void    motors_set_disable(bool disable);
 void    motors_step(uint8_t step_mask, uint8_t dir_mask);
 void    motors_unstep();
 
+#ifdef STEPPER_ISR_STATS
+// Returns the step timing gathered since the last call and starts over.
+MotorsStepTime motors_take_step_time();
+#endif
+
 void servoUpdateTask(void* pvParameters);
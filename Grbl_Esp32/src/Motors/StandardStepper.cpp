@@ -23,6 +23,8 @@
 
 #include "StandardStepper.h"
 
+#include <driver/gpio.h>
+
 namespace Motors {
     rmt_item32_t StandardStepper::rmtItem[2];
     rmt_config_t StandardStepper::rmtConfig;
@@ -120,6 +122,26 @@ namespace Motors {
 #endif  // USE_RMT_STEPS
     }
 
+    bool StandardStepper::step_masks(StepPinMasks& active) {
+#ifdef USE_RMT_STEPS
+        if (_rmt_chan_num >= RMT_CHANNEL_MAX) {
+            return false;
+        }
+        bitnum_true(active.rmt_channels, _rmt_chan_num);
+        return true;
+#else
+        if (_step_pin >= GPIO_PIN_COUNT) {  // I2S or undefined
+            return false;
+        }
+        if (_step_pin < 32) {
+            bitnum_true(_invert_step_pin ? active.clear_lo : active.set_lo, _step_pin);
+        } else {
+            bitnum_true(_invert_step_pin ? active.clear_hi : active.set_hi, _step_pin - 32);
+        }
+        return true;
+#endif  // USE_RMT_STEPS
+    }
+
     void StandardStepper::set_direction(bool dir) { digitalWrite(_dir_pin, dir ^ _invert_dir_pin); }
 
     void StandardStepper::set_disable(bool disable) { digitalWrite(_disable_pin, disable); }
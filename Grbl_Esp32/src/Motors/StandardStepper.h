@@ -15,6 +15,7 @@ namespace Motors {
         void set_direction(bool) override;
         void step() override;
         void unstep() override;
+        bool step_masks(StepPinMasks& active) override;
 
         void init_step_dir_pins();
 
@@ -25,8 +25,6 @@
 #include "Grbl.h"
 #include <cstring>
 
-const int MAX_INT_DIGITS = 8;  // Maximum number of digits in int32 (and float)
-
 // Extracts a floating point value from a string. The following code is based loosely on
 // the avr-libc strtod() function by Michael Stumpf and Dmitry Xmelkov and many freely
 // available conversion method examples, but has been highly optimized for Grbl. For known
@@ -80,6 +78,18 @@ uint8_t read_float(const char* line, uint8_t* char_counter, float* float_ptr) {
     }
 
     // Convert integer into floating point.
+    float fval = decimal_to_float(intval, exp);
+    // Assign floating point value with correct sign.
+    if (isnegative) {
+        *float_ptr = -fval;
+    } else {
+        *float_ptr = fval;
+    }
+    *char_counter = ptr - line - 1;  // Set char_counter to next statement
+    return true;
+}
+
+float decimal_to_float(uint32_t intval, int8_t exp) {
     float fval;
     fval = (float)intval;
     // Apply decimal. Should perform no more than two floating point multiplications for the
@@ -97,14 +107,7 @@ uint8_t read_float(const char* line, uint8_t* char_counter, float* float_ptr) {
             } while (--exp > 0);
         }
     }
-    // Assign floating point value with correct sign.
-    if (isnegative) {
-        *float_ptr = -fval;
-    } else {
-        *float_ptr = fval;
-    }
-    *char_counter = ptr - line - 1;  // Set char_counter to next statement
-    return true;
+    return fval;
 }
 
 void delay_ms(uint16_t ms) {
@@ -136,14 +139,38 @@ float hypot_f(float x, float y) {
     return sqrt(x * x + y * y);
 }
 
+static axis_limits_t limits;
+static uint32_t      limits_changes = 0;
+static bool          limits_valid   = false;
+
+const axis_limits_t& axis_limits() {
+    // Read the change count before the values, so a change made while copying them is
+    // picked up by the next call.
+    uint32_t changes = AxisSettings::changes;
+    uint8_t  n_axis  = number_axis->get();
+    if (limits_valid && changes == limits_changes && n_axis == limits.n_axis) {
+        return limits;
+    }
+    limits.n_axis = n_axis;
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        float jerk                   = axis_settings[idx]->jerk->get();
+        limits.steps_per_mm[idx]     = axis_settings[idx]->steps_per_mm->get();
+        limits.inv_max_rate[idx]     = 1.0f / axis_settings[idx]->max_rate->get();
+        limits.inv_acceleration[idx] = 1.0f / (axis_settings[idx]->acceleration->get() * SEC_PER_MIN_SQ);
+        limits.inv_jerk[idx]         = (jerk > 0.0f) ? 1.0f / (jerk * SEC_PER_MIN_CU) : 0.0f;
+        limits.no_jerk[idx]          = (jerk > 0.0f) ? 0 : 1;
+    }
+    limits_changes = changes;
+    limits_valid   = true;
+    return limits;
+}
+
 float convert_delta_vector_to_unit_vector(float* vector) {
     uint8_t idx;
     float   magnitude = 0.0;
     auto    n_axis    = number_axis->get();
     for (idx = 0; idx < n_axis; idx++) {
-        if (vector[idx] != 0.0) {
-            magnitude += vector[idx] * vector[idx];
-        }
+        magnitude += vector[idx] * vector[idx];
     }
     magnitude           = sqrt(magnitude);
     float inv_magnitude = 1.0 / magnitude;
@@ -153,32 +180,43 @@ float convert_delta_vector_to_unit_vector(float* vector) {
     return magnitude;
 }
 
+// The limits below are the smallest of limit[idx] / |unit_vec[idx]| over the moving axes,
+// computed as one reciprocal of the largest |unit_vec[idx]| / limit[idx]. Axes that do not
+// move contribute 0 to the maximum, so the loops need no test for them.
 float limit_acceleration_by_axis_maximum(float* unit_vec) {
-    uint8_t idx;
-    float   limit_value = SOME_LARGE_VALUE;
-    auto    n_axis      = number_axis->get();
-    for (idx = 0; idx < n_axis; idx++) {
-        if (unit_vec[idx] != 0) {  // Avoid divide by zero.
-            limit_value = MIN(limit_value, fabs(axis_settings[idx]->acceleration->get() / unit_vec[idx]));
-        }
+    const axis_limits_t& lim = axis_limits();
+    float                inv = 0.0f;
+    for (uint8_t idx = 0; idx < lim.n_axis; idx++) {
+        inv = MAX(inv, fabsf(unit_vec[idx]) * lim.inv_acceleration[idx]);
     }
-    // The acceleration setting is stored and displayed in units of mm/sec^2,
-    // but used in units of mm/min^2.  It suffices to perform the conversion once on
-    // exit, since the limit computation above is independent of units - it simply
-    // finds the smallest value.
-    return limit_value * SEC_PER_MIN_SQ;
+    return 1.0f / inv;
 }
 
 float limit_rate_by_axis_maximum(float* unit_vec) {
-    uint8_t idx;
-    float   limit_value = SOME_LARGE_VALUE;
-    auto    n_axis      = number_axis->get();
-    for (idx = 0; idx < n_axis; idx++) {
-        if (unit_vec[idx] != 0) {  // Avoid divide by zero.
-            limit_value = MIN(limit_value, fabs(axis_settings[idx]->max_rate->get() / unit_vec[idx]));
-        }
+    const axis_limits_t& lim = axis_limits();
+    float                inv = 0.0f;
+    for (uint8_t idx = 0; idx < lim.n_axis; idx++) {
+        inv = MAX(inv, fabsf(unit_vec[idx]) * lim.inv_max_rate[idx]);
+    }
+    return 1.0f / inv;
+}
+
+void limit_by_axis_maximum(float* unit_vec, float* acceleration, float* rate, float* jerk) {
+    const axis_limits_t& lim       = axis_limits();
+    float                inv_accel = 0.0f;
+    float                inv_rate  = 0.0f;
+    float                inv_jerk  = 0.0f;
+    uint8_t              no_jerk   = 0;
+    for (uint8_t idx = 0; idx < lim.n_axis; idx++) {
+        float u   = fabsf(unit_vec[idx]);
+        inv_accel = MAX(inv_accel, u * lim.inv_acceleration[idx]);
+        inv_rate  = MAX(inv_rate, u * lim.inv_max_rate[idx]);
+        inv_jerk  = MAX(inv_jerk, u * lim.inv_jerk[idx]);
+        no_jerk |= (u != 0.0f) & lim.no_jerk[idx];
     }
-    return limit_value;
+    *acceleration = 1.0f / inv_accel;
+    *rate         = 1.0f / inv_rate;
+    *jerk         = no_jerk ? 0.0f : 1.0f / inv_jerk;
 }
 
 float map_float(float x, float in_min, float in_max, float out_min, float out_max) {  // DrawBot_Badge
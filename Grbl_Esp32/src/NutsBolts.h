@@ -81,11 +81,16 @@ const int DELAY_MODE_SYS_SUSPEND = 1;
 #define bitnum_true(x, num) (x) |= bit(num)
 #define bitnum_istrue(x, num) ((x & bit(num)) != 0)
 
+const int MAX_INT_DIGITS = 8;  // Maximum number of digits in int32 (and float)
+
 // Read a floating point value from a string. Line points to the input buffer, char_counter
 // is the indexer pointing to the current character of the line, while float_ptr is
 // a pointer to the result variable. Returns true when it succeeds
 uint8_t read_float(const char* line, uint8_t* char_counter, float* float_ptr);
 
+// Returns intval * 10^exp, rounded the way read_float() rounds the numbers it reads.
+float decimal_to_float(uint32_t intval, int8_t exp);
+
 // Non-blocking delay function used for general operation and suspend features.
 void delay_sec(float seconds, uint8_t mode);
 
@@ -95,9 +100,24 @@ void delay_ms(uint16_t ms);
 // Computes hypotenuse, avoiding avr-gcc's bloated version and the extra error checking.
 float hypot_f(float x, float y);
 
+// Per-axis values the planner needs for every block, copied out of the axis settings and
+// stored as reciprocals so that limiting a move only multiplies. Refreshed when a setting changes.
+struct axis_limits_t {
+    uint8_t n_axis;
+    float   steps_per_mm[MAX_AXES];
+    float   inv_max_rate[MAX_AXES];      // (min/mm)
+    float   inv_acceleration[MAX_AXES];  // (min^2/mm)
+    float   inv_jerk[MAX_AXES];          // (min^3/mm) 0 for axes without a jerk limit
+    uint8_t no_jerk[MAX_AXES];           // 1 for axes without a jerk limit
+};
+const axis_limits_t& axis_limits();
+
 float convert_delta_vector_to_unit_vector(float* vector);
 float limit_acceleration_by_axis_maximum(float* unit_vec);
 float limit_rate_by_axis_maximum(float* unit_vec);
+// Both limits above and the jerk limit in one pass over unit_vec. The jerk is 0, for linear
+// acceleration ramps, if any axis along unit_vec has no jerk limit.
+void limit_by_axis_maximum(float* unit_vec, float* acceleration, float* rate, float* jerk);
 
 float    mapConstrain(float x, float in_min, float in_max, float out_min, float out_max);
 float    map_float(float x, float in_min, float in_max, float out_min, float out_max);
@@ -25,12 +25,23 @@
 
 #include "Grbl.h"
 #include <stdlib.h>  // PSoc Required for labs
+#include <esp_heap_caps.h>
 
-static plan_block_t block_buffer[BLOCK_BUFFER_SIZE];  // A ring buffer for motion instructions
-static uint8_t      block_buffer_tail;                // Index of the block to process now
-static uint8_t      block_buffer_head;                // Index of the next block to be pushed
-static uint8_t      next_buffer_head;                 // Index of the next buffer head
-static uint8_t      block_buffer_planned;             // Index of the optimally planned block
+// Buffers at least this deep are placed in PSRAM when the board has it. Smaller ones stay in
+// internal RAM, which is faster and which they barely dent.
+const int PLANNER_PSRAM_MIN_BLOCKS = 64;
+
+static plan_block_t*      block_buffer = NULL;   // A ring buffer for motion instructions
+static plan_block_index_t block_buffer_tail;     // Index of the block to process now
+static plan_block_index_t block_buffer_head;     // Index of the next block to be pushed
+static plan_block_index_t next_buffer_head;      // Index of the next buffer head
+static plan_block_index_t block_buffer_planned;  // Index of the optimally planned block
+
+static bool               recalculate_pending;  // A reverse pass stopped at its limit and still needs finishing
+static plan_block_index_t reverse_resume;       // First block that pass did not revisit, if pending
+static bool               reverse_lagged;       // A later pass from the head was cut short above that one
+static plan_block_index_t reverse_restart;      // Where the latest such pass stopped, if lagged
+static plan_stats_t       stats;
 
 // Define planner variables
 typedef struct {
@@ -43,7 +54,7 @@ typedef struct {
 static planner_t pl;
 
 // Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
-uint8_t plan_next_block_index(uint8_t block_index) {
+plan_block_index_t plan_next_block_index(plan_block_index_t block_index) {
     block_index++;
     if (block_index == BLOCK_BUFFER_SIZE) {
         block_index = 0;
@@ -52,7 +63,7 @@ uint8_t plan_next_block_index(uint8_t block_index) {
 }
 
 // Returns the index of the previous block in the ring buffer
-static uint8_t plan_prev_block_index(uint8_t block_index) {
+static plan_block_index_t plan_prev_block_index(plan_block_index_t block_index) {
     if (block_index == 0) {
         block_index = BLOCK_BUFFER_SIZE;
     }
@@ -60,6 +71,20 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
     return block_index;
 }
 
+// Returns how many blocks block_index lies after the planned pointer.
+static plan_block_index_t plan_planned_distance(plan_block_index_t block_index) {
+    if (block_index >= block_buffer_planned) {
+        return block_index - block_buffer_planned;
+    }
+    return BLOCK_BUFFER_SIZE - (block_buffer_planned - block_index);
+}
+
+// Returns true if block_index lies after the planned pointer and before the buffer head.
+static bool plan_is_unplanned(plan_block_index_t block_index) {
+    plan_block_index_t distance = plan_planned_distance(block_index);
+    return distance > 0 && distance < plan_planned_distance(block_buffer_head);
+}
+
 /*                            PLANNER SPEED DEFINITION
                                      +--------+   <- current->nominal_speed
                                     /          \
@@ -111,6 +136,12 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
       planner buffer that don't change with the addition of a new block, as describe above. In addition,
       this block can never be less than block_buffer_tail and will always be pushed forward and maintain
       this requirement when encountered by the plan_discard_current_block() routine during a cycle.
+  - reverse_resume: While recalculate_pending is set, the block where a reverse pass cut short by its limit
+      stopped. It and the blocks back to block_buffer_planned have not been replanned since later blocks
+      were added, so block_buffer_planned is not moved past it until the pass has been resumed and finished.
+  - reverse_restart: While reverse_lagged is set, where the latest reverse pass from the head stopped, above
+      reverse_resume. The blocks between the two are left to the next pass, which the next block starts, or
+      plan_finish_recalculate() if no block comes.
 
   NOTE: Since the planner only computes on what's in the planner buffer, some motions with lots of short
   line segments, like G2/3 arcs or complex curves, may seem to move slow. This is because there simply isn't
@@ -125,94 +156,197 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
   ARM versions should have enough memory and speed for look-ahead blocks numbering up to a hundred or more.
 
 */
-static void planner_recalculate() {
-    // Initialize block index to the last block in the planner buffer.
-    uint8_t block_index = plan_prev_block_index(block_buffer_head);
-    // Bail. Can't do anything with one only one plan-able block.
-    if (block_index == block_buffer_planned) {
-        return;
+
+// The highest speed, squared, that a block can reach from speed_sqr over its length, which is also
+// the highest it can come down from to speed_sqr.
+static float plan_reach_speed_sqr(const plan_block_t* block, float speed_sqr) {
+    if (block->jerk > 0.0f) {
+        float speed = plan_jerk_ramp_speed(block, sqrtf(speed_sqr), block->millimeters);
+        return speed * speed;
     }
-    // Reverse Pass: Coarsely maximize all possible deceleration curves back-planning from the last
-    // block in buffer. Cease planning when the last optimal planned or tail pointer is reached.
-    // NOTE: Forward pass will later refine and correct the reverse pass to create an optimal plan.
-    float         entry_speed_sqr;
-    plan_block_t* next;
-    plan_block_t* current = &block_buffer[block_index];
-    // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
-    current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, 2 * current->acceleration * current->millimeters);
-    block_index              = plan_prev_block_index(block_index);
-    if (block_index == block_buffer_planned) {  // Only two plannable blocks in buffer. Reverse pass complete.
-        // Check if the first block is the tail. If so, notify stepper to update its current parameters.
+    return speed_sqr + 2 * block->acceleration * block->millimeters;
+}
+
+// Reverse Pass: Coarsely maximize all possible deceleration curves back-planning from block_index,
+// whose exit speed is the entry speed of the block after it. Cease planning when the last optimal
+// planned or tail pointer is reached, or after limit blocks. Returns the block it stopped at, which
+// has not been revisited unless it is the planned pointer.
+// NOTE: Forward pass will later refine and correct the reverse pass to create an optimal plan.
+static plan_block_index_t planner_reverse_pass(plan_block_index_t block_index, int limit) {
+    plan_block_t* next = &block_buffer[plan_next_block_index(block_index)];
+    while (block_index != block_buffer_planned && limit-- > 0) {
+        plan_block_t* current = &block_buffer[block_index];
+        block_index           = plan_prev_block_index(block_index);
+        // Check if next block is the tail block(=planned block). If so, update current stepper parameters.
         if (block_index == block_buffer_tail) {
             st_update_plan_block_parameters();
         }
-    } else {  // Three or more plan-able blocks
-        while (block_index != block_buffer_planned) {
-            next        = current;
-            current     = &block_buffer[block_index];
-            block_index = plan_prev_block_index(block_index);
-            // Check if next block is the tail block(=planned block). If so, update current stepper parameters.
-            if (block_index == block_buffer_tail) {
-                st_update_plan_block_parameters();
-            }
-            // Compute maximum entry speed decelerating over the current block from its exit speed.
-            if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
-                entry_speed_sqr = next->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
-                if (entry_speed_sqr < current->max_entry_speed_sqr) {
-                    current->entry_speed_sqr = entry_speed_sqr;
-                } else {
-                    current->entry_speed_sqr = current->max_entry_speed_sqr;
-                }
+        // Compute maximum entry speed decelerating over the current block from its exit speed.
+        if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
+            float entry_speed_sqr = plan_reach_speed_sqr(current, next->entry_speed_sqr);
+            if (entry_speed_sqr < current->max_entry_speed_sqr) {
+                current->entry_speed_sqr = entry_speed_sqr;
+            } else {
+                current->entry_speed_sqr = current->max_entry_speed_sqr;
             }
         }
+        next = current;
     }
-    // Forward Pass: Forward plan the acceleration curve from the planned pointer onward.
-    // Also scans for optimal plan breakpoints and appropriately updates the planned pointer.
-    next        = &block_buffer[block_buffer_planned];  // Begin at buffer planned pointer
-    block_index = plan_next_block_index(block_buffer_planned);
-    while (block_index != block_buffer_head) {
-        current = next;
-        next    = &block_buffer[block_index];
+    return block_index;
+}
+
+// Forward Pass: Forward plan the acceleration curve from block_index up to, not including, end.
+// With move_planned, also scans for optimal plan breakpoints and appropriately updates the planned
+// pointer. Without it, the blocks before block_index have yet to be revisited by the reverse pass,
+// so nothing after them can be known to be optimal.
+static void planner_forward_pass(plan_block_index_t block_index, plan_block_index_t end, bool move_planned) {
+    plan_block_t* next = &block_buffer[block_index];
+    block_index        = plan_next_block_index(block_index);
+    while (block_index != end) {
+        plan_block_t* current = next;
+        next                  = &block_buffer[block_index];
         // Any acceleration detected in the forward pass automatically moves the optimal planned
         // pointer forward, since everything before this is all optimal. In other words, nothing
         // can improve the plan from the buffer tail to the planned pointer by logic.
         if (current->entry_speed_sqr < next->entry_speed_sqr) {
-            entry_speed_sqr = current->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
+            float entry_speed_sqr = plan_reach_speed_sqr(current, current->entry_speed_sqr);
             // If true, current block is full-acceleration and we can move the planned pointer forward.
             if (entry_speed_sqr < next->entry_speed_sqr) {
                 next->entry_speed_sqr = entry_speed_sqr;  // Always <= max_entry_speed_sqr. Backward pass sets this.
-                block_buffer_planned  = block_index;      // Set optimal plan pointer.
+                if (move_planned) {
+                    block_buffer_planned = block_index;  // Set optimal plan pointer.
+                }
             }
         }
         // Any block set at its maximum entry speed also creates an optimal plan up to this
         // point in the buffer. When the plan is bracketed by either the beginning of the
         // buffer and a maximum entry speed or two maximum entry speeds, every block in between
         // cannot logically be further improved. Hence, we don't have to recompute them anymore.
-        if (next->entry_speed_sqr == next->max_entry_speed_sqr) {
+        if (move_planned && next->entry_speed_sqr == next->max_entry_speed_sqr) {
             block_buffer_planned = block_index;
         }
         block_index = plan_next_block_index(block_index);
     }
 }
 
+// Continues the pending reverse pass by up to limit blocks from reverse_resume, and forward plans
+// the blocks it raised. Returns true if that finished it. Blocks above where it continued from are
+// left to the caller.
+static bool planner_resume_pass(int limit) {
+    plan_block_index_t from = reverse_resume;
+    // It plans from exit speeds that new blocks may have raised since it started, so it can only
+    // fall short of the optimal plan, never exceed it.
+    reverse_resume = planner_reverse_pass(from, limit);
+    bool finished  = reverse_resume == block_buffer_planned;
+    planner_forward_pass(reverse_resume, plan_next_block_index(from), finished);
+    if (finished) {
+        recalculate_pending = false;
+        stats.completed++;
+    }
+    return finished;
+}
+
+// Replans after a block has been added, with at most reverse_pass_limit blocks in the reverse pass
+// from the new block. A pass cut short leaves the blocks it did not reach to a reverse pass resumed
+// from reverse_resume, which the following calls continue by up to reverse_pass_limit blocks each,
+// until it reaches the planned pointer. Every block the reverse passes raise is forward planned.
+static void planner_recalculate(int reverse_pass_limit) {
+    // Initialize block index to the last block in the planner buffer.
+    plan_block_index_t block_index = plan_prev_block_index(block_buffer_head);
+    // Bail. Can't do anything with one only one plan-able block.
+    if (block_index == block_buffer_planned) {
+        recalculate_pending = false;
+        reverse_lagged      = false;
+        return;
+    }
+    plan_block_t* current = &block_buffer[block_index];
+    // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
+    current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, plan_reach_speed_sqr(current, 0.0));
+    block_index              = plan_prev_block_index(block_index);
+    if (block_index == block_buffer_tail) {  // Only two plannable blocks in buffer, the first being the tail.
+        st_update_plan_block_parameters();   // Notify stepper to update its current parameters.
+    }
+    plan_block_index_t new_stop = planner_reverse_pass(block_index, reverse_pass_limit - 1);
+    if (new_stop == block_buffer_planned) {
+        // Reverse pass complete, including anything left over from earlier passes.
+        if (recalculate_pending) {
+            recalculate_pending = false;
+            reverse_lagged      = false;
+            stats.completed++;
+        }
+        planner_forward_pass(block_buffer_planned, block_buffer_head, true);
+        return;
+    }
+    if (!recalculate_pending) {
+        recalculate_pending = true;
+        reverse_resume      = new_stop;
+        reverse_lagged      = false;
+        stats.deferred++;
+    } else if (plan_planned_distance(new_stop) <= plan_planned_distance(reverse_resume)) {
+        reverse_resume = new_stop;  // This pass went past where the pending one had got to
+        reverse_lagged = false;
+    } else {
+        reverse_restart = new_stop;  // The blocks in between are left to the next pass
+        reverse_lagged  = true;
+    }
+    // Continue the pending pass, then forward plan what this pass from the head raised. Entry speeds
+    // only ever go up, so the blocks after each stretch stay reachable from it.
+    bool contiguous = reverse_resume == new_stop;
+    bool finished   = planner_resume_pass(reverse_pass_limit);
+    planner_forward_pass(new_stop, block_buffer_head, finished && contiguous);
+}
+
+// Allocates the block buffer on first use. Deep buffers go to PSRAM if there is any. Only the
+// main loop touches planner blocks, never the step ISR, so PSRAM latency is acceptable.
+static void plan_alloc_buffer() {
+    if (block_buffer != NULL) {
+        return;
+    }
+    const size_t size = BLOCK_BUFFER_SIZE * sizeof(plan_block_t);
+    if (BLOCK_BUFFER_SIZE >= PLANNER_PSRAM_MIN_BLOCKS && psramFound()) {
+        block_buffer = (plan_block_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (block_buffer == NULL) {
+        block_buffer = (plan_block_t*)heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (block_buffer == NULL) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Cannot allocate %d planner blocks", BLOCK_BUFFER_SIZE);
+        while (true) {
+            delay(1000);
+        }
+    }
+}
+
 void plan_reset() {
+    StPrepLock lock;
+    plan_alloc_buffer();
     memset(&pl, 0, sizeof(planner_t));  // Clear planner struct
+    memset(&stats, 0, sizeof(plan_stats_t));
     plan_reset_buffer();
 }
 
 void plan_reset_buffer() {
+    StPrepLock lock;
     block_buffer_tail    = 0;
     block_buffer_head    = 0;  // Empty = tail
     next_buffer_head     = 1;  // plan_next_block_index(block_buffer_head)
     block_buffer_planned = 0;  // = block_buffer_tail;
+    recalculate_pending  = false;
+    reverse_lagged       = false;
 }
 
 void plan_discard_current_block() {
     if (block_buffer_head != block_buffer_tail) {  // Discard non-empty buffer.
-        uint8_t block_index = plan_next_block_index(block_buffer_tail);
+        plan_block_index_t block_index = plan_next_block_index(block_buffer_tail);
         // Push block_buffer_planned pointer, if encountered.
         if (block_buffer_tail == block_buffer_planned) {
             block_buffer_planned = block_index;
+            // A pending reverse pass is done once the planned pointer reaches where it got to, as the
+            // blocks it had left have been executed.
+            if (recalculate_pending && block_buffer_planned == reverse_resume) {
+                recalculate_pending = false;
+                stats.completed++;
+            }
         }
         block_buffer_tail = block_index;
     }
@@ -232,7 +366,7 @@ plan_block_t* plan_get_current_block() {
 }
 
 float plan_get_exec_block_exit_speed_sqr() {
-    uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    plan_block_index_t block_index = plan_next_block_index(block_buffer_tail);
     if (block_index == block_buffer_head) {
         return 0.0f;
     }
@@ -264,6 +398,40 @@ float plan_compute_profile_nominal_speed(plan_block_t* block) {
     return MINIMUM_FEED_RATE;
 }
 
+// The time a block with a jerk limit takes to change speed by delta. The acceleration rises at the
+// jerk limit and falls again: a triangle that peaks at sqrt(jerk * delta) for small changes, and a
+// trapezoid that holds the acceleration limit for changes large enough to reach it.
+static float plan_jerk_ramp_time(const plan_block_t* block, float delta) {
+    if (delta * block->jerk < block->acceleration * block->acceleration) {
+        return 2.0f * sqrtf(delta / block->jerk);
+    }
+    return delta / block->acceleration + block->acceleration / block->jerk;
+}
+
+float plan_jerk_ramp_mm(const plan_block_t* block, float speed_0, float speed_1) {
+    return 0.5f * (speed_0 + speed_1) * plan_jerk_ramp_time(block, fabsf(speed_1 - speed_0));
+}
+
+float plan_jerk_ramp_speed(const plan_block_t* block, float speed, float mm) {
+    float accel       = block->acceleration;
+    float delta_limit = accel * accel / block->jerk;  // The largest change a triangle makes
+    float delta;
+    if (mm < (2.0f * speed + delta_limit) * accel / block->jerk) {
+        // A triangle: (2 * speed + delta) * sqrt(delta / jerk) = mm, a cubic in sqrt(delta). Solved by
+        // Cardano's formula, written so that it does not cancel when speed is large.
+        float p = 2.0f * speed / 3.0f;
+        float q = 0.5f * mm * sqrtf(block->jerk);
+        float w = cbrtf(q + sqrtf(q * q + p * p * p));
+        float s = 2.0f * q / (w * w + p + (p / w) * (p / w));
+        delta   = s * s;
+    } else {
+        // A trapezoid: (2 * speed + delta) * (delta + delta_limit) = 2 * mm * accel.
+        float b = 2.0f * speed - delta_limit;
+        delta   = 0.5f * (sqrtf(b * b + 8.0f * mm * accel) - (2.0f * speed + delta_limit));
+    }
+    return speed + delta;
+}
+
 // Computes and updates the max entry speed (sqr) of the block, based on the minimum of the junction's
 // previous and current nominal speeds and max junction speed.
 static void plan_compute_profile_parameters(plan_block_t* block, float nominal_speed, float prev_nominal_speed) {
@@ -281,10 +449,11 @@ static void plan_compute_profile_parameters(plan_block_t* block, float nominal_s
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters() {
-    uint8_t       block_index = block_buffer_tail;
-    plan_block_t* block;
-    float         nominal_speed;
-    float         prev_nominal_speed = SOME_LARGE_VALUE;  // Set high for first block nominal speed calculation.
+    StPrepLock lock;
+    plan_block_index_t block_index = block_buffer_tail;
+    plan_block_t*      block;
+    float              nominal_speed;
+    float              prev_nominal_speed = SOME_LARGE_VALUE;  // Set high for first block nominal speed calculation.
     while (block_index != block_buffer_head) {
         block         = &block_buffer[block_index];
         nominal_speed = plan_compute_profile_nominal_speed(block);
@@ -295,8 +464,8 @@ void plan_update_velocity_profile_parameters() {
     pl.previous_nominal_speed = prev_nominal_speed;  // Update prev nominal speed for next incoming block.
 }
 
-uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
-    // Prepare and initialize new block. Copy relevant pl_data for block execution.
+// Prepares and initializes the block at the buffer head. Copies relevant pl_data for block execution.
+static plan_block_t* plan_init_block(plan_line_data_t* pl_data) {
     plan_block_t* block = &block_buffer[block_buffer_head];
     memset(block, 0, sizeof(plan_block_t));  // Zero all block values.
     block->motion        = pl_data->motion;
@@ -307,43 +476,15 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
 #ifdef USE_LINE_NUMBERS
     block->line_number = pl_data->line_number;
 #endif
-    // Compute and store initial move distance data.
-    int32_t target_steps[MAX_N_AXIS], position_steps[MAX_N_AXIS];
-    float   unit_vec[MAX_N_AXIS], delta_mm;
-    uint8_t idx;
-    // Copy position data based on type of motion being planned.
-    if (block->motion.systemMotion) {
-        memcpy(position_steps, sys_position, sizeof(sys_position));
-    } else {
-        memcpy(position_steps, pl.position, sizeof(pl.position));
-    }
-    auto n_axis = number_axis->get();
-    for (idx = 0; idx < n_axis; idx++) {
-        // Calculate target position in absolute steps, number of steps for each axis, and determine max step events.
-        // Also, compute individual axes distance for move and prep unit vector calculations.
-        // NOTE: Computes true distance from converted step values.
-        target_steps[idx]       = lround(target[idx] * axis_settings[idx]->steps_per_mm->get());
-        block->steps[idx]       = labs(target_steps[idx] - position_steps[idx]);
-        block->step_event_count = MAX(block->step_event_count, block->steps[idx]);
-        delta_mm                = (target_steps[idx] - position_steps[idx]) / axis_settings[idx]->steps_per_mm->get();
-        unit_vec[idx]           = delta_mm;  // Store unit vector numerator
-        // Set direction bits. Bit enabled always means direction is negative.
-        if (delta_mm < 0.0) {
-            block->direction_bits |= bit(idx);
-        }
-    }
-    // Bail if this is a zero-length block. Highly unlikely to occur.
-    if (block->step_event_count == 0) {
-        return PLAN_EMPTY_BLOCK;
-    }
+    return block;
+}
 
-    // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
-    // down such that no individual axes maximum values are exceeded with respect to the line direction.
-    // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
-    // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
-    block->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
-    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec);
-    block->rapid_rate   = limit_rate_by_axis_maximum(unit_vec);
+// Sets the rates and junction speed of a block whose distance and axis limits are known, then adds it
+// to the buffer and replans. unit_vec is the direction the block starts in and exit_unit_vec the
+// one it ends in, which differ for arcs. target_steps is where it ends.
+static void plan_queue_block(plan_block_t* block, plan_line_data_t* pl_data, float* unit_vec, float* exit_unit_vec, int32_t* target_steps) {
+    uint8_t idx;
+    auto    n_axis = number_axis->get();
     // Store programmed rate.
     if (block->motion.rapidMotion) {
         block->programmed_rate = block->rapid_rate;
@@ -353,6 +494,9 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
             block->programmed_rate *= block->millimeters;
         }
     }
+    // Segment prep may discard blocks from here on, and must not see a half added block or a half
+    // planned buffer. The block was set up before this, without holding up segment prep.
+    StPrepLock lock;
     // TODO: Need to check this method handling zero junction speeds when starting from rest.
     if ((block_buffer_head == block_buffer_tail) || (block->motion.systemMotion)) {
         // Initialize block entry speed as zero. Assume it will be starting from rest. Planner will correct this later.
@@ -411,14 +555,134 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         plan_compute_profile_parameters(block, nominal_speed, pl.previous_nominal_speed);
         pl.previous_nominal_speed = nominal_speed;
         // Update previous path unit_vector and planner position.
-        memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec));  // pl.previous_unit_vec[] = unit_vec[]
-        memcpy(pl.position, target_steps, sizeof(target_steps));   // pl.position[] = target_steps[]
+        memcpy(pl.previous_unit_vec, exit_unit_vec, sizeof(pl.previous_unit_vec));  // pl.previous_unit_vec[] = exit_unit_vec[]
+        memcpy(pl.position, target_steps, sizeof(pl.position));                      // pl.position[] = target_steps[]
         // New block is all set. Update buffer head and next buffer head indices.
         block_buffer_head = next_buffer_head;
         next_buffer_head  = plan_next_block_index(block_buffer_head);
         // Finish up by recalculating the plan with the new block.
-        planner_recalculate();
+        stats.recalculations++;
+        planner_recalculate(PLANNER_REVERSE_PASS_LIMIT);
+    }
+}
+
+uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
+    plan_block_t* block = plan_init_block(pl_data);
+    // Compute and store initial move distance data.
+    int32_t target_steps[MAX_N_AXIS], position_steps[MAX_N_AXIS];
+    float   unit_vec[MAX_N_AXIS], delta_mm;
+    uint8_t idx;
+    // Copy position data based on type of motion being planned.
+    if (block->motion.systemMotion) {
+        memcpy(position_steps, sys_position, sizeof(sys_position));
+    } else {
+        memcpy(position_steps, pl.position, sizeof(pl.position));
+    }
+    const axis_limits_t& limits = axis_limits();
+    for (idx = 0; idx < limits.n_axis; idx++) {
+        // Calculate target position in absolute steps, number of steps for each axis, and determine max step events.
+        // Also, compute individual axes distance for move and prep unit vector calculations.
+        // NOTE: Computes true distance from converted step values.
+        target_steps[idx]       = lround(target[idx] * limits.steps_per_mm[idx]);
+        block->steps[idx]       = labs(target_steps[idx] - position_steps[idx]);
+        block->step_event_count = MAX(block->step_event_count, block->steps[idx]);
+        delta_mm                = (target_steps[idx] - position_steps[idx]) / limits.steps_per_mm[idx];
+        unit_vec[idx]           = delta_mm;  // Store unit vector numerator
+        // Set direction bits. Bit enabled always means direction is negative.
+        if (delta_mm < 0.0) {
+            block->direction_bits |= bit(idx);
+        }
+    }
+    // Bail if this is a zero-length block. Highly unlikely to occur.
+    if (block->step_event_count == 0) {
+        return PLAN_EMPTY_BLOCK;
+    }
+
+    // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
+    // down such that no individual axes maximum values are exceeded with respect to the line direction.
+    // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
+    // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
+    block->millimeters = convert_delta_vector_to_unit_vector(unit_vec);
+    limit_by_axis_maximum(unit_vec, &block->acceleration, &block->rapid_rate, &block->jerk);
+    plan_queue_block(block, pl_data, unit_vec, unit_vec, target_steps);
+    return PLAN_OK;
+}
+
+// Largest |sin| of the angles swept from start through start + travel.
+static float arc_max_abs_sin(float start, float travel) {
+    float low  = travel < 0 ? start + travel : start;
+    float high = low + fabs(travel);
+    if (ceil((low - M_PI_2) / M_PI) * M_PI + M_PI_2 <= high) {
+        return 1.0;
     }
+    return MAX(fabs(sin(low)), fabs(sin(high)));
+}
+
+uint8_t plan_buffer_arc(float* target, plan_line_data_t* pl_data, plan_arc_t* arc) {
+    plan_block_t* block     = plan_init_block(pl_data);
+    block->motion.arcMotion = 1;
+
+    int32_t              target_steps[MAX_N_AXIS];
+    uint8_t              idx;
+    const axis_limits_t& limits = axis_limits();
+    for (idx = 0; idx < limits.n_axis; idx++) {
+        target_steps[idx] = lround(target[idx] * limits.steps_per_mm[idx]);
+    }
+    const uint8_t axes[3] = { arc->axis_0, arc->axis_1, arc->axis_linear };
+    for (idx = 0; idx < 3; idx++) {
+        arc->start_steps[idx] = pl.position[axes[idx]];
+        arc->end_steps[idx]   = target_steps[axes[idx]];
+    }
+    float planar_mm = fabs(arc->angular_travel) * arc->radius;
+    arc->length     = sqrt(planar_mm * planar_mm + arc->linear_travel * arc->linear_travel);
+    if (arc->length == 0.0f) {
+        return PLAN_EMPTY_BLOCK;
+    }
+    block->millimeters = arc->length;
+
+    // The tangent turns through the plane, so take the axis limits where it is steepest on each
+    // plane axis. Its share of the linear axis stays the same.
+    float start_angle           = atan2(arc->start[1], arc->start[0]);
+    float limit_vec[MAX_N_AXIS] = { 0.0 };
+    limit_vec[arc->axis_0]      = planar_mm / arc->length * arc_max_abs_sin(start_angle, arc->angular_travel);
+    limit_vec[arc->axis_1]      = planar_mm / arc->length * arc_max_abs_sin(start_angle + M_PI_2, arc->angular_travel);
+    limit_vec[arc->axis_linear] = fabs(arc->linear_travel) / arc->length;
+    limit_by_axis_maximum(limit_vec, &block->acceleration, &block->rapid_rate, &block->jerk);
+
+    // Cap the speed once for the whole arc so that the centripetal acceleration v^2/r stays within
+    // the plane axes' limits. Chords got the same cap piecewise from their junction speeds.
+    float plane_vec[MAX_N_AXIS] = { 0.0 };
+    plane_vec[arc->axis_0]      = 1.0;
+    plane_vec[arc->axis_1]      = 1.0;
+    float centripetal_rate      = sqrt(limit_acceleration_by_axis_maximum(plane_vec) * arc->radius);
+    if (centripetal_rate < block->rapid_rate) {
+        block->rapid_rate = centripetal_rate;
+    }
+
+    // Step segments longer than this would leave the arc by more than arc_tolerance, as mc_arc()
+    // chords would. Scaled up by the helical travel, which does not bend.
+    float tolerance = arc_tolerance->get();
+    if (tolerance < arc->radius) {
+        arc->segment_mm = 2 * sqrt(tolerance * (2 * arc->radius - tolerance)) * arc->length / planar_mm;
+    } else {
+        arc->segment_mm = arc->length;
+    }
+    block->arc = *arc;
+
+    // Tangents at the start and the end for the junctions with the blocks around the arc.
+    float direction = arc->angular_travel > 0 ? 1.0 : -1.0;
+    float scale     = direction * planar_mm / (arc->length * arc->radius);
+    float end_0     = arc->start[0] * cos(arc->angular_travel) - arc->start[1] * sin(arc->angular_travel);
+    float end_1     = arc->start[0] * sin(arc->angular_travel) + arc->start[1] * cos(arc->angular_travel);
+    float entry_vec[MAX_N_AXIS] = { 0.0 };
+    float exit_vec[MAX_N_AXIS]  = { 0.0 };
+    entry_vec[arc->axis_0]      = -scale * arc->start[1];
+    entry_vec[arc->axis_1]      = scale * arc->start[0];
+    entry_vec[arc->axis_linear] = arc->linear_travel / arc->length;
+    exit_vec[arc->axis_0]       = -scale * end_1;
+    exit_vec[arc->axis_1]       = scale * end_0;
+    exit_vec[arc->axis_linear]  = arc->linear_travel / arc->length;
+    plan_queue_block(block, pl_data, entry_vec, exit_vec, target_steps);
     return PLAN_OK;
 }
 
@@ -434,7 +698,7 @@ void plan_sync_position() {
 }
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available() {
+plan_block_index_t plan_get_block_buffer_available() {
     if (block_buffer_head >= block_buffer_tail) {
         return (BLOCK_BUFFER_SIZE - 1) - (block_buffer_head - block_buffer_tail);
     } else {
@@ -444,7 +708,7 @@ uint8_t plan_get_block_buffer_available() {
 
 // Returns the number of active blocks are in the planner buffer.
 // NOTE: Deprecated. Not used unless classic status reports are enabled in config.h
-uint8_t plan_get_block_buffer_count() {
+plan_block_index_t plan_get_block_buffer_count() {
     if (block_buffer_head >= block_buffer_tail) {
         return block_buffer_head - block_buffer_tail;
     } else {
@@ -455,8 +719,34 @@ uint8_t plan_get_block_buffer_count() {
 // Re-initialize buffer plan with a partially completed block, assumed to exist at the buffer tail.
 // Called after a steppers have come to a complete stop for a feed hold and the cycle is stopped.
 void plan_cycle_reinitialize() {
+    StPrepLock lock;
     // Re-plan from a complete stop. Reset planner entry speeds and buffer planned pointer.
     st_update_plan_block_parameters();
     block_buffer_planned = block_buffer_tail;
-    planner_recalculate();
+    planner_recalculate(BLOCK_BUFFER_SIZE);
+}
+
+// Finishes the reverse pass that plan_buffer_line() cut short at PLANNER_REVERSE_PASS_LIMIT, from
+// where the blocks added since left it. Cheap when nothing is pending, so the main loop can call it
+// whenever it has nothing better to do.
+void plan_finish_recalculate() {
+    while (recalculate_pending || reverse_lagged) {
+        StPrepLock lock;  // Taken for PLANNER_REVERSE_PASS_LIMIT blocks at a time, so segment prep can run in between
+        if (recalculate_pending) {
+            planner_resume_pass(PLANNER_REVERSE_PASS_LIMIT);
+        } else {
+            // Blocks above where the last pass started were planned since by passes from the head
+            // that were cut short. With no new block to start a pass over them, start one here.
+            reverse_lagged = false;
+            if (plan_is_unplanned(reverse_restart)) {
+                recalculate_pending = true;
+                reverse_resume      = reverse_restart;
+                stats.deferred++;
+            }
+        }
+    }
+}
+
+plan_stats_t plan_get_stats() {
+    return stats;
 }
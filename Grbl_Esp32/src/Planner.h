@@ -33,6 +33,29 @@
 #    endif
 #endif
 
+// The most blocks the reverse pass of the planner visits when a block is added. The default
+// visits the whole buffer, which gives the best plan, up to 64 blocks. The limit caps the
+// planning time per block, and with it how long segment prep waits for the planner; blocks
+// further back keep their last planned (lower) entry speeds until the next blocks resume the
+// pass, by as many blocks each, or plan_finish_recalculate() completes it from the main loop.
+#ifndef PLANNER_REVERSE_PASS_LIMIT
+#    if BLOCK_BUFFER_SIZE > 64
+#        define PLANNER_REVERSE_PASS_LIMIT 64
+#    else
+#        define PLANNER_REVERSE_PASS_LIMIT BLOCK_BUFFER_SIZE
+#    endif
+#endif
+
+// Index into the planner block ring. Widened automatically for deep buffers.
+#if BLOCK_BUFFER_SIZE > 255
+typedef uint16_t plan_block_index_t;
+#else
+typedef uint8_t plan_block_index_t;
+#endif
+
+static_assert(BLOCK_BUFFER_SIZE >= 2 && BLOCK_BUFFER_SIZE <= 65535, "BLOCK_BUFFER_SIZE must be between 2 and 65535");
+static_assert(PLANNER_REVERSE_PASS_LIMIT >= 2, "PLANNER_REVERSE_PASS_LIMIT must be at least 2");
+
 // Returned status message from planner.
 const int PLAN_OK          = true;
 const int PLAN_EMPTY_BLOCK = false;
@@ -43,8 +66,27 @@ struct PlMotion {
     uint8_t systemMotion : 1;    // Single motion. Circumvents planner state. Used by home/park.
     uint8_t noFeedOverride : 1;  // Motion does not honor feed override.
     uint8_t inverseTime : 1;     // Interprets feed rate value as inverse time when set.
+    uint8_t arcMotion : 1;       // Block follows an arc. Set by plan_buffer_arc().
 };
 
+// Geometry of an arc block. Segment prep steps along the arc itself, so the whole arc takes one
+// planner block. mc_arc() fills in the circle and the planner the rest.
+typedef struct {
+    uint8_t axis_0;          // Axes of the circle plane
+    uint8_t axis_1;
+    uint8_t axis_linear;     // Axis of helical travel
+    float   center[2];       // Circle center on axis_0 and axis_1 (mm)
+    float   start[2];        // Start point relative to the center (mm)
+    float   radius;          // (mm)
+    float   angular_travel;  // Angle from start to end, counterclockwise positive (rad)
+    float   linear_start;    // Start position on axis_linear (mm)
+    float   linear_travel;   // Helical travel on axis_linear (mm)
+    float   length;          // Path length (mm). The block's millimeters count down from here.
+    float   segment_mm;      // Longest step segment whose chord stays within arc_tolerance (mm)
+    int32_t start_steps[3];  // Start and end on axis_0, axis_1 and axis_linear (steps)
+    int32_t end_steps[3];
+} plan_arc_t;
+
 // This struct stores a linear movement of a g-code block motion with its critical "nominal" values
 // are as specified in the source g-code.
 typedef struct {
@@ -68,6 +110,8 @@ typedef struct {
     float max_entry_speed_sqr;  // Maximum allowable entry speed based on the minimum of junction limit and
     //   neighboring nominal speeds with overrides in (mm/min)^2
     float acceleration;  // Axis-limit adjusted line acceleration in (mm/min^2). Does not change.
+    // With a jerk limit, acceleration is the peak of ramps whose lengths plan_jerk_ramp_mm() gives.
+    float jerk;          // Axis-limit adjusted jerk in (mm/min^3). Zero for linear ramps.
     float millimeters;   // The remaining distance for this block to be executed in (mm).
     // NOTE: This value may be altered by stepper algorithm during execution.
 
@@ -79,6 +123,8 @@ typedef struct {
     // Stored spindle speed data used by spindle overrides and resuming methods.
     float spindle_speed;  // Block spindle speed. Copied from pl_line_data.
     //#endif
+
+    plan_arc_t arc;  // Only for arcMotion blocks, whose steps[] and step_event_count are not used
 } plan_block_t;
 
 // Planner data prototype. Must be used when passing new motions to the planner.
@@ -102,6 +148,10 @@ void plan_reset_buffer();  // Reset buffer only.
 // rate is taken to mean "frequency" and would complete the operation in 1/feed_rate minutes.
 uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data);
 
+// Adds an arc from the planner position to target as one block. arc has the circle, as filled in
+// by mc_arc(); the planner completes it. Other axes than the arc's must not move.
+uint8_t plan_buffer_arc(float* target, plan_line_data_t* pl_data, plan_arc_t* arc);
+
 // Called when the current block is no longer needed. Discards the block and makes the memory
 // availible for new blocks.
 void plan_discard_current_block();
@@ -113,7 +163,7 @@ plan_block_t* plan_get_system_motion_block();
 plan_block_t* plan_get_current_block();
 
 // Called periodically by step segment buffer. Mostly used internally by planner.
-uint8_t plan_next_block_index(uint8_t block_index);
+plan_block_index_t plan_next_block_index(plan_block_index_t block_index);
 
 // Called by step segment buffer when computing executing block velocity profile.
 float plan_get_exec_block_exit_speed_sqr();
@@ -121,6 +171,14 @@ float plan_get_exec_block_exit_speed_sqr();
 // Called by main program during planner calculations and step segment buffer during initialization.
 float plan_compute_profile_nominal_speed(plan_block_t* block);
 
+// For a block with a jerk limit, the distance in mm that it takes to change speed between speed_0 and
+// speed_1 (mm/min), either way, with the acceleration rising from zero and falling back to zero.
+float plan_jerk_ramp_mm(const plan_block_t* block, float speed_0, float speed_1);
+
+// For a block with a jerk limit, the highest speed (mm/min) it can reach from speed within mm, which
+// is also the highest speed it can come down from to speed within mm.
+float plan_jerk_ramp_speed(const plan_block_t* block, float speed, float mm);
+
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters();
 
@@ -131,13 +189,25 @@ void plan_sync_position();
 void plan_cycle_reinitialize();
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available();
+plan_block_index_t plan_get_block_buffer_available();
 
 // Returns the number of active blocks are in the planner buffer.
 // NOTE: Deprecated. Not used unless classic status reports are enabled in config.h
-uint8_t plan_get_block_buffer_count();
+plan_block_index_t plan_get_block_buffer_count();
 
 // Returns the status of the block ring buffer. True, if buffer is full.
 uint8_t plan_check_full_buffer();
 
 void plan_get_planner_mpos(float* target);
+
+// Counters for the planner recalculation work. Cleared by plan_reset().
+typedef struct {
+    uint32_t recalculations;  // Recalculations run for new blocks
+    uint32_t deferred;        // Reverse passes left pending at PLANNER_REVERSE_PASS_LIMIT
+    uint32_t completed;       // Of those, how many were later finished
+} plan_stats_t;
+
+// Completes any reverse pass left unfinished by the per-block limit. Called from the main loop when idle.
+void plan_finish_recalculate();
+
+plan_stats_t plan_get_stats();
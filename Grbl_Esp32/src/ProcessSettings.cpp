@@ -317,6 +317,208 @@ Error showState(const char* value, WebUI::AuthenticationLevel auth_level, WebUI:
     grbl_sendf(out->client(), "State 0x%x\r\n", sys.state);
     return Error::Ok;
 }
+Error report_planner_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    plan_stats_t stats = plan_get_stats();
+    grbl_sendf(out->client(),
+               "[MSG: Planner Blocks: %d Recalculations: %u Deferred: %u Completed: %u]\r\n",
+               BLOCK_BUFFER_SIZE,
+               stats.recalculations,
+               stats.deferred,
+               stats.completed);
+    return Error::Ok;
+}
+Error report_path_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    mc_smooth_stats_t stats = mc_get_smooth_stats();
+    grbl_sendf(out->client(),
+               "[MSG: Path Moves: %u Blocks: %u Removed: %u Arcs: %u]\r\n",
+               stats.moves,
+               stats.blocks,
+               stats.moves - stats.blocks,
+               stats.arcs);
+    return Error::Ok;
+}
+#ifdef STEPPER_ISR_STATS
+Error report_step_time(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    MotorsStepTime t = motors_take_step_time();
+    grbl_sendf(out->client(),
+               "[MSG: Step cycles: %u avg %u max, Unstep cycles: %u avg %u max]\r\n",
+               t.steps ? uint32_t(t.step_total / t.steps) : 0,
+               t.step_max,
+               t.unsteps ? uint32_t(t.unstep_total / t.unsteps) : 0,
+               t.unstep_max);
+    return Error::Ok;
+}
+#endif
+// $RX reports the RX credits of the client that sends it as [RX:size,available,freed]; see
+// serial_get_rx_buffer_available(). $RX=ON adds the freed count to its "ok" responses, and $RX=OFF
+// takes it out again.
+Error rx_credits(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    uint8_t client = out->client();
+    if (client >= CLIENT_COUNT) {
+        return Error::InvalidStatement;
+    }
+    if (value) {
+        if (strcasecmp(value, "ON") == 0) {
+            serial_set_rx_acks(client, true);
+        } else if (strcasecmp(value, "OFF") == 0) {
+            serial_set_rx_acks(client, false);
+        } else {
+            return Error::InvalidValue;
+        }
+        return Error::Ok;
+    }
+    grbl_sendf(client, "[RX:%d,%d,%u]\r\n", RX_BUFFER_SIZE, serial_get_rx_buffer_available(client), serial_get_rx_freed(client));
+    return Error::Ok;
+}
+// $TM=ms sends telemetry frames to the client that sends it every ms milliseconds, $TM=ms,C only
+// when something in them changed, and $TM=0 stops them. $TM reports the current setting. ms is
+// 10 to 60000; Telemetry.h lists the clients that can subscribe and the rates they keep up with.
+Error telemetry(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (!value) {
+        telemetry_report(out->client());
+        return Error::Ok;
+    }
+    char*    endptr    = NULL;
+    uint32_t period_ms = strtoul(value, &endptr, 10);
+    bool     on_change = false;
+    if (endptr == value) {
+        return Error::BadNumberFormat;
+    }
+    if (*endptr == ',' && (endptr[1] == 'C' || endptr[1] == 'c') && endptr[2] == '\0') {
+        on_change = true;
+    } else if (*endptr) {
+        return Error::InvalidValue;
+    }
+    return telemetry_subscribe(out->client(), period_ms, on_change);
+}
+// $CS reports how the main loop shared its time between the clients since the last reset, and
+// $CS=R resets it, along with the messages each client lost to a full TX ring since startup.
+// Only clients that sent something or lost output are listed. The websocket frames the WebUI's
+// output went out in since startup follow.
+Error report_client_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    static const char* names[CLIENT_COUNT] = { "Serial", "BT", "WebUI", "Telnet", "Input" };
+    if (value) {
+        if (strcasecmp(value, "R") != 0) {
+            return Error::InvalidValue;
+        }
+        protocol_reset_client_stats();
+        return Error::Ok;
+    }
+    float seconds = protocol_client_stats_time() / 1e6;
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        client_stats_t stats   = protocol_get_client_stats(client);
+        uint32_t       dropped = serial_get_tx_dropped(client);
+        if (stats.lines == 0 && stats.waits == 0 && dropped == 0) {
+            continue;
+        }
+        grbl_sendf(out->client(),
+                   "[MSG: %s lines: %u (%.1f/s) cut short: %u wait: %.2fms avg %.2fms max TX dropped: %u]\r\n",
+                   names[client],
+                   stats.lines,
+                   seconds > 0 ? stats.lines / seconds : 0.0,
+                   stats.cut_short,
+                   stats.waits ? stats.total_wait_us / 1000.0 / stats.waits : 0.0,
+                   stats.max_wait_us / 1000.0,
+                   dropped);
+    }
+#if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
+    uint32_t frames = WebUI::Serial2Socket.framesSent();
+    uint32_t bytes  = WebUI::Serial2Socket.bytesSent();
+    if (frames) {
+        grbl_sendf(out->client(), "[MSG: WebSocket frames: %u bytes: %u (%u/frame)]\r\n", frames, bytes, bytes / frames);
+    }
+#endif
+    return Error::Ok;
+}
+#ifdef STEPPER_ISR_STATS
+// $ISR reports the stepper ISR timing since the last reset, and $ISR=R resets it.
+Error report_isr_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (value) {
+        if (strcasecmp(value, "R") != 0) {
+            return Error::InvalidValue;
+        }
+        st_reset_isr_stats();
+        return Error::Ok;
+    }
+    isr_stats_t stats = st_get_isr_stats();
+    float       mhz   = stats.cycles_per_us;
+    grbl_sendf(out->client(),
+               "[MSG: ISR count: %u min: %.2fus avg: %.2fus max: %.2fus missed: %u underruns: %u]\r\n",
+               stats.count,
+               stats.count ? stats.min_cycles / mhz : 0.0,
+               stats.count ? stats.total_cycles / mhz / stats.count : 0.0,
+               stats.max_cycles / mhz,
+               stats.missed,
+               st_get_segment_underruns());
+    char hist[ISR_HISTOGRAM_BINS * 24];
+    int  len = 0;
+    for (int bin = 0; bin < ISR_HISTOGRAM_BINS; bin++) {
+        if (bin == 0) {
+            len += sprintf(hist + len, " <1us:%u", stats.histogram[bin]);
+        } else if (bin == ISR_HISTOGRAM_BINS - 1) {
+            len += sprintf(hist + len, " >=%dus:%u", 1 << (bin - 1), stats.histogram[bin]);
+        } else {
+            len += sprintf(hist + len, " <%dus:%u", 1 << bin, stats.histogram[bin]);
+        }
+    }
+    grbl_sendf(out->client(), "[MSG: ISR histogram:%s]\r\n", hist);
+    return Error::Ok;
+}
+#endif
+#ifdef REALTIME_LATENCY_STATS
+// $RT reports the latency of realtime commands since the last reset, and $RT=R resets it.
+Error report_rt_latency(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    static const char* cmd_names[]   = { "Hold", "Start", "Reset" };
+    static const char* stage_names[] = { "protocol", "prep", "step" };
+    if (value) {
+        if (strcasecmp(value, "R") != 0) {
+            return Error::InvalidValue;
+        }
+        rt_latency_reset_stats();
+        return Error::Ok;
+    }
+    for (int cmd = 0; cmd < static_cast<int>(RtLatencyCmd::Count); cmd++) {
+        for (int stage = 0; stage < static_cast<int>(RtLatencyStage::Count); stage++) {
+            rt_latency_stats_t stats = rt_latency_get_stats(static_cast<RtLatencyCmd>(cmd), static_cast<RtLatencyStage>(stage));
+            if (stats.count == 0) {
+                continue;
+            }
+            char hist[RT_LATENCY_BINS * 24];
+            int  len = 0;
+            for (int bin = 0; bin < RT_LATENCY_BINS; bin++) {
+                if (stats.histogram[bin] == 0) {
+                    continue;
+                }
+                if (bin == 0) {
+                    len += sprintf(hist + len, " <1us:%u", stats.histogram[bin]);
+                } else if (bin == RT_LATENCY_BINS - 1) {
+                    len += sprintf(hist + len, " >=%dus:%u", 1 << (bin - 1), stats.histogram[bin]);
+                } else {
+                    len += sprintf(hist + len, " <%dus:%u", 1 << bin, stats.histogram[bin]);
+                }
+            }
+            hist[len] = '\0';
+            grbl_sendf(out->client(),
+                       "[MSG: %s to %s count: %u avg: %uus max: %uus%s]\r\n",
+                       cmd_names[cmd],
+                       stage_names[stage],
+                       stats.count,
+                       uint32_t(stats.total_us / stats.count),
+                       stats.max_us,
+                       hist);
+        }
+    }
+    return Error::Ok;
+}
+#endif
+Error report_segment_buffer(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    grbl_sendf(out->client(),
+               "[MSG: Segment buffer: %d of %d Underruns: %u]\r\n",
+               st_get_segment_buffer_size(),
+               SEGMENT_BUFFER_MAX,
+               st_get_segment_underruns());
+    return Error::Ok;
+}
 Error doJog(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
     // For jogging, you must give gc_execute_line() a line that
     // begins with $J=.  There are several ways we can get here,
@@ -425,6 +627,19 @@ void make_grbl_commands() {
     new GrblCommand("X", "Alarm/Disable", disable_alarm_lock, anyState);
     new GrblCommand("NVX", "Settings/Erase", Setting::eraseNVS, idleOrAlarm, WA);
     new GrblCommand("V", "Settings/Stats", Setting::report_nvs_stats, idleOrAlarm);
+    new GrblCommand("PS", "Planner/Stats", report_planner_stats, anyState);
+    new GrblCommand("PT", "GCode/PathStats", report_path_stats, anyState);
+    new GrblCommand("SB", "Stepper/SegmentStats", report_segment_buffer, anyState);
+    new GrblCommand("CS", "Protocol/ClientStats", report_client_stats, anyState);
+    new GrblCommand("RX", "Serial/RxCredits", rx_credits, anyState);
+    new GrblCommand("TM", "Report/Telemetry", telemetry, anyState);
+#ifdef STEPPER_ISR_STATS
+    new GrblCommand("ISR", "Stepper/IsrStats", report_isr_stats, anyState);
+    new GrblCommand("MT", "Motors/StepTime", report_step_time, anyState);
+#endif
+#ifdef REALTIME_LATENCY_STATS
+    new GrblCommand("RT", "Protocol/RealtimeLatency", report_rt_latency, anyState);
+#endif
     new GrblCommand("#", "GCode/Offsets", report_ngc, idleOrAlarm);
     new GrblCommand("H", "Home", home_all, idleOrAlarm);
 #ifdef HOMING_SINGLE_AXIS_COMMANDS
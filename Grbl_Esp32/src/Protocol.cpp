@@ -33,12 +33,29 @@ static uint8_t char_counter         = 0;
 static uint8_t comment_char_counter = 0;
 
 typedef struct {
-    char buffer[LINE_BUFFER_SIZE];
+    char buffer[LINE_BUFFER_SIZE];  // Lines that serial_read_line() cannot hand over in place
     int  len;
     int  line_number;
+    bool copying;  // The line being received is copied into buffer a character at a time
 } client_line_t;
 client_line_t client_lines[CLIENT_COUNT];
 
+// G-code lines read and tokenized by protocol_read_ahead() while an earlier line from the same
+// client waits for room in the planner. They are executed in order before that client is read
+// again. The ring slot of the line being executed stays counted until it is done.
+static gc_tokens_t lookahead_lines[PARSER_LOOKAHEAD_LINES];
+static uint8_t     lookahead_tail;                 // Next line to execute
+static uint8_t     lookahead_count;                // Lines read ahead and not yet executed
+static uint8_t     lookahead_client = CLIENT_ALL;  // Client of the executing g-code line, if any
+static uint8_t     lookahead_limit;                // Lines that may be read ahead without running past the client's quota
+static char*       lookahead_held;                 // A non g-code line that was read ahead. It waits, in place, and stops reading.
+
+static const uint8_t client_priority[CLIENT_COUNT]   = CLIENT_PRIORITY;
+static const uint8_t client_line_quota[CLIENT_COUNT] = CLIENT_LINE_QUOTA;
+static client_stats_t client_stats[CLIENT_COUNT];
+static int64_t        client_stats_start;
+static int64_t        client_turn_end[CLIENT_COUNT];  // When each client's last turn ended
+
 static void empty_line(uint8_t client) {
     client_line_t* cl = &client_lines[client];
     cl->len           = 0;
@@ -47,6 +64,7 @@ static void empty_line(uint8_t client) {
 static void empty_lines() {
     for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
         empty_line(client);
+        client_lines[client].copying = false;
     }
 }
 
@@ -74,6 +92,40 @@ Error add_char_to_line(char c, uint8_t client) {
     return Error::Ok;
 }
 
+// Reads the next line from a client. Returns Error::Eol with line set when a line is complete,
+// Error::Overflow for a line longer than LINE_BUFFER_SIZE, and Error::Ok while there is none.
+// Most lines are taken where they lie in the client's buffer; the rest are copied into
+// client_lines[] by add_char_to_line(). Either way the line is valid until the next
+// serial_release_lines(), and a copied one until the next line is copied.
+static Error read_line(uint8_t client, char** line) {
+    client_line_t* cl = &client_lines[client];
+    if (!cl->copying) {
+        int len = serial_read_line(client, line);
+        if (len >= 0) {
+            cl->line_number++;
+            return Error::Eol;
+        }
+        if (len == SERIAL_LINE_NONE) {
+            return Error::Ok;
+        }
+        cl->copying = true;
+    }
+    uint8_t c;
+    while ((c = serial_read(client)) != SERIAL_NO_DATA) {
+        Error res = add_char_to_line(c, client);
+        if (res == Error::Eol || res == Error::Overflow) {
+            cl->copying = false;
+            *line       = cl->buffer;
+            return res;
+        }
+    }
+    return Error::Ok;
+}
+
+static bool is_gcode_line(const char* line) {
+    return line[0] != 0 && line[0] != '$' && line[0] != '[';
+}
+
 Error execute_line(char* line, uint8_t client, WebUI::AuthenticationLevel auth_level) {
     Error result = Error::Ok;
     // Empty or comment line. For syncing purposes.
@@ -82,6 +134,7 @@ Error execute_line(char* line, uint8_t client, WebUI::AuthenticationLevel auth_l
     }
     // Grbl '$' or WebUI '[ESPxxx]' system command
     if (line[0] == '$' || line[0] == '[') {
+        mc_smooth_flush();  // Settings and commands apply after the motion that came before them
         return system_execute_line(line, client, auth_level);
     }
     // Everything else is gcode. Block if in alarm or jog mode.
@@ -91,6 +144,125 @@ Error execute_line(char* line, uint8_t client, WebUI::AuthenticationLevel auth_l
     return gc_execute_line(line, client);
 }
 
+// Same as execute_line() for a g-code line that has already been tokenized.
+static Error execute_tokens(const gc_tokens_t* tokens, uint8_t client) {
+    if (sys.state == State::Alarm || sys.state == State::Jog) {
+        return Error::SystemGcLock;
+    }
+    return gc_execute_tokens(tokens, client);
+}
+
+void protocol_read_ahead() {
+    uint8_t client = lookahead_client;
+    if (client == CLIENT_ALL || lookahead_held) {
+        return;
+    }
+    while (lookahead_count < lookahead_limit) {
+        gc_tokens_t* tokens = &lookahead_lines[(lookahead_tail + lookahead_count) % PARSER_LOOKAHEAD_LINES];
+        char*        line;
+        switch (read_line(client, &line)) {
+            case Error::Eol:
+#ifdef REPORT_ECHO_RAW_LINE_RECEIVED
+                report_echo_line_received(line, client);
+#endif
+                if (!is_gcode_line(line)) {
+                    lookahead_held = line;
+                    return;
+                }
+                gc_tokenize_line(line, client, tokens);
+                break;
+            case Error::Overflow:
+                // Reported in turn, like any other line
+                tokens->n_words = 0;
+                tokens->status  = Error::Overflow;
+                tokens->jog     = false;
+                break;
+            default:
+                return;
+        }
+        lookahead_count++;
+        empty_line(client);
+        // The executing line was tokenized too, so nothing read so far is needed any more.
+        serial_release_lines(client);
+    }
+}
+
+// True if a client other than this one, or the SD card, has input waiting for its turn.
+static bool others_waiting(uint8_t client) {
+#ifdef ENABLE_SD_CARD
+    if (SD_ready_next) {
+        return true;
+    }
+#endif
+    for (uint8_t other = 0; other < CLIENT_COUNT; other++) {
+        if (other != client && client_buffer[other].available()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// True once a client has used its quota of lines and another one is waiting.
+static bool turn_over(uint8_t client, uint32_t lines) {
+    return lines >= client_line_quota[client] && others_waiting(client);
+}
+
+// Sets how many lines protocol_read_ahead() may hold, counting the executing one if it was read
+// ahead too. While other clients wait, that stops at the end of this client's quota.
+static void limit_read_ahead(uint8_t client, uint32_t lines) {
+    uint32_t quota  = client_line_quota[client];
+    uint32_t room   = lines < quota ? quota - lines : 0;
+    lookahead_limit = PARSER_LOOKAHEAD_LINES;
+    if (room < PARSER_LOOKAHEAD_LINES && others_waiting(client)) {
+        lookahead_limit = room;
+    }
+}
+
+client_stats_t protocol_get_client_stats(uint8_t client) {
+    return client_stats[client];
+}
+
+int64_t protocol_client_stats_time() {
+    return esp_timer_get_time() - client_stats_start;
+}
+
+void protocol_reset_client_stats() {
+    memset(client_stats, 0, sizeof(client_stats));
+    client_stats_start = esp_timer_get_time();
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        client_turn_end[client] = client_stats_start;
+    }
+}
+
+// Starts a client's turn, counting the wait if it has input.
+static void begin_turn(uint8_t client) {
+    if (client_buffer[client].available()) {
+        client_stats_t* stats   = &client_stats[client];
+        uint32_t        wait_us = esp_timer_get_time() - client_turn_end[client];
+        stats->waits++;
+        stats->total_wait_us += wait_us;
+        if (wait_us > stats->max_wait_us) {
+            stats->max_wait_us = wait_us;
+        }
+    }
+}
+
+// Counts a line executed in a client's turn.
+static void count_line(uint8_t client, uint32_t* lines) {
+    (*lines)++;
+    client_stats[client].lines++;
+}
+
+// Ends a client's turn. Returns true if it was cut short with input left over.
+static bool end_turn(uint8_t client, bool cut) {
+    bool more = cut && client_buffer[client].available();
+    if (more) {
+        client_stats[client].cut_short++;
+    }
+    client_turn_end[client] = esp_timer_get_time();
+    return more;
+}
+
 bool can_park() {
     return
 #ifdef ENABLE_PARKING_OVERRIDE_CONTROL
@@ -105,6 +277,10 @@ bool can_park() {
 void protocol_main_loop() {
     serial_reset_read_buffer(CLIENT_ALL);
     empty_lines();
+    lookahead_count  = 0;
+    lookahead_held   = NULL;
+    lookahead_client = CLIENT_ALL;
+    protocol_reset_client_stats();
     //uint8_t client = CLIENT_SERIAL; // default client
     // Perform some machine checks to make sure everything is good to go.
 #ifdef CHECK_LIMITS_AT_INIT
@@ -135,7 +311,6 @@ void protocol_main_loop() {
     // Primary loop! Upon a system abort, this exits back to main() to reset the system.
     // This is also where Grbl idles while waiting for something to do.
     // ---------------------------------------------------------------------------------
-    uint8_t c;
     for (;;) {
 #ifdef ENABLE_SD_CARD
         if (SD_ready_next) {
@@ -154,44 +329,118 @@ void protocol_main_loop() {
         // Receive one line of incoming serial data, as the data becomes available.
         // Filtering, if necessary, is done later in gc_execute_line(), so the
         // filtering is the same with serial and file input.
-        uint8_t client = CLIENT_SERIAL;
-        char*   line;
-        for (client = 0; client < CLIENT_COUNT; client++) {
-            while ((c = serial_read(client)) != SERIAL_NO_DATA) {
-                Error res = add_char_to_line(c, client);
+        char* line;
+        bool  more_input = false;  // A client's turn ended at its quota
+        for (uint8_t turn = 0; turn < CLIENT_COUNT; turn++) {
+            uint8_t  client = client_priority[turn];
+            uint32_t lines  = 0;
+            bool     cut    = false;
+            begin_turn(client);
+            for (;;) {
+                // Lines read ahead while the previous one executed go first. Executing them
+                // reads further ahead, so the pipeline keeps going while the planner is full.
+                if (lookahead_count) {
+                    protocol_execute_realtime();  // Runtime command check point.
+                    if (sys.abort) {
+                        return;  // Bail to calling function upon system abort
+                    }
+                    lookahead_client = client;
+                    limit_read_ahead(client, lines);
+                    Error status     = execute_tokens(&lookahead_lines[lookahead_tail], client);
+                    lookahead_client = CLIENT_ALL;
+                    lookahead_tail   = (lookahead_tail + 1) % PARSER_LOOKAHEAD_LINES;
+                    lookahead_count--;
+                    count_line(client, &lines);
+                    if (!lookahead_held) {
+                        serial_release_lines(client);
+                    }
+                    report_status_message(status, client);
+                    continue;
+                }
+                if (lookahead_held) {
+                    protocol_execute_realtime();  // Runtime command check point.
+                    if (sys.abort) {
+                        return;  // Bail to calling function upon system abort
+                    }
+                    line           = lookahead_held;
+                    lookahead_held = NULL;
+                    Error status   = execute_line(line, client, WebUI::AuthenticationLevel::LEVEL_GUEST);
+                    empty_line(client);
+                    serial_release_lines(client);
+                    count_line(client, &lines);
+                    report_status_message(status, client);
+                    continue;
+                }
+                if (turn_over(client, lines)) {
+                    cut = true;
+                    break;  // Let the others have a turn
+                }
+                Error res = read_line(client, &line);
+                if (res == Error::Ok) {
+                    break;  // No complete line yet
+                }
+                Error status;
                 switch (res) {
-                    case Error::Ok:
-                        break;
                     case Error::Eol:
                         protocol_execute_realtime();  // Runtime command check point.
                         if (sys.abort) {
                             return;  // Bail to calling function upon system abort
                         }
-                        line = client_lines[client].buffer;
 #ifdef REPORT_ECHO_RAW_LINE_RECEIVED
                         report_echo_line_received(line, client);
 #endif
+                        // A g-code line is tokenized before it executes, so its buffer can take the
+                        // lines read ahead while it waits for the planner.
+                        if (is_gcode_line(line)) {
+                            lookahead_client = client;
+                            limit_read_ahead(client, lines + 1);
+                        }
                         // auth_level can be upgraded by supplying a password on the command line
-                        report_status_message(execute_line(line, client, WebUI::AuthenticationLevel::LEVEL_GUEST), client);
-                        empty_line(client);
+                        status           = execute_line(line, client, WebUI::AuthenticationLevel::LEVEL_GUEST);
+                        lookahead_client = CLIENT_ALL;
+                        if (!lookahead_held) {
+                            if (client_lines[client].len == 0) {
+                                empty_line(client);  // Unless it holds a line read ahead
+                            }
+                            serial_release_lines(client);
+                        }
+                        // Answered once its space is free, so that "ok:<freed>" counts the line
+                        report_status_message(status, client);
                         break;
                     case Error::Overflow:
-                        report_status_message(Error::Overflow, client);
                         empty_line(client);
+                        serial_release_lines(client);
+                        report_status_message(Error::Overflow, client);
                         break;
                     default:
                         break;
                 }
+                count_line(client, &lines);
             }  // while serial read
-        }      // for clients
+            more_input |= end_turn(client, cut);
+        }  // for clients
         // If there are no more characters in the serial read buffer to be processed and executed,
         // this indicates that g-code streaming has either filled the planner buffer or has
         // completed. In either case, auto-cycle start, if enabled, any queued moves.
-        protocol_auto_cycle_start();
+        // A pass that ended a turn at its quota goes straight on to the next one. Moves held back for
+        // path smoothing are sent once no line has come to join them for a while.
+        if (!more_input) {
+#ifdef ENABLE_SD_CARD
+            if (!SD_ready_next) {  // Unless a file has its next line ready
+                mc_smooth_idle();
+            }
+#else
+            mc_smooth_idle();
+#endif
+            protocol_auto_cycle_start();
+        }
         protocol_execute_realtime();  // Runtime command check point.
         if (sys.abort) {
             return;  // Bail to main() program loop to reset system.
         }
+        if (!more_input) {
+            plan_finish_recalculate();  // Nothing left to parse. Finish any deferred planning.
+        }
         // check to see if we should disable the stepper drivers ... esp32 work around for disable in main loop.
         if (stepper_idle) {
             if (esp_timer_get_time() > stepper_idle_counter) {
@@ -205,6 +454,7 @@ void protocol_main_loop() {
 // Block until all buffered steps are executed or in a cycle state. Works with feed hold
 // during a synchronize call, if it should happen. Also, waits for clean cycle end.
 void protocol_buffer_synchronize() {
+    mc_smooth_flush();
     // If system is queued, ensure cycle resumes if the auto start flag is present.
     protocol_auto_cycle_start();
     do {
@@ -270,11 +520,15 @@ void protocol_exec_rt_system() {
         }
         sys_rt_exec_alarm = ExecAlarm::None;
     }
+    telemetry_poll();
     ExecState rt_exec_state;
     rt_exec_state.value = sys_rt_exec_state.value;  // Copy volatile sys_rt_exec_state.
     if (rt_exec_state.value != 0 || cycle_stop) {                 // Test if any bits are on
         // Execute system abort.
         if (rt_exec_state.bit.reset) {
+#ifdef REALTIME_LATENCY_STATS
+            rt_latency_reached(RtLatencyCmd::Reset, RtLatencyStage::Protocol);
+#endif
             sys.abort = true;  // Only place this is set true.
             return;            // Nothing else to do but exit.
         }
@@ -286,6 +540,9 @@ void protocol_exec_rt_system() {
         // NOTE: Once hold is initiated, the system immediately enters a suspend state to block all
         // main program processes until either reset or resumed. This ensures a hold completes safely.
         if (rt_exec_state.bit.motionCancel || rt_exec_state.bit.feedHold || rt_exec_state.bit.safetyDoor || rt_exec_state.bit.sleep) {
+#ifdef REALTIME_LATENCY_STATS
+            rt_latency_reached(RtLatencyCmd::FeedHold, RtLatencyStage::Protocol);
+#endif
             // State check for allowable states for hold methods.
             if (!(sys.state == State::Alarm || sys.state == State::CheckMode)) {
                 // If in CYCLE or JOG states, immediately initiate a motion HOLD.
@@ -370,9 +627,17 @@ void protocol_exec_rt_system() {
                 sys.state                   = State::Sleep;
                 sys_rt_exec_state.bit.sleep = false;
             }
+#ifdef REALTIME_LATENCY_STATS
+            if (!sys.step_control.executeHold) {
+                rt_latency_dropped(RtLatencyCmd::FeedHold);  // Nothing was moving, so nothing decelerates
+            }
+#endif
         }
         // Execute a cycle start by starting the stepper interrupt to begin executing the blocks in queue.
         if (rt_exec_state.bit.cycleStart) {
+#ifdef REALTIME_LATENCY_STATS
+            rt_latency_reached(RtLatencyCmd::CycleStart, RtLatencyStage::Protocol);
+#endif
             // Block if called at same time as the hold commands: feed hold, motion cancel, and safety door.
             // Ensures auto-cycle-start doesn't resume a hold without an explicit user-input.
             if (!(rt_exec_state.bit.feedHold || rt_exec_state.bit.motionCancel || rt_exec_state.bit.safetyDoor)) {
@@ -411,6 +676,9 @@ void protocol_exec_rt_system() {
             sys_rt_exec_state.bit.cycleStart = false;
         }
         if (cycle_stop) {
+#ifdef REALTIME_LATENCY_STATS
+            rt_latency_dropped(RtLatencyCmd::FeedHold);  // In case the hold ended without a segment to time
+#endif
             // Reinitializes the cycle plan and stepper system after a feed hold for a resume. Called by
             // realtime command execution in the main program, ensuring that the planner re-plans safely.
             // NOTE: Bresenham algorithm variables are still maintained through both the planner and stepper
@@ -430,6 +698,7 @@ void protocol_exec_rt_system() {
                 // Motion complete. Includes CYCLE/JOG/HOMING states and jog cancel/motion cancel/soft limit events.
                 // NOTE: Motion and jog cancel both immediately return to idle after the hold completes.
                 if (sys.suspend.bit.jogCancel) {  // For jog cancel, flush buffers and sync positions.
+                    StPrepLock lock;              // Segment prep must not run between the resets
                     sys.step_control = {};
                     plan_reset();
                     st_reset();
@@ -34,6 +34,33 @@
 #    define LINE_BUFFER_SIZE 256
 #endif
 
+// Number of g-code lines that can be read and tokenized ahead of the executing line, while it
+// waits for room in the planner.
+#ifndef PARSER_LOOKAHEAD_LINES
+#    define PARSER_LOOKAHEAD_LINES 8
+#endif
+
+// The main loop serves the clients in turn, in the order of CLIENT_PRIORITY. A turn ends when
+// the client has no complete line left, or when it has executed its quota of lines while others
+// wait, so that a client streaming a job cannot keep them waiting. Quotas are indexed by client
+// number.
+#ifndef CLIENT_PRIORITY
+#    define CLIENT_PRIORITY { CLIENT_SERIAL, CLIENT_TELNET, CLIENT_BT, CLIENT_WEBUI, CLIENT_INPUT }
+#endif
+#ifndef CLIENT_LINE_QUOTA
+#    define CLIENT_LINE_QUOTA { 32, 32, 8, 32, 32 }  // Serial, BT, WebUI, Telnet, Input
+#endif
+
+// Per-client counts of the main loop scheduler, since the last reset. A client waits from the end
+// of one turn to the start of the next one that finds input for it.
+typedef struct {
+    uint32_t lines;      // Lines executed
+    uint32_t cut_short;  // Turns ended by the quota with input still waiting
+    uint32_t waits;      // Turns that found input waiting
+    uint32_t max_wait_us;
+    uint64_t total_wait_us;
+} client_stats_t;
+
 // Starts Grbl main loop. It handles all incoming characters from the serial port and executes
 // them as they complete. It is also responsible for finishing the initialization procedures.
 void protocol_main_loop();
@@ -48,5 +75,13 @@ void protocol_auto_cycle_start();
 // Block until all buffered steps are executed
 void protocol_buffer_synchronize();
 
+// Reads and tokenizes the lines that follow the executing g-code line from its client.
+void protocol_read_ahead();
+
+// Scheduler statistics of a client, and the time in microseconds they have been collected for.
+client_stats_t protocol_get_client_stats(uint8_t client);
+int64_t        protocol_client_stats_time();
+void           protocol_reset_client_stats();
+
 // Executes the auto cycle feature, if enabled.
 void protocol_auto_cycle_start();
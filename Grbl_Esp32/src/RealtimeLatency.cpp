@@ -0,0 +1,106 @@
+/*
+  RealtimeLatency.cpp - time from a realtime command's arrival to its effect
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+#ifdef REALTIME_LATENCY_STATS
+
+static const int N_CMDS   = static_cast<int>(RtLatencyCmd::Count);
+static const int N_STAGES = static_cast<int>(RtLatencyStage::Count);
+
+static constexpr uint8_t stage_bit(RtLatencyStage stage) {
+    return 1 << static_cast<int>(stage);
+}
+
+// Stages each command is timed to
+static const uint8_t cmd_stages[N_CMDS] = {
+    stage_bit(RtLatencyStage::Protocol) | stage_bit(RtLatencyStage::Prep) | stage_bit(RtLatencyStage::Step),  // FeedHold
+    stage_bit(RtLatencyStage::Protocol),                                                                      // CycleStart
+    stage_bit(RtLatencyStage::Protocol),                                                                      // Reset
+};
+
+// Commands arrive in serialCheckTask and reach their stages in the protocol loop and the stepper
+// ISR, so everything here is under the spinlock.
+static portMUX_TYPE       rt_latency_mux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t            arrived_us[N_CMDS];
+static uint8_t            pending[N_CMDS];  // Stages not reached yet
+static rt_latency_stats_t stats[N_CMDS][N_STAGES];
+
+void rt_latency_arrived(RtLatencyCmd cmd) {
+    int     c   = static_cast<int>(cmd);
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&rt_latency_mux);
+    if (!pending[c]) {
+        arrived_us[c] = now;
+        pending[c]    = cmd_stages[c];
+    }
+    portEXIT_CRITICAL(&rt_latency_mux);
+}
+
+// Called with the spinlock held.
+static bool IRAM_ATTR rt_latency_record(int c, int stage) {
+    if (!bit_istrue(pending[c], bit(stage))) {
+        return false;
+    }
+    pending[c] &= ~bit(stage);
+    uint32_t            us = esp_timer_get_time() - arrived_us[c];
+    rt_latency_stats_t& s  = stats[c][stage];
+    s.count++;
+    s.total_us += us;
+    if (us > s.max_us) {
+        s.max_us = us;
+    }
+    int bin = us ? 32 - __builtin_clz(us) : 0;
+    s.histogram[bin < RT_LATENCY_BINS ? bin : RT_LATENCY_BINS - 1]++;
+    return true;
+}
+
+bool rt_latency_reached(RtLatencyCmd cmd, RtLatencyStage stage) {
+    portENTER_CRITICAL(&rt_latency_mux);
+    bool recorded = rt_latency_record(static_cast<int>(cmd), static_cast<int>(stage));
+    portEXIT_CRITICAL(&rt_latency_mux);
+    return recorded;
+}
+
+bool IRAM_ATTR rt_latency_reached_isr(RtLatencyCmd cmd, RtLatencyStage stage) {
+    portENTER_CRITICAL_ISR(&rt_latency_mux);
+    bool recorded = rt_latency_record(static_cast<int>(cmd), static_cast<int>(stage));
+    portEXIT_CRITICAL_ISR(&rt_latency_mux);
+    return recorded;
+}
+
+void rt_latency_dropped(RtLatencyCmd cmd) {
+    portENTER_CRITICAL(&rt_latency_mux);
+    pending[static_cast<int>(cmd)] = 0;
+    portEXIT_CRITICAL(&rt_latency_mux);
+}
+
+rt_latency_stats_t rt_latency_get_stats(RtLatencyCmd cmd, RtLatencyStage stage) {
+    portENTER_CRITICAL(&rt_latency_mux);
+    rt_latency_stats_t s = stats[static_cast<int>(cmd)][static_cast<int>(stage)];
+    portEXIT_CRITICAL(&rt_latency_mux);
+    return s;
+}
+
+void rt_latency_reset_stats() {
+    portENTER_CRITICAL(&rt_latency_mux);
+    memset(stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&rt_latency_mux);
+}
+
+#endif
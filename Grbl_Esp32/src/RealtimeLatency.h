@@ -0,0 +1,62 @@
+#pragma once
+
+/*
+  RealtimeLatency.h - time from a realtime command's arrival to its effect
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef REALTIME_LATENCY_STATS
+// Commands that are timed. A command that arrives while the previous one of its kind is still on
+// its way is not timed separately.
+enum class RtLatencyCmd : uint8_t {
+    FeedHold = 0,  // Feed hold, safety door and jog cancel, which all stop motion with a hold
+    CycleStart,
+    Reset,
+    Count,
+};
+
+// Where a command's latency is taken. Only feed holds go past Protocol.
+enum class RtLatencyStage : uint8_t {
+    Protocol = 0,  // protocol_exec_rt_system() acted on it
+    Prep,          // Segment prep queued the first decelerating segment
+    Step,          // The stepper ISR started executing that segment
+    Count,
+};
+
+// Latencies in microseconds. Histogram bin 0 counts latencies shorter than 1us, bin n those
+// from 2^(n-1) up to 2^n us, and the last bin everything longer.
+const int RT_LATENCY_BINS = 20;
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t histogram[RT_LATENCY_BINS];
+} rt_latency_stats_t;
+
+// Notes the arrival time of a command. Called where realtime characters are taken in.
+void rt_latency_arrived(RtLatencyCmd cmd);
+
+// Records the latency to stage if the command is on its way and has not reached stage yet, and
+// returns whether it did. The _isr version is for the stepper ISR.
+bool rt_latency_reached(RtLatencyCmd cmd, RtLatencyStage stage);
+bool rt_latency_reached_isr(RtLatencyCmd cmd, RtLatencyStage stage);
+
+// Stops timing a command whose later stages will not happen, such as a feed hold while idle.
+void rt_latency_dropped(RtLatencyCmd cmd);
+
+rt_latency_stats_t rt_latency_get_stats(RtLatencyCmd cmd, RtLatencyStage stage);
+void               rt_latency_reset_stats();
+#endif
@@ -47,37 +47,47 @@
 */
 
 #include "Grbl.h"
+#include <atomic>
 #include <map>
 
 #ifdef REPORT_HEAP
 EspClass esp;
 #endif
-const int DEFAULTBUFFERSIZE = 64;
+
+// Messages are formatted on the stack, so sending never allocates. This fits a startup line
+// echoed back with its "$Nn=" and line end; anything longer is truncated.
+static const int SEND_BUFFER_SIZE = LINE_BUFFER_SIZE + 32;
 
 // this is a generic send function that everything should use, so interfaces could be added (Bluetooth, etc)
 void grbl_send(uint8_t client, const char* text) {
     if (client == CLIENT_INPUT) {
         return;
     }
-#ifdef ENABLE_BLUETOOTH
-    if (WebUI::SerialBT.hasClient() && (client == CLIENT_BT || client == CLIENT_ALL)) {
-        WebUI::SerialBT.print(text);
-        //delay(10); // possible fix for dropped characters
-    }
-#endif
-#if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
-    if (client == CLIENT_WEBUI || client == CLIENT_ALL) {
-        WebUI::Serial2Socket.write((const uint8_t*)text, strlen(text));
-    }
-#endif
-#if defined(ENABLE_WIFI) && defined(ENABLE_TELNET)
-    if (client == CLIENT_TELNET || client == CLIENT_ALL) {
-        WebUI::telnet_server.write((const uint8_t*)text, strlen(text));
-    }
-#endif
-    if (client == CLIENT_SERIAL || client == CLIENT_ALL) {
-        Serial.print(text);
+    serial_send(client, text, strlen(text));
+}
+
+// Formats prefix, format and suffix into buffer. A message too long for it is cut short, but
+// keeps the line end format finishes with, if any, so the next message still starts a new line.
+static void format_message(char* buffer, size_t size, const char* prefix, const char* suffix, const char* format, va_list arg) {
+    size_t prefix_len = strlen(prefix);
+    size_t suffix_len = strlen(suffix);
+    size_t room       = size - prefix_len - suffix_len;
+    int    len        = vsnprintf(buffer + prefix_len, room, format, arg);
+    if (len < 0) {
+        len = 0;
+    } else if (size_t(len) >= room) {
+        size_t      format_len = strlen(format);
+        const char* line_end   = format + format_len;
+        if (format_len >= 1 && format[format_len - 1] == '\n') {
+            line_end -= (format_len >= 2 && format[format_len - 2] == '\r') ? 2 : 1;
+        }
+        size_t line_end_len = format + format_len - line_end;
+        len                 = room - 1 - line_end_len;
+        memcpy(buffer + prefix_len + len, line_end, line_end_len);
+        len += line_end_len;
     }
+    memcpy(buffer, prefix, prefix_len);
+    strcpy(buffer + prefix_len + len, suffix);
 }
 
 // This is a formating version of the grbl_send(CLIENT_ALL,...) function that work like printf
@@ -85,26 +95,12 @@ void grbl_sendf(uint8_t client, const char* format, ...) {
     if (client == CLIENT_INPUT) {
         return;
     }
-    char    loc_buf[64];
-    char*   temp = loc_buf;
+    char    loc_buf[SEND_BUFFER_SIZE];
     va_list arg;
-    va_list copy;
     va_start(arg, format);
-    va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
-    va_end(copy);
-    if (len >= sizeof(loc_buf)) {
-        temp = new char[len + 1];
-        if (temp == NULL) {
-            return;
-        }
-    }
-    len = vsnprintf(temp, len + 1, format, arg);
-    grbl_send(client, temp);
+    format_message(loc_buf, sizeof(loc_buf), "", "", format, arg);
     va_end(arg);
-    if (temp != loc_buf) {
-        delete[] temp;
-    }
+    grbl_send(client, loc_buf);
 }
 // Use to send [MSG:xxxx] Type messages. The level allows messages to be easily suppressed
 void grbl_msg_sendf(uint8_t client, MsgLevel level, const char* format, ...) {
@@ -114,26 +110,12 @@ void grbl_msg_sendf(uint8_t client, MsgLevel level, const char* format, ...) {
     if (level > GRBL_MSG_LEVEL) {
         return;
     }
-    char    loc_buf[100];
-    char*   temp = loc_buf;
+    char    loc_buf[SEND_BUFFER_SIZE];
     va_list arg;
-    va_list copy;
     va_start(arg, format);
-    va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
-    va_end(copy);
-    if (len >= sizeof(loc_buf)) {
-        temp = new char[len + 1];
-        if (temp == NULL) {
-            return;
-        }
-    }
-    len = vsnprintf(temp, len + 1, format, arg);
-    grbl_sendf(client, "[MSG:%s]\r\n", temp);
+    format_message(loc_buf, sizeof(loc_buf), "[MSG:", "]\r\n", format, arg);
     va_end(arg);
-    if (temp != loc_buf) {
-        delete[] temp;
-    }
+    grbl_send(client, loc_buf);
 }
 
 //function to notify
@@ -150,7 +132,7 @@ void grbl_notifyf(const char* title, const char* format, ...) {
     va_list copy;
     va_start(arg, format);
     va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
+    size_t len = vsnprintf(NULL, 0, format, copy);
     va_end(copy);
     if (len >= sizeof(loc_buf)) {
         temp = new char[len + 1];
@@ -169,28 +151,31 @@ void grbl_notifyf(const char* title, const char* format, ...) {
 static const int coordStringLen = 20;
 static const int axesStringLen  = coordStringLen * MAX_N_AXIS;
 
-// formats axis values into a string and returns that string in rpt
-// NOTE: rpt should have at least size: axesStringLen
-static void report_util_axis_values(float* axis_value, char* rpt) {
-    uint8_t     idx;
-    char        axisVal[coordStringLen];
-    float       unit_conv = 1.0;      // unit conversion multiplier..default is mm
-    const char* format    = "%4.3f";  // Default - report mm to 3 decimal places
-    rpt[0]                = '\0';
+// formats axis values into rpt
+static void report_util_axis_values(const float* axis_value, ReportWriter& rpt) {
+    uint8_t idx;
+    float   unit_conv = 1.0;  // unit conversion multiplier..default is mm
+    int     decimals  = 3;    // Default - report mm to 3 decimal places
     if (report_inches->get()) {
         unit_conv = 1.0 / MM_PER_INCH;
-        format    = "%4.4f";  // Report inches to 4 decimal places
+        decimals  = 4;  // Report inches to 4 decimal places
     }
     auto n_axis = number_axis->get();
     for (idx = 0; idx < n_axis; idx++) {
-        snprintf(axisVal, coordStringLen - 1, format, axis_value[idx] * unit_conv);
-        strcat(rpt, axisVal);
-        if (idx < (number_axis->get() - 1)) {
-            strcat(rpt, ",");
+        if (idx > 0) {
+            rpt.add(',');
         }
+        rpt.addFloat(axis_value[idx] * unit_conv, decimals);
     }
 }
 
+// formats axis values into a string and returns that string in rpt
+// NOTE: rpt should have at least size: axesStringLen
+static void report_util_axis_values(float* axis_value, char* rpt) {
+    ReportWriter writer(rpt, axesStringLen);
+    report_util_axis_values(axis_value, writer);
+}
+
 // This version returns the axis values as a String
 static String report_util_axis_values(const float* axis_value) {
     String  rpt = "";
@@ -218,6 +203,15 @@ static String report_util_axis_values(const float* axis_value) {
 // operation. Errors events can originate from the g-code parser, settings module, or asynchronously
 // from a critical error, such as a triggered hard limit. Interface should always monitor for these
 // responses.
+// "ok", with the client's freed byte count if it asked for it with $RX=ON.
+static void report_ok(uint8_t client) {
+    if (serial_get_rx_acks(client)) {
+        grbl_sendf(client, "ok:%u\r\n", serial_get_rx_freed(client));
+    } else {
+        grbl_send(client, "ok\r\n");
+    }
+}
+
 void report_status_message(Error status_code, uint8_t client) {
     switch (status_code) {
         case Error::Ok:  // Error::Ok
@@ -225,10 +219,10 @@ void report_status_message(Error status_code, uint8_t client) {
             if (get_sd_state(false) == SDCARD_BUSY_PRINTING) {
                 SD_ready_next = true;  // flag so system_execute_line() will send the next line
             } else {
-                grbl_send(client, "ok\r\n");
+                report_ok(client);
             }
 #else
-            grbl_send(client, "ok\r\n");
+            report_ok(client);
 #endif
             break;
         default:
@@ -583,6 +577,95 @@ void report_echo_line_received(char* line, uint8_t client) {
     grbl_sendf(client, "[echo: %s]\r\n", line);
 }
 
+// Status report fields that rarely change are kept formatted along with the values they show,
+// and only formatted again when those change. serialCheckTask and the protocol loop may both
+// be building a report; the one that finds the cache taken formats its fields itself.
+struct StatusCache {
+    float        wco[MAX_N_AXIS];
+    bool         wco_inches;
+    uint8_t      wco_n_axis;
+    char         wco_text[axesStringLen];
+    size_t       wco_length;  // 0 until first formatted
+    Percent      f_override;
+    Percent      r_override;
+    Percent      spindle_speed_ovr;
+    SpindleState spindle;
+    CoolantState coolant;
+    char         ovr_text[32];
+    size_t       ovr_length;  // 0 until first formatted
+};
+static StatusCache      status_cache;
+static std::atomic_flag status_cache_busy = ATOMIC_FLAG_INIT;
+
+static void report_util_wco(ReportWriter& rpt, const float* wco, bool use_cache) {
+    rpt.add("|WCO:");
+    if (!use_cache) {
+        report_util_axis_values(wco, rpt);
+        return;
+    }
+    StatusCache& cache  = status_cache;
+    bool         inches = report_inches->get();
+    auto         n_axis = number_axis->get();
+    if (cache.wco_length == 0 || inches != cache.wco_inches || n_axis != cache.wco_n_axis ||
+        memcmp(wco, cache.wco, n_axis * sizeof(float)) != 0) {
+        memcpy(cache.wco, wco, n_axis * sizeof(float));
+        cache.wco_inches = inches;
+        cache.wco_n_axis = n_axis;
+        ReportWriter text(cache.wco_text, sizeof(cache.wco_text));
+        report_util_axis_values(wco, text);
+        cache.wco_length = text.length();
+    }
+    rpt.add(cache.wco_text, cache.wco_length);
+}
+
+static void report_util_overrides(ReportWriter& rpt, SpindleState sp_state, CoolantState coolant) {
+    rpt.add("|Ov:").addInt(sys.f_override).add(',').addInt(sys.r_override).add(',').addInt(sys.spindle_speed_ovr);
+    if (sp_state != SpindleState::Disable || coolant.Mist || coolant.Flood) {
+        rpt.add("|A:");
+        switch (sp_state) {
+            case SpindleState::Disable:
+                break;
+            case SpindleState::Cw:
+                rpt.add('S');
+                break;
+            case SpindleState::Ccw:
+                rpt.add('C');
+                break;
+        }
+        if (coolant.Flood) {
+            rpt.add('F');
+        }
+#ifdef COOLANT_MIST_PIN  // TODO Deal with M8 - Flood
+        if (coolant.Mist) {
+            rpt.add('M');
+        }
+#endif
+    }
+}
+
+static void report_util_overrides(ReportWriter& rpt, bool use_cache) {
+    SpindleState sp_state      = spindle->get_state();
+    CoolantState coolant_state = coolant_get_state();
+    if (!use_cache) {
+        report_util_overrides(rpt, sp_state, coolant_state);
+        return;
+    }
+    StatusCache& cache = status_cache;
+    if (cache.ovr_length == 0 || sys.f_override != cache.f_override || sys.r_override != cache.r_override ||
+        sys.spindle_speed_ovr != cache.spindle_speed_ovr || sp_state != cache.spindle || coolant_state.Mist != cache.coolant.Mist ||
+        coolant_state.Flood != cache.coolant.Flood) {
+        cache.f_override        = sys.f_override;
+        cache.r_override        = sys.r_override;
+        cache.spindle_speed_ovr = sys.spindle_speed_ovr;
+        cache.spindle           = sp_state;
+        cache.coolant           = coolant_state;
+        ReportWriter text(cache.ovr_text, sizeof(cache.ovr_text));
+        report_util_overrides(text, sp_state, coolant_state);
+        cache.ovr_length = text.length();
+    }
+    rpt.add(cache.ovr_text, cache.ovr_length);
+}
+
 // Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram
 // and the actual location of the CNC machine. Users may change the following function to their
 // specific needs, but the desired real-time data report must be as short as possible. This is
@@ -592,52 +675,53 @@ void report_realtime_status(uint8_t client) {
     uint8_t idx;
     int32_t current_position[MAX_N_AXIS];  // Copy current state of the system position variable
     memcpy(current_position, sys_position, sizeof(sys_position));
-    float print_position[MAX_N_AXIS];
-    char  status[200];
-    char  temp[MAX_N_AXIS * 20];
+    float        print_position[MAX_N_AXIS];
+    char         status[200];
+    ReportWriter rpt(status, sizeof(status));
+    bool         use_cache = !status_cache_busy.test_and_set(std::memory_order_acquire);
     system_convert_array_steps_to_mpos(print_position, current_position);
     // Report current machine state and sub-states
-    strcpy(status, "<");
+    rpt.add('<');
     switch (sys.state) {
         case State::Idle:
-            strcat(status, "Idle");
+            rpt.add("Idle");
             break;
         case State::Cycle:
-            strcat(status, "Run");
+            rpt.add("Run");
             break;
         case State::Hold:
             if (!(sys.suspend.bit.jogCancel)) {
-                strcat(status, "Hold:");
-                strcat(status, sys.suspend.bit.holdComplete ? "0" : "1");  // Ready to resume
+                rpt.add("Hold:");
+                rpt.add(sys.suspend.bit.holdComplete ? '0' : '1');  // Ready to resume
                 break;
             }  // Continues to print jog state during jog cancel.
         case State::Jog:
-            strcat(status, "Jog");
+            rpt.add("Jog");
             break;
         case State::Homing:
-            strcat(status, "Home");
+            rpt.add("Home");
             break;
         case State::Alarm:
-            strcat(status, "Alarm");
+            rpt.add("Alarm");
             break;
         case State::CheckMode:
-            strcat(status, "Check");
+            rpt.add("Check");
             break;
         case State::SafetyDoor:
-            strcat(status, "Door:");
+            rpt.add("Door:");
             if (sys.suspend.bit.initiateRestore) {
-                strcat(status, "3");  // Restoring
+                rpt.add('3');  // Restoring
             } else {
                 if (sys.suspend.bit.retractComplete) {
-                    strcat(status, sys.suspend.bit.safetyDoorAjar ? "1" : "0");  // Door ajar
+                    rpt.add(sys.suspend.bit.safetyDoorAjar ? '1' : '0');  // Door ajar
                     // Door closed and ready to resume
                 } else {
-                    strcat(status, "2");  // Retracting
+                    rpt.add('2');  // Retracting
                 }
             }
             break;
         case State::Sleep:
-            strcat(status, "Sleep");
+            rpt.add("Sleep");
             break;
     }
     float wco[MAX_N_AXIS];
@@ -656,35 +740,20 @@ void report_realtime_status(uint8_t client) {
     }
     // Report machine position
     if (bit_istrue(status_mask->get(), RtStatus::Position)) {
-        strcat(status, "|MPos:");
+        rpt.add("|MPos:");
     } else {
 #ifdef USE_FWD_KINEMATICS
         forward_kinematics(print_position);
 #endif
-        strcat(status, "|WPos:");
+        rpt.add("|WPos:");
     }
-    report_util_axis_values(print_position, temp);
-    strcat(status, temp);
+    report_util_axis_values(print_position, rpt);
     // Returns planner and serial read buffer states.
 #ifdef REPORT_FIELD_BUFFER_STATE
     if (bit_istrue(status_mask->get(), RtStatus::Buffer)) {
-        int bufsize = DEFAULTBUFFERSIZE;
-#    if defined(ENABLE_WIFI) && defined(ENABLE_TELNET)
-        if (client == CLIENT_TELNET) {
-            bufsize = WebUI::telnet_server.get_rx_buffer_available();
-        }
-#    endif  //ENABLE_WIFI && ENABLE_TELNET
-#    if defined(ENABLE_BLUETOOTH)
-        if (client == CLIENT_BT) {
-            //TODO FIXME
-            bufsize = 512 - WebUI::SerialBT.available();
-        }
-#    endif  //ENABLE_BLUETOOTH
-        if (client == CLIENT_SERIAL) {
-            bufsize = serial_get_rx_buffer_available(CLIENT_SERIAL);
-        }
-        sprintf(temp, "|Bf:%d,%d", plan_get_block_buffer_available(), bufsize);
-        strcat(status, temp);
+        // A report to all clients shows the serial port's credits
+        int bufsize = serial_get_rx_buffer_available(client == CLIENT_ALL ? CLIENT_SERIAL : client);
+        rpt.add("|Bf:").addInt(plan_get_block_buffer_available()).add(',').addInt(bufsize);
     }
 #endif
 #ifdef USE_LINE_NUMBERS
@@ -694,75 +763,62 @@ void report_realtime_status(uint8_t client) {
     if (cur_block != NULL) {
         uint32_t ln = cur_block->line_number;
         if (ln > 0) {
-            sprintf(temp, "|Ln:%d", ln);
-            strcat(status, temp);
+            rpt.add("|Ln:").addInt(ln);
         }
     }
 #    endif
 #endif
     // Report realtime feed speed
 #ifdef REPORT_FIELD_CURRENT_FEED_SPEED
+    rpt.add("|FS:");
     if (report_inches->get()) {
-        sprintf(temp, "|FS:%.1f,%d", st_get_realtime_rate() / MM_PER_INCH, sys.spindle_speed);
+        rpt.addFloat(st_get_realtime_rate() / MM_PER_INCH, 1);
     } else {
-        sprintf(temp, "|FS:%.0f,%d", st_get_realtime_rate(), sys.spindle_speed);
+        rpt.addFloat(st_get_realtime_rate(), 0);
     }
-    strcat(status, temp);
+    rpt.add(',').addInt(sys.spindle_speed);
 #endif
 #ifdef REPORT_FIELD_PIN_STATE
     AxisMask    lim_pin_state  = limits_get_state();
     ControlPins ctrl_pin_state = system_control_get_state();
     bool        prb_pin_state  = probe_get_state();
     if (lim_pin_state || ctrl_pin_state.value || prb_pin_state) {
-        strcat(status, "|Pn:");
+        rpt.add("|Pn:");
         if (prb_pin_state) {
-            strcat(status, "P");
+            rpt.add('P');
         }
         if (lim_pin_state) {
             auto n_axis = number_axis->get();
-            if (n_axis >= 1 && bit_istrue(lim_pin_state, bit(X_AXIS))) {
-                strcat(status, "X");
-            }
-            if (n_axis >= 2 && bit_istrue(lim_pin_state, bit(Y_AXIS))) {
-                strcat(status, "Y");
-            }
-            if (n_axis >= 3 && bit_istrue(lim_pin_state, bit(Z_AXIS))) {
-                strcat(status, "Z");
-            }
-            if (n_axis >= 4 && bit_istrue(lim_pin_state, bit(A_AXIS))) {
-                strcat(status, "A");
-            }
-            if (n_axis >= 5 && bit_istrue(lim_pin_state, bit(B_AXIS))) {
-                strcat(status, "B");
-            }
-            if (n_axis >= 6 && bit_istrue(lim_pin_state, bit(C_AXIS))) {
-                strcat(status, "C");
+            for (idx = 0; idx < n_axis && idx <= C_AXIS; idx++) {
+                if (bit_istrue(lim_pin_state, bit(idx))) {
+                    rpt.add("XYZABC"[idx]);
+                }
             }
         }
         if (ctrl_pin_state.value) {
             if (ctrl_pin_state.bit.safetyDoor) {
-                strcat(status, "D");
+                rpt.add('D');
             }
             if (ctrl_pin_state.bit.reset) {
-                strcat(status, "R");
+                rpt.add('R');
             }
             if (ctrl_pin_state.bit.feedHold) {
-                strcat(status, "H");
+                rpt.add('H');
             }
             if (ctrl_pin_state.bit.cycleStart) {
-                strcat(status, "S");
+                rpt.add('S');
             }
             if (ctrl_pin_state.bit.macro0) {
-                strcat(status, "M0");
+                rpt.add("M0");
             }
             if (ctrl_pin_state.bit.macro1) {
-                strcat(status, "M1");
+                rpt.add("M1");
             }
             if (ctrl_pin_state.bit.macro2) {
-                strcat(status, "M2");
+                rpt.add("M2");
             }
             if (ctrl_pin_state.bit.macro3) {
-                strcat(status, "M3");
+                rpt.add("M3");
             }
         }
     }
@@ -785,9 +841,7 @@ void report_realtime_status(uint8_t client) {
         if (sys.report_ovr_counter == 0) {
             sys.report_ovr_counter = 1;  // Set override on next report.
         }
-        strcat(status, "|WCO:");
-        report_util_axis_values(wco, temp);
-        strcat(status, temp);
+        report_util_wco(rpt, wco, use_cache);
     }
 #endif
 #ifdef REPORT_FIELD_OVERRIDES
@@ -805,49 +859,37 @@ void report_realtime_status(uint8_t client) {
                 sys.report_ovr_counter = (REPORT_OVR_REFRESH_IDLE_COUNT - 1);
                 break;
         }
-
-        sprintf(temp, "|Ov:%d,%d,%d", sys.f_override, sys.r_override, sys.spindle_speed_ovr);
-        strcat(status, temp);
-        SpindleState sp_state      = spindle->get_state();
-        CoolantState coolant_state = coolant_get_state();
-        if (sp_state != SpindleState::Disable || coolant_state.Mist || coolant_state.Flood) {
-            strcat(status, "|A:");
-            switch (sp_state) {
-                case SpindleState::Disable:
-                    break;
-                case SpindleState::Cw:
-                    strcat(status, "S");
-                    break;
-                case SpindleState::Ccw:
-                    strcat(status, "C");
-                    break;
-            }
-
-            auto coolant = coolant_state;
-            if (coolant.Flood) {
-                strcat(status, "F");
-            }
-#    ifdef COOLANT_MIST_PIN  // TODO Deal with M8 - Flood
-            if (coolant.Mist) {
-                strcat(status, "M");
-            }
-#    endif
-        }
+        report_util_overrides(rpt, use_cache);
     }
 #endif
+    if (use_cache) {
+        status_cache_busy.clear(std::memory_order_release);
+    }
 #ifdef ENABLE_SD_CARD
     if (get_sd_state(false) == SDCARD_BUSY_PRINTING) {
-        sprintf(temp, "|SD:%4.2f,", sd_report_perc_complete());
-        strcat(status, temp);
-        sd_get_current_filename(temp);
-        strcat(status, temp);
+        char filename[axesStringLen];
+        sd_get_current_filename(filename);
+        rpt.addf("|SD:%4.2f,", sd_report_perc_complete()).add(filename);
     }
 #endif
 #ifdef REPORT_HEAP
-    sprintf(temp, "|Heap:%d", esp.getHeapSize());
-    strcat(status, temp);
-#endif
-    strcat(status, ">\r\n");
+    rpt.add("|Heap:").addInt(esp.getHeapSize());
+#endif
+#if defined(STEPPER_ISR_STATS) && defined(REPORT_FIELD_ISR_STATS)
+    isr_stats_t isr = st_get_isr_stats();
+    if (isr.count) {
+        // Average and maximum ISR time in microseconds, then missed step periods and underruns
+        rpt.add("|Isr:")
+            .addFloat(float(isr.total_cycles / isr.count) / isr.cycles_per_us, 1)
+            .add(',')
+            .addFloat(float(isr.max_cycles) / isr.cycles_per_us, 1)
+            .add(',')
+            .addUint(isr.missed)
+            .add(',')
+            .addUint(st_get_segment_underruns());
+    }
+#endif
+    rpt.add(">\r\n");
     grbl_send(client, status);
 }
 
@@ -20,6 +20,8 @@
   along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "ReportWriter.h"
+
 // Define status reporting boolean enable bit flags in status_report_mask
 enum RtStatus {
     Position = bit(0),
@@ -0,0 +1,149 @@
+/*
+  ReportWriter.cpp - builds report lines in a fixed buffer without printf
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ReportWriter.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+// Writes value in decimal to the end of text, backwards, and returns where it starts.
+static char* format_digits(char* end, uint64_t value) {
+    do {
+        *--end = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    return end;
+}
+
+size_t format_float(char* text, float value, int decimals) {
+    static const uint32_t scale[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool     negative = bits >> 31;
+    int      exponent = (bits >> 23) & 0xff;
+    uint64_t mantissa = bits & 0x7fffff;
+    // Beyond 2^32 the scaled value may not fit in 64 bits. printf() handles those, and NaN and infinity.
+    if (exponent >= 127 + 32 || decimals < 0 || decimals > 6) {
+        int length = snprintf(text, FLOAT_TEXT_SIZE + 1, "%.*f", decimals, value);
+        return length < FLOAT_TEXT_SIZE ? length : FLOAT_TEXT_SIZE;
+    }
+    if (exponent) {
+        mantissa |= 1 << 23;
+    } else {
+        exponent = 1;  // Subnormal
+    }
+    exponent -= 127 + 23;
+
+    // value * 10^decimals is mantissa * 10^decimals * 2^exponent exactly. Round it to an integer
+    // half to even, as printf() does with the default rounding mode.
+    uint64_t scaled = mantissa * scale[decimals];
+    if (exponent >= 0) {
+        scaled <<= exponent;
+    } else if (exponent > -64) {
+        uint64_t rest = scaled & ((uint64_t(1) << -exponent) - 1);
+        uint64_t half = uint64_t(1) << (-exponent - 1);
+        scaled >>= -exponent;
+        if (rest > half || (rest == half && (scaled & 1))) {
+            scaled++;
+        }
+    } else {
+        scaled = 0;
+    }
+
+    char  digits[FLOAT_TEXT_SIZE + 1];
+    char* end   = digits + sizeof(digits);
+    char* start = format_digits(end, scaled);
+    while (end - start <= decimals) {
+        *--start = '0';  // At least one digit before the point
+    }
+    char* out = text;
+    if (negative) {
+        *out++ = '-';  // Also for values that round to zero, like printf()
+    }
+    size_t whole = end - start - decimals;
+    memcpy(out, start, whole);
+    out += whole;
+    if (decimals) {
+        *out++ = '.';
+        memcpy(out, start + whole, decimals);
+        out += decimals;
+    }
+    *out = '\0';
+    return out - text;
+}
+
+ReportWriter& ReportWriter::add(char c) {
+    if (_pos < _end) {
+        *_pos++ = c;
+        *_pos   = '\0';
+    }
+    return *this;
+}
+
+ReportWriter& ReportWriter::add(const char* text) {
+    while (*text && _pos < _end) {
+        *_pos++ = *text++;
+    }
+    *_pos = '\0';
+    return *this;
+}
+
+ReportWriter& ReportWriter::add(const char* text, size_t length) {
+    if (length > size_t(_end - _pos)) {
+        length = _end - _pos;
+    }
+    memcpy(_pos, text, length);
+    _pos += length;
+    *_pos = '\0';
+    return *this;
+}
+
+ReportWriter& ReportWriter::addInt(int32_t value) {
+    char  digits[12];
+    char* end   = digits + sizeof(digits);
+    char* start = format_digits(end, value < 0 ? -int64_t(value) : value);
+    if (value < 0) {
+        *--start = '-';
+    }
+    return add(start, end - start);
+}
+
+ReportWriter& ReportWriter::addUint(uint32_t value) {
+    char  digits[10];
+    char* end   = digits + sizeof(digits);
+    char* start = format_digits(end, value);
+    return add(start, end - start);
+}
+
+ReportWriter& ReportWriter::addFloat(float value, int decimals) {
+    char text[FLOAT_TEXT_SIZE + 1];
+    return add(text, format_float(text, value, decimals));
+}
+
+ReportWriter& ReportWriter::addf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(_pos, _end - _pos + 1, format, args);
+    va_end(args);
+    if (length > 0) {
+        _pos += size_t(length) < size_t(_end - _pos) ? length : _end - _pos;
+    }
+    return *this;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+  ReportWriter.h - builds report lines in a fixed buffer without printf
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+// Longest text format_float() writes, without the terminator.
+const int FLOAT_TEXT_SIZE = 20;
+
+// Writes value to text the way printf("%.<decimals>f") does, for decimals from 0 to 6, and
+// returns the length. Values that fit in 32 bits are converted with integer arithmetic only;
+// others, and NaN or infinity, go through snprintf(). text needs FLOAT_TEXT_SIZE + 1 characters.
+size_t format_float(char* text, float value, int decimals);
+
+// Appends to a caller's buffer through a cursor, so each piece costs its own length instead of a
+// rescan of the whole line as with strcat(). Text that does not fit is cut off, and the buffer
+// always holds a terminated string.
+class ReportWriter {
+public:
+    ReportWriter(char* buffer, size_t size) : _buffer(buffer), _pos(buffer), _end(buffer + size - 1) { *_pos = '\0'; }
+
+    ReportWriter& add(char c);
+    ReportWriter& add(const char* text);
+    ReportWriter& add(const char* text, size_t length);
+    ReportWriter& addInt(int32_t value);
+    ReportWriter& addUint(uint32_t value);
+    ReportWriter& addFloat(float value, int decimals);
+    ReportWriter& addf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    const char* c_str() const { return _buffer; }
+    size_t      length() const { return _pos - _buffer; }
+
+private:
+    char* _buffer;
+    char* _pos;
+    char* _end;  // Last character, kept for the terminator
+};
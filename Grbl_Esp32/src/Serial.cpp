@@ -50,6 +50,11 @@
   read all clients as fast as possible. The realtime commands are acted upon and the other charcters are
   placed into a client_buffer[client].
 
+  Each client_buffer[] is a lock-free ring with serialCheckTask as its only writer and the protocol
+  loop as its only reader. Data is moved in blocks of up to SERIAL_READ_CHUNK characters, so neither
+  side takes a lock per character. The protocol loop takes whole lines with serial_read_line(),
+  which finds the end of line with memchr() and parses the line where it lies in the ring.
+
   The main protocol loop reads from client_buffer[]
 
 
@@ -57,15 +62,77 @@
 
 #include "Grbl.h"
 
-portMUX_TYPE myMutex = portMUX_INITIALIZER_UNLOCKED;
-
 static TaskHandle_t serialCheckTaskHandle = 0;
+#ifdef SERIAL_TX_TASK
+static TaskHandle_t serialTxTaskHandle = 0;
+#endif
+
+// serialCheckTask reads clients at SERIAL_TASK_PRIORITY, and runs the WebUI, WiFi and Bluetooth
+// handlers at the main loop's priority, so that they share its time slices instead of starving it.
+const UBaseType_t SERIAL_HANDLER_PRIORITY = 1;  // The main loop's
+#ifdef SERIAL_EVENT_WAKE
+const UBaseType_t SERIAL_TASK_PRIORITY = 2;  // Above the main loop
+#else
+const UBaseType_t SERIAL_TASK_PRIORITY = SERIAL_HANDLER_PRIORITY;
+#endif
+
+#ifdef DEBUG_REPORT_SERIAL_LATENCY
+static volatile int64_t serial_notify_us = 0;  // When serial_notify() was first called since serialCheckTask last woke
+#endif
+
+SpscRing<RX_BUFFER_SIZE> client_buffer[CLIENT_COUNT];  // create a buffer for each client
 
-WebUI::InputBuffer client_buffer[CLIENT_COUNT];  // create a buffer for each client
+static bool rx_acks[CLIENT_COUNT];  // Clients that get "ok:<freed>"
 
-// Returns the number of bytes available in a client buffer.
-uint8_t serial_get_rx_buffer_available(uint8_t client) {
-    return client_buffer[client].availableforwrite();
+#ifdef SERIAL_TX_TASK
+// Output waiting for serialTxTask. Any task may send, so writers take tx_mutex for the ring's
+// writer side; serialTxTask is the only reader, and the ring orders its reads after the copy.
+static SpscRing<TX_BUFFER_SIZE> tx_buffer[CLIENT_COUNT];
+static SemaphoreHandle_t        tx_mutex = NULL;
+static volatile bool            tx_stalled[CLIENT_COUNT];  // Dropping output until serialTxTask empties the ring
+static std::atomic<bool>        tx_flush[CLIENT_COUNT];    // The ring holds a binary frame, to go out without waiting
+#endif
+static uint32_t tx_dropped[CLIENT_COUNT];
+
+// Returns what a client's transport has received and serialCheckTask has not read yet.
+static int transport_pending(uint8_t client) {
+    switch (client) {
+        case CLIENT_SERIAL:
+            return Serial.available();
+        case CLIENT_INPUT:
+            return WebUI::inputBuffer.available();
+#ifdef ENABLE_BLUETOOTH
+        case CLIENT_BT:
+            return WebUI::SerialBT.hasClient() ? WebUI::SerialBT.available() : 0;
+#endif
+#if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_IN)
+        case CLIENT_WEBUI:
+            return WebUI::Serial2Socket.available();
+#endif
+#if defined(ENABLE_WIFI) && defined(ENABLE_TELNET)
+        case CLIENT_TELNET:
+            return WebUI::telnet_server.available();
+#endif
+        default:
+            return 0;
+    }
+}
+
+int serial_get_rx_buffer_available(uint8_t client) {
+    int available = client_buffer[client].availableForWrite() - transport_pending(client);
+    return available > 0 ? available : 0;
+}
+
+uint32_t serial_get_rx_freed(uint8_t client) {
+    return client_buffer[client].freed();
+}
+
+void serial_set_rx_acks(uint8_t client, bool on) {
+    rx_acks[client] = on;
+}
+
+bool serial_get_rx_acks(uint8_t client) {
+    return client < CLIENT_COUNT && rx_acks[client];
 }
 
 void heapCheckTask(void* pvParameters) {
@@ -98,36 +165,106 @@ void serial_init() {
     // create a task to check for incoming data
     // For a 4096-word stack, uxTaskGetStackHighWaterMark reports 244 words available
     // after WebUI attaches.
-    xTaskCreatePinnedToCore(serialCheckTask,    // task
-                            "serialCheckTask",  // name for task
+    xTaskCreatePinnedToCore(serialCheckTask,       // task
+                            "serialCheckTask",     // name for task
+                            4096,                  // size of task stack
+                            NULL,                  // parameters
+                            SERIAL_TASK_PRIORITY,  // priority
+                            &serialCheckTaskHandle,
+                            1  // core
+    );
+#ifdef SERIAL_TX_TASK
+    tx_mutex = xSemaphoreCreateMutex();
+    // Same core and priority as the main loop, which it shares time slices with, so output
+    // sent within a slice goes out together. The WebUI transports are only used from this core.
+    xTaskCreatePinnedToCore(serialTxTask,       // task
+                            "serialTxTask",     // name for task
                             4096,               // size of task stack
                             NULL,               // parameters
                             1,                  // priority
-                            &serialCheckTaskHandle,
+                            &serialTxTaskHandle,
                             1  // core
     );
+#endif
+}
+
+void serial_notify() {
+#ifdef DEBUG_REPORT_SERIAL_LATENCY
+    if (serial_notify_us == 0) {
+        serial_notify_us = esp_timer_get_time();
+    }
+#endif
+#ifdef SERIAL_EVENT_WAKE
+    if (serialCheckTaskHandle) {
+        xTaskNotifyGive(serialCheckTaskHandle);
+    }
+#endif
+}
+
+#ifdef DEBUG_REPORT_SERIAL_LATENCY
+// Reports how long serialCheckTask took to wake up after serial_notify(), every few seconds.
+static void report_serial_latency() {
+    static uint32_t count       = 0;
+    static uint32_t max_us      = 0;
+    static uint64_t total_us    = 0;
+    static int64_t  next_report = 0;
+    int64_t         now         = esp_timer_get_time();
+    if (serial_notify_us) {
+        uint32_t us      = now - serial_notify_us;
+        serial_notify_us = 0;
+        count++;
+        total_us += us;
+        if (us > max_us) {
+            max_us = us;
+        }
+    }
+    if (now >= next_report) {
+        if (count) {
+            uint32_t avg_us = total_us / count;
+            grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Serial wake latency avg %u us, max %u us, %u wakes", avg_us, max_us, count);
+        }
+        count       = 0;
+        max_us      = 0;
+        total_us    = 0;
+        next_report = now + 5000000;
+    }
+}
+#endif
+
+// Reads what a stream has already received, up to SERIAL_READ_CHUNK characters, without
+// waiting for more.
+static size_t read_available(Stream& stream, uint8_t* data) {
+    int length = stream.available();
+    if (length > SERIAL_READ_CHUNK) {
+        length = SERIAL_READ_CHUNK;
+    }
+    return stream.readBytes(data, length);
 }
 
 // this task runs and checks for data on all interfaces
 // REaltime stuff is acted upon, then characters are added to the appropriate buffer
 void serialCheckTask(void* pvParameters) {
-    uint8_t            data            = 0;
+    static uint8_t     data[SERIAL_READ_CHUNK];
+    size_t             length          = 0;
     uint8_t            client          = CLIENT_ALL;  // who sent the data
     static UBaseType_t uxHighWaterMark = 0;
     while (true) {  // run continuously
+#ifdef DEBUG_REPORT_SERIAL_LATENCY
+        report_serial_latency();
+#endif
         while (any_client_has_data()) {
             if (Serial.available()) {
                 client = CLIENT_SERIAL;
-                data   = Serial.read();
+                length = read_available(Serial, data);
             } else if (WebUI::inputBuffer.available()) {
                 client = CLIENT_INPUT;
-                data   = WebUI::inputBuffer.read();
+                length = WebUI::inputBuffer.read(data, SERIAL_READ_CHUNK);
             } else {
                 //currently is wifi or BT but better to prepare both can be live
 #ifdef ENABLE_BLUETOOTH
                 if (WebUI::SerialBT.hasClient() && WebUI::SerialBT.available()) {
                     client = CLIENT_BT;
-                    data   = WebUI::SerialBT.read();
+                    length = read_available(WebUI::SerialBT, data);
 
                     // Serial.write(data);  // echo all data to serial.
                 } else {
@@ -135,13 +272,13 @@ void serialCheckTask(void* pvParameters) {
 #if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_IN)
                     if (WebUI::Serial2Socket.available()) {
                         client = CLIENT_WEBUI;
-                        data   = WebUI::Serial2Socket.read();
+                        length = WebUI::Serial2Socket.read(data, SERIAL_READ_CHUNK);
                     } else {
 #endif
 #if defined(ENABLE_WIFI) && defined(ENABLE_TELNET)
                         if (WebUI::telnet_server.available()) {
                             client = CLIENT_TELNET;
-                            data   = WebUI::telnet_server.read();
+                            length = WebUI::telnet_server.read(data, SERIAL_READ_CHUNK);
                         }
 #endif
 #if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_IN)
@@ -151,16 +288,12 @@ void serialCheckTask(void* pvParameters) {
                 }
 #endif
             }
-            // Pick off realtime command characters directly from the serial stream. These characters are
-            // not passed into the main buffer, but these set system state flag bits for realtime execution.
-            if (is_realtime_command(data)) {
-                execute_realtime_command(static_cast<Cmd>(data), client);
-            } else {
-                vTaskEnterCritical(&myMutex);
-                client_buffer[client].write(data);
-                vTaskExitCritical(&myMutex);
-            }
+            serial_receive(client, data, length);
+            length = 0;
         }  // if something available
+#ifdef SERIAL_EVENT_WAKE
+        vTaskPrioritySet(NULL, SERIAL_HANDLER_PRIORITY);
+#endif
         WebUI::COMMANDS::handle();
 #ifdef ENABLE_WIFI
         WebUI::wifi_config.handle();
@@ -168,20 +301,198 @@ void serialCheckTask(void* pvParameters) {
 #ifdef ENABLE_BLUETOOTH
         WebUI::bt_config.handle();
 #endif
-#if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_IN)
+#if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT) && !defined(SERIAL_TX_TASK)
         WebUI::Serial2Socket.handle_flush();
 #endif
+#ifdef SERIAL_EVENT_WAKE
+        // Sleep until a client signals new data, or until it is time to poll those that cannot.
+        // Data pushed by the handlers above has already signalled, so it is read at once.
+        vTaskPrioritySet(NULL, SERIAL_TASK_PRIORITY);
+        ulTaskNotifyTake(pdTRUE, 1 / portTICK_RATE_MS);
+#else
         vTaskDelay(1 / portTICK_RATE_MS);  // Yield to other tasks
+#endif
 
         static UBaseType_t uxHighWaterMark = 0;
         reportTaskStackSize(uxHighWaterMark);
     }  // while(true)
 }
 
+// Writes output to a client's transport. Clients that are not connected discard it.
+static void transport_write(uint8_t client, const uint8_t* data, size_t length) {
+    switch (client) {
+        case CLIENT_SERIAL:
+            Serial.write(data, length);
+            break;
+#ifdef ENABLE_BLUETOOTH
+        case CLIENT_BT:
+            if (WebUI::SerialBT.hasClient()) {
+                WebUI::SerialBT.write(data, length);
+            }
+            break;
+#endif
+#if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
+        case CLIENT_WEBUI:
+            WebUI::Serial2Socket.write(data, length);
+            break;
+#endif
+#if defined(ENABLE_WIFI) && defined(ENABLE_TELNET)
+        case CLIENT_TELNET:
+            WebUI::telnet_server.write(data, length);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+#ifdef SERIAL_TX_TASK
+// Queues output for serialTxTask. A message either goes in whole or is dropped, except one longer
+// than the ring, which a client that waits gets in pieces. serialCheckTask never waits, since
+// realtime commands go unread while it does; the status reports and other replies it sends are
+// dropped instead when the ring is full, and the client asks again.
+static void tx_queue(uint8_t client, const uint8_t* data, size_t length) {
+    SpscRing<TX_BUFFER_SIZE>& ring     = tx_buffer[client];
+    bool                      may_drop = ((CLIENT_TX_DROP >> client) & 1) || xTaskGetCurrentTaskHandle() == serialCheckTaskHandle;
+    int64_t                   waited   = 0;
+    while (true) {
+        xSemaphoreTake(tx_mutex, portMAX_DELAY);
+        size_t space = ring.availableForWrite();
+        if (length <= space) {
+            ring.write(data, length);
+            length = 0;
+        } else if (may_drop || tx_stalled[client]) {
+            tx_dropped[client]++;
+            length = 0;
+        } else if (length > TX_BUFFER_SIZE) {
+            ring.write(data, space);
+            data += space;
+            length -= space;
+        }
+        xSemaphoreGive(tx_mutex);
+        if (length == 0) {
+            return;
+        }
+        // Wait for serialTxTask to make room, unless the transport seems to have stopped.
+        xTaskNotifyGive(serialTxTaskHandle);
+        if (waited == 0) {
+            waited = esp_timer_get_time();
+        } else if (esp_timer_get_time() - waited > TX_STALL_MS * 1000) {
+            tx_stalled[client] = true;
+        }
+        vTaskDelay(1 / portTICK_RATE_MS);
+    }
+}
+
+// this task writes the output queued by serial_send() to the transports
+void serialTxTask(void* pvParameters) {
+    TickType_t wait = portMAX_DELAY;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, wait);
+        uint32_t hold_ms = serial_tx_drain();
+        // Come back for output held in a ring by the time it is due, if nothing sends before then
+        wait = hold_ms ? (hold_ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS : portMAX_DELAY;
+
+        static UBaseType_t uxHighWaterMark = 0;
+        reportTaskStackSize(uxHighWaterMark);
+    }
+}
+#endif
+
+// Sends output to a client, or to all of them with CLIENT_ALL. With flush, transports that hold output
+// back to send more of it at once send it right away instead.
+static void send(uint8_t client, const uint8_t* data, size_t length, bool flush) {
+#ifdef SERIAL_TX_TASK
+    // Written directly until serialTxTask exists, and by serialTxTask itself
+    bool queue = serialTxTaskHandle && xTaskGetCurrentTaskHandle() != serialTxTaskHandle;
+#endif
+    for (uint8_t client_num = 0; client_num < CLIENT_COUNT; client_num++) {
+        if (client_num == CLIENT_INPUT || (client != client_num && client != CLIENT_ALL)) {
+            continue;
+        }
+#ifdef SERIAL_TX_TASK
+        if (queue) {
+            tx_queue(client_num, data, length);
+            if (flush) {
+                tx_flush[client_num] = true;  // Only once the data is in the ring
+            }
+            continue;
+        }
+#endif
+        transport_write(client_num, data, length);
+#if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
+        if (flush && client_num == CLIENT_WEBUI) {
+            WebUI::Serial2Socket.flush();
+        }
+#endif
+    }
+#ifdef SERIAL_TX_TASK
+    if (queue) {
+        xTaskNotifyGive(serialTxTaskHandle);
+    }
+#endif
+}
+
+void serial_send(uint8_t client, const char* text, size_t length) {
+    send(client, (const uint8_t*)text, length, false);
+}
+
+void serial_send_frame(uint8_t client, const uint8_t* data, size_t length) {
+    send(client, data, length, true);
+}
+
+uint32_t serial_tx_drain() {
+    uint32_t hold_ms = 0;
+#ifdef SERIAL_TX_TASK
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        SpscRing<TX_BUFFER_SIZE>& ring = tx_buffer[client];
+        uint8_t*                  data;
+        size_t                    length;
+#    if defined(ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
+        if (client == CLIENT_WEBUI) {
+            // Sent as websocket frames from the ring itself, when its flush policy says so
+            hold_ms            = WebUI::Serial2Socket.sendFrom(ring, tx_flush[client].exchange(false));
+            tx_stalled[client] = false;
+            continue;
+        }
+#    endif
+        // Everything queued since the last pass goes out in one write, or two if it wraps.
+        while ((length = ring.peek(&data)) != 0) {
+            transport_write(client, data, length);
+            ring.skip(length);
+            ring.release();
+        }
+        tx_stalled[client] = false;
+    }
+#endif
+    return hold_ms;
+}
+
+uint32_t serial_get_tx_dropped(uint8_t client) {
+    return tx_dropped[client];
+}
+
+// Pick off realtime command characters directly from the received data. These characters are
+// not passed into the main buffer, but these set system state flag bits for realtime execution.
+// The characters between them are copied to the client's buffer in runs.
+void serial_receive(uint8_t client, const uint8_t* data, size_t length) {
+    size_t start = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (is_realtime_command(data[i])) {
+            client_buffer[client].write(data + start, i - start);
+            execute_realtime_command(static_cast<Cmd>(data[i]), client);
+            start = i + 1;
+        }
+    }
+    client_buffer[client].write(data + start, length - start);
+}
+
+// Called by the protocol loop, the only reader of the client buffers.
 void serial_reset_read_buffer(uint8_t client) {
     for (uint8_t client_num = 0; client_num < CLIENT_COUNT; client_num++) {
         if (client == client_num || client == CLIENT_ALL) {
-            client_buffer[client_num].begin();
+            client_buffer[client_num].clear();
+            rx_acks[client_num] = false;  // The sender starts counting again after a reset
         }
     }
 }
@@ -193,17 +504,39 @@ void serial_write(uint8_t data) {
 
 // Fetches the first byte in the serial read buffer. Called by protocol loop.
 uint8_t serial_read(uint8_t client) {
-    uint8_t data;
-    vTaskEnterCritical(&myMutex);
-    if (client_buffer[client].available()) {
-        data = client_buffer[client].read();
-        vTaskExitCritical(&myMutex);
-        //Serial.write((char)data);
-        return data;
-    } else {
-        vTaskExitCritical(&myMutex);
-        return SERIAL_NO_DATA;
+    int data = client_buffer[client].read();
+    return data < 0 ? SERIAL_NO_DATA : data;
+}
+
+int serial_read_line(uint8_t client, char** line) {
+    auto&    buffer = client_buffer[client];
+    uint8_t* data;
+    size_t   length = buffer.peek(&data);
+    size_t   limit  = length < LINE_BUFFER_SIZE - 1 ? length : LINE_BUFFER_SIZE - 1;  // Longest line and its end of line
+    auto     eol    = static_cast<uint8_t*>(memchr(data, '\n', limit));
+    auto     cr     = static_cast<uint8_t*>(memchr(data, '\r', eol ? eol - data : limit));
+    if (cr) {
+        eol = cr;
+    }
+    if (eol == NULL) {
+        // Wait for the rest of the line, unless it is too long, wraps around the end of the buffer
+        // or cannot fit in it.
+        if (limit == LINE_BUFFER_SIZE - 1 || length < buffer.available() || buffer.availableForWrite() == 0) {
+            return SERIAL_LINE_COPY;
+        }
+        return SERIAL_LINE_NONE;
+    }
+    if (memchr(data, '\b', eol - data)) {
+        return SERIAL_LINE_COPY;  // add_char_to_line() applies the backspaces
     }
+    *eol = '\0';
+    buffer.skip(eol - data + 1);
+    *line = reinterpret_cast<char*>(data);
+    return eol - data;
+}
+
+void serial_release_lines(uint8_t client) {
+    client_buffer[client].release();
 }
 
 bool any_client_has_data() {
@@ -233,22 +566,37 @@ bool is_realtime_command(uint8_t data) {
 void execute_realtime_command(Cmd command, uint8_t client) {
     switch (command) {
         case Cmd::Reset:
+#ifdef REALTIME_LATENCY_STATS
+            rt_latency_arrived(RtLatencyCmd::Reset);
+#endif
             mc_reset();  // Call motion control reset routine.
             break;
         case Cmd::StatusReport:
             report_realtime_status(client);  // direct call instead of setting flag
             break;
         case Cmd::CycleStart:
+#ifdef REALTIME_LATENCY_STATS
+            rt_latency_arrived(RtLatencyCmd::CycleStart);
+#endif
             sys_rt_exec_state.bit.cycleStart = true;
             break;
         case Cmd::FeedHold:
+#ifdef REALTIME_LATENCY_STATS
+            rt_latency_arrived(RtLatencyCmd::FeedHold);
+#endif
             sys_rt_exec_state.bit.feedHold = true;
             break;
         case Cmd::SafetyDoor:
+#ifdef REALTIME_LATENCY_STATS
+            rt_latency_arrived(RtLatencyCmd::FeedHold);
+#endif
             sys_rt_exec_state.bit.safetyDoor = true;
             break;
         case Cmd::JogCancel:
             if (sys.state == State::Jog) {  // Block all other states from invoking motion cancel.
+#ifdef REALTIME_LATENCY_STATS
+                rt_latency_arrived(RtLatencyCmd::FeedHold);
+#endif
                 sys_rt_exec_state.bit.motionCancel = true;
             }
             break;
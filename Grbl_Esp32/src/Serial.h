@@ -21,35 +21,97 @@
 */
 
 #include "Grbl.h"
+#include "SpscRing.h"
 
 #ifndef RX_BUFFER_SIZE
 #    define RX_BUFFER_SIZE 256
 #endif
 #ifndef TX_BUFFER_SIZE
-#    ifdef USE_LINE_NUMBERS
-#        define TX_BUFFER_SIZE 112
-#    else
-#        define TX_BUFFER_SIZE 104
-#    endif
+#    define TX_BUFFER_SIZE 1024
 #endif
 
 const float SERIAL_NO_DATA = 0xff;
 
+#ifndef CLIENT_TX_DROP
+#    define CLIENT_TX_DROP (1 << CLIENT_WEBUI)  // Bit mask of the clients that drop output rather than wait
+#endif
+const int TX_STALL_MS = 1000;
+
+// Largest block serialCheckTask() moves from a client to its buffer at a time.
+const int SERIAL_READ_CHUNK = 128;
+
+// Received characters for each client, written by serialCheckTask() and read by the protocol loop.
+extern SpscRing<RX_BUFFER_SIZE> client_buffer[CLIENT_COUNT];
+
 // a task to read for incoming data from serial port
 void serialCheckTask(void* pvParameters);
 
+// a task to write the output queued for each client, with SERIAL_TX_TASK
+void serialTxTask(void* pvParameters);
+
 void serial_write(uint8_t data);
 // Fetches the first byte in the serial read buffer. Called by main program.
 uint8_t serial_read(uint8_t client);
 
+// Results of serial_read_line() other than a line length.
+const int SERIAL_LINE_NONE = -1;  // The next line is not complete yet
+const int SERIAL_LINE_COPY = -2;  // Read the next line a character at a time with serial_read()
+
+// Finds the next complete line in a client's buffer and points line at it, in place, with its
+// end of line replaced by a NUL. Returns its length. The line stays valid, and the parser may
+// modify it, until serial_release_lines(). Lines with a backspace, lines too long for
+// LINE_BUFFER_SIZE and lines that wrap around the end of the buffer return SERIAL_LINE_COPY.
+int serial_read_line(uint8_t client, char** line);
+
+// Frees the buffer space of everything read from a client so far.
+void serial_release_lines(uint8_t client);
+
 // See if the character is an action command like feedhold or jogging. If so, do the action and return true
 uint8_t check_action_command(uint8_t data);
 
+// Acts on the realtime commands in data received from a client and buffers the rest.
+void serial_receive(uint8_t client, const uint8_t* data, size_t length);
+
+// Wakes serialCheckTask to read a client that has received data. See SERIAL_EVENT_WAKE.
+void serial_notify();
+
 void serial_init();
 void serial_reset_read_buffer(uint8_t client);
 
-// Returns the number of bytes available in the RX serial buffer.
-uint8_t serial_get_rx_buffer_available(uint8_t client);
+// RX credits. Every client can have RX_BUFFER_SIZE bytes, not counting realtime commands, on
+// the way to the parser: in its transport, in serialCheckTask() and in its buffer. Sending more
+// than that loses data. A sender can keep that many bytes in flight by counting the characters
+// of the lines not yet answered, or, after $RX=ON, by comparing the bytes it has sent with the
+// count every "ok:<freed>" reports.
+
+// Returns the bytes a client can send now: the free space in its buffer, less what its transport
+// has received and not handed over yet.
+int serial_get_rx_buffer_available(uint8_t client);
+
+// Returns the bytes of a client's input the parser has freed so far, wrapping at 2^32.
+uint32_t serial_get_rx_freed(uint8_t client);
+
+// Turns on or off the freed byte count in a client's "ok" responses. Reset turns it off.
+void serial_set_rx_acks(uint8_t client, bool on);
+bool serial_get_rx_acks(uint8_t client);
+
+// Sends text to a client, or to all of them with CLIENT_ALL. With SERIAL_TX_TASK the text is queued
+// in the client's TX ring for serialTxTask, and only waits if a client that is not in
+// CLIENT_TX_DROP has a full ring, and never in serialCheckTask; otherwise it is written to the
+// transport at once.
+void serial_send(uint8_t client, const char* text, size_t length);
+
+// Sends a binary frame like serial_send(), but transports that hold output back to send more of it
+// at once, such as the WebUI's websocket, send it right away, in one message.
+void serial_send_frame(uint8_t client, const uint8_t* data, size_t length);
+
+// Writes everything queued in the TX rings to the transports, except output that a transport holds
+// back to send more of it at once. Returns how many ms that may still wait, or 0 if there is none.
+// Called by serialTxTask.
+uint32_t serial_tx_drain();
+
+// Messages a client has lost to a full TX ring since startup.
+uint32_t serial_get_tx_dropped(uint8_t client);
 
 void execute_realtime_command(Cmd command, uint8_t client);
 bool any_client_has_data();
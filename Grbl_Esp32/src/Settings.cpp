@@ -282,10 +282,16 @@ void FloatSetting::load() {
     } else {
         _currentValue = v.fval;
     }
+    if (_axis != NO_AXIS) {
+        AxisSettings::changes++;
+    }
 }
 
 void FloatSetting::setDefault() {
     _currentValue = _defaultValue;
+    if (_axis != NO_AXIS) {
+        AxisSettings::changes++;
+    }
     if (_storedValue != _currentValue) {
         nvs_erase_key(_handle, _keyName);
     }
@@ -308,6 +314,9 @@ Error FloatSetting::setStringValue(char* s) {
         return Error::NumberRange;
     }
     _currentValue = convertedValue;
+    if (_axis != NO_AXIS) {
+        AxisSettings::changes++;
+    }
     if (_storedValue != _currentValue) {
         if (_currentValue == _defaultValue) {
             nvs_erase_key(_handle, _keyName);
@@ -686,6 +695,8 @@ void IPaddrSetting::addWebui(WebUI::JSONencoder* j) {
     }
 }
 
+uint32_t AxisSettings::changes = 0;
+
 AxisSettings::AxisSettings(const char* axisName) : name(axisName) {}
 
 Error GrblCommand::action(char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
@@ -426,6 +426,7 @@ public:
     FloatSetting* steps_per_mm;
     FloatSetting* max_rate;
     FloatSetting* acceleration;
+    FloatSetting* jerk;
     FloatSetting* max_travel;
     FloatSetting* run_current;
     FloatSetting* hold_current;
@@ -433,6 +434,10 @@ public:
     IntSetting*   microsteps;
     IntSetting*   stallguard;
 
+    // Counts changes to the values of the FloatSettings above, so that copies of them can tell
+    // they are out of date.
+    static uint32_t changes;
+
     AxisSettings(const char* axisName);
 };
 class WebCommand : public Command {
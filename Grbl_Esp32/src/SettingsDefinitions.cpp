@@ -12,6 +12,7 @@ StringSetting* build_info;
 
 IntSetting* pulse_microseconds;
 IntSetting* stepper_idle_lock_time;
+IntSetting* segment_buffer_depth;
 
 AxisMaskSetting* step_invert_mask;
 AxisMaskSetting* dir_invert_mask;
@@ -36,6 +37,7 @@ FlagSetting* laser_mode;
 IntSetting*   status_mask;
 FloatSetting* junction_deviation;
 FloatSetting* arc_tolerance;
+FloatSetting* path_tolerance;
 
 FloatSetting*    homing_feed_rate;
 FloatSetting*    homing_seek_rate;
@@ -86,6 +88,7 @@ typedef struct {
     float       steps_per_mm;
     float       max_rate;
     float       acceleration;
+    float       jerk;
     float       max_travel;
     float       home_mpos;
     float       run_current;
@@ -97,6 +100,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_X_STEPS_PER_MM,
                                       DEFAULT_X_MAX_RATE,
                                       DEFAULT_X_ACCELERATION,
+                                      DEFAULT_X_JERK,
                                       DEFAULT_X_MAX_TRAVEL,
                                       DEFAULT_X_HOMING_MPOS,
                                       DEFAULT_X_CURRENT,
@@ -107,6 +111,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_Y_STEPS_PER_MM,
                                       DEFAULT_Y_MAX_RATE,
                                       DEFAULT_Y_ACCELERATION,
+                                      DEFAULT_Y_JERK,
                                       DEFAULT_Y_MAX_TRAVEL,
                                       DEFAULT_Y_HOMING_MPOS,
                                       DEFAULT_Y_CURRENT,
@@ -117,6 +122,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_Z_STEPS_PER_MM,
                                       DEFAULT_Z_MAX_RATE,
                                       DEFAULT_Z_ACCELERATION,
+                                      DEFAULT_Z_JERK,
                                       DEFAULT_Z_MAX_TRAVEL,
                                       DEFAULT_Z_HOMING_MPOS,
                                       DEFAULT_Z_CURRENT,
@@ -127,6 +133,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_A_STEPS_PER_MM,
                                       DEFAULT_A_MAX_RATE,
                                       DEFAULT_A_ACCELERATION,
+                                      DEFAULT_A_JERK,
                                       DEFAULT_A_MAX_TRAVEL,
                                       DEFAULT_A_HOMING_MPOS,
                                       DEFAULT_A_CURRENT,
@@ -137,6 +144,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_B_STEPS_PER_MM,
                                       DEFAULT_B_MAX_RATE,
                                       DEFAULT_B_ACCELERATION,
+                                      DEFAULT_B_JERK,
                                       DEFAULT_B_MAX_TRAVEL,
                                       DEFAULT_B_HOMING_MPOS,
                                       DEFAULT_B_CURRENT,
@@ -147,6 +155,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_C_STEPS_PER_MM,
                                       DEFAULT_C_MAX_RATE,
                                       DEFAULT_C_ACCELERATION,
+                                      DEFAULT_C_JERK,
                                       DEFAULT_C_MAX_TRAVEL,
                                       DEFAULT_C_HOMING_MPOS,
                                       DEFAULT_C_CURRENT,
@@ -203,7 +212,7 @@ static const char* makeGrblName(int axisNum, int base) {
     // if (axisNum > 2) return NULL;
     char buf[4];
     snprintf(buf, 4, "%d", axisNum + base);
-    char* retval = (char*)malloc(strlen(buf));
+    char* retval = (char*)malloc(strlen(buf) + 1);
     return strcpy(retval, buf);
 }
 
@@ -258,6 +267,12 @@ void make_settings() {
     a_axis_settings = axis_settings[A_AXIS];
     b_axis_settings = axis_settings[B_AXIS];
     c_axis_settings = axis_settings[C_AXIS];
+    for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
+        def          = &axis_defaults[axis];
+        auto setting = new FloatSetting(EXTENDED, WG, makeGrblName(axis, 180), makename(def->name, "Jerk"), def->jerk, 0.0, 10000000.0);
+        setting->setAxis(axis);
+        axis_settings[axis]->jerk = setting;
+    }
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def          = &axis_defaults[axis];
         auto setting = new IntSetting(
@@ -367,6 +382,7 @@ void make_settings() {
     report_inches = new FlagSetting(GRBL, WG, "13", "Report/Inches", DEFAULT_REPORT_INCHES);
     // TODO Settings - also need to clear, but not set, soft_limits
     arc_tolerance      = new FloatSetting(GRBL, WG, "12", "GCode/ArcTolerance", DEFAULT_ARC_TOLERANCE, 0, 1);
+    path_tolerance     = new FloatSetting(EXTENDED, WG, NULL, "GCode/PathTolerance", DEFAULT_PATH_TOLERANCE, 0, 1);
     junction_deviation = new FloatSetting(GRBL, WG, "11", "GCode/JunctionDeviation", DEFAULT_JUNCTION_DEVIATION, 0, 10);
     status_mask        = new IntSetting(GRBL, WG, "10", "Report/Status", DEFAULT_STATUS_REPORT_MASK, 0, 3);
 
@@ -377,6 +393,8 @@ void make_settings() {
     step_invert_mask       = new AxisMaskSetting(GRBL, WG, "2", "Stepper/StepInvert", DEFAULT_STEPPING_INVERT_MASK);
     stepper_idle_lock_time = new IntSetting(GRBL, WG, "1", "Stepper/IdleTime", DEFAULT_STEPPER_IDLE_LOCK_TIME, 0, 255);
     pulse_microseconds     = new IntSetting(GRBL, WG, "0", "Stepper/Pulse", DEFAULT_STEP_PULSE_MICROSECONDS, 3, 1000);
+    // Takes effect at the next reset, when the segment buffer is empty.
+    segment_buffer_depth = new IntSetting(EXTENDED, WG, NULL, "Stepper/SegmentBuffer", SEGMENT_BUFFER_SIZE, 3, SEGMENT_BUFFER_MAX);
     spindle_type           = new EnumSetting(NULL, EXTENDED, WG, NULL, "Spindle/Type", static_cast<int8_t>(SPINDLE_TYPE), &spindleTypes);
     stallguard_debug_mask  = new AxisMaskSetting(EXTENDED, WG, NULL, "Report/StallGuard", 0, checkStallguardDebugMask);
 
@@ -20,6 +20,7 @@ extern StringSetting* build_info;
 
 extern IntSetting* pulse_microseconds;
 extern IntSetting* stepper_idle_lock_time;
+extern IntSetting* segment_buffer_depth;
 
 extern AxisMaskSetting* step_invert_mask;
 extern AxisMaskSetting* dir_invert_mask;
@@ -39,6 +40,7 @@ extern FlagSetting* laser_mode;
 extern IntSetting*   status_mask;
 extern FloatSetting* junction_deviation;
 extern FloatSetting* arc_tolerance;
+extern FloatSetting* path_tolerance;
 
 extern FloatSetting* homing_feed_rate;
 extern FloatSetting* homing_seek_rate;
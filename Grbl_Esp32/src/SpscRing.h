@@ -0,0 +1,108 @@
+#pragma once
+
+/*
+  SpscRing.h - lock-free byte ring for one writer task and one reader task
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// A byte ring shared by exactly one writer and one reader, which may be different tasks on
+// different cores. Only the writer moves _head and only the reader moves _tail, so neither
+// side needs a lock. Both indices run freely and are masked on use, so all Size bytes hold data.
+//
+// The reader can also look at data in place with peek() and skip() past it without freeing it,
+// for instance to parse a line without copying it out first. Such data stays in the ring, where
+// the reader may modify it, until release(). Bytes read with read() while nothing is held that
+// way are freed at once.
+template <size_t Size>
+class SpscRing {
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : _head(0), _tail(0), _next(0) {}
+
+    // Writer side. Copies as much of data as fits and returns the number of bytes copied.
+    size_t write(const uint8_t* data, size_t length) {
+        uint32_t head  = _head.load(std::memory_order_relaxed);
+        size_t   space = Size - (head - _tail.load(std::memory_order_acquire));
+        if (length > space) {
+            length = space;
+        }
+        size_t start = head & Mask;
+        size_t first = length < Size - start ? length : Size - start;
+        memcpy(_buffer + start, data, first);
+        memcpy(_buffer, data + first, length - first);
+        _head.store(head + length, std::memory_order_release);
+        return length;
+    }
+
+    size_t availableForWrite() const { return Size - (_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire)); }
+
+    // Reader side. Returns the next byte, or -1 if there is nothing left to read.
+    int read() {
+        if (_next == _head.load(std::memory_order_acquire)) {
+            return -1;
+        }
+        uint8_t data = _buffer[_next & Mask];
+        bool    held = _next != _tail.load(std::memory_order_relaxed);
+        _next++;
+        if (!held) {
+            _tail.store(_next, std::memory_order_release);
+        }
+        return data;
+    }
+
+    size_t available() const { return _head.load(std::memory_order_acquire) - _next; }
+
+    // Bytes freed since the ring was created, wrapping at 2^32. Discarded ones count too.
+    uint32_t freed() const { return _tail.load(std::memory_order_relaxed); }
+
+    // Points data at the unread bytes and returns how many of them are contiguous.
+    size_t peek(uint8_t** data) {
+        size_t start  = _next & Mask;
+        size_t length = _head.load(std::memory_order_acquire) - _next;
+        *data         = _buffer + start;
+        return length < Size - start ? length : Size - start;
+    }
+
+    // Returns the unread byte offset bytes past the next one, without reading it. offset must be
+    // less than available().
+    uint8_t at(size_t offset) const { return _buffer[(_next + offset) & Mask]; }
+
+    // Moves past length bytes from peek(), without freeing them.
+    void skip(size_t length) { _next += length; }
+
+    // Frees everything read so far.
+    void release() { _tail.store(_next, std::memory_order_release); }
+
+    // Discards everything written so far. Called by the reader.
+    void clear() {
+        _next = _head.load(std::memory_order_acquire);
+        _tail.store(_next, std::memory_order_release);
+    }
+
+private:
+    static const uint32_t Mask = Size - 1;
+
+    uint8_t               _buffer[Size];
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _tail;
+    uint32_t              _next;  // Reader only. Bytes from _tail to here were read but are not free yet.
+};
@@ -25,9 +25,11 @@
 
 #include "Grbl.h"
 
+#include <xtensa/hal.h>  // xthal_get_ccount()
+
 // Stores the planner block Bresenham algorithm execution data for the segments in the segment
 // buffer. Normally, this buffer is partially in-use, but, for the worst case scenario, it will
-// never exceed the number of accessible stepper buffer segments (SEGMENT_BUFFER_SIZE-1).
+// never exceed the number of accessible stepper buffer segments (segment_buffer_size-1).
 // NOTE: This data is copied from the prepped planner blocks so that the planner blocks may be
 // discarded when entirely consumed and completed by the segment buffer. Also, AMASS alters this
 // data for its own use.
@@ -37,7 +39,7 @@ typedef struct {
     uint8_t  direction_bits;
     uint8_t  is_pwm_rate_adjusted;  // Tracks motions that require constant laser power/rate
 } st_block_t;
-static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE - 1];
+static st_block_t st_block_buffer[SEGMENT_BUFFER_MAX - 1];
 
 // Primary stepper segment ring buffer. Contains small, short line segments for the stepper
 // algorithm to execute, which are "checked-out" incrementally from the first block in the
@@ -50,7 +52,8 @@ typedef struct {
     uint8_t  amass_level;     // AMASS level for the ISR to execute this segment
     uint16_t spindle_rpm;     // TODO get rid of this.
 } segment_t;
-static segment_t segment_buffer[SEGMENT_BUFFER_SIZE];
+static segment_t segment_buffer[SEGMENT_BUFFER_MAX];
+static uint8_t   segment_buffer_size = SEGMENT_BUFFER_SIZE;  // Depth in use, set by st_reset()
 
 // Stepper ISR data struct. Contains the running data for the main stepper ISR.
 typedef struct {
@@ -83,8 +86,31 @@ static uint8_t          segment_next_head;
 // Used to avoid ISR nesting of the "Stepper Driver Interrupt". Should never occur though.
 static volatile uint8_t busy;
 
-// Pointers for the step segment being prepped from the planner buffer. Accessed only by the
-// main program. Pointers may be planning segments or planner blocks ahead of what being executed.
+static volatile uint32_t segment_underruns;
+static volatile bool     prep_owes_steps;  // Published by segment prep: a planner block has steps left to prep
+
+#ifdef SEGMENT_PREP_TASK
+static TaskHandle_t      segmentPrepTaskHandle = NULL;
+static SemaphoreHandle_t prep_mutex            = NULL;
+static BaseType_t        prep_task_woken;  // Set by the timer ISR when waking the prep task preempts the running one
+
+const int SEGMENT_PREP_POLL_MS = 10;
+
+static void segmentPrepTask(void* pvParameters);
+#endif
+
+#ifdef STEPPER_ISR_STATS
+static isr_stats_t isr_stats;
+static uint16_t    isr_period_ticks;  // Step period most recently written to the timer
+#endif
+
+#ifdef REALTIME_LATENCY_STATS
+static const uint8_t    NO_LATENCY_SEGMENT = 0xff;
+static volatile uint8_t latency_segment    = NO_LATENCY_SEGMENT;  // First decelerating segment of a timed feed hold
+#endif
+
+// Pointers for the step segment being prepped from the planner buffer. Accessed only under the
+// prep lock. Pointers may be planning segments or planner blocks ahead of what being executed.
 static plan_block_t* pl_block;       // Pointer to the planner block being prepped
 static st_block_t*   st_prep_block;  // Pointer to the stepper block data being prepped
 
@@ -123,6 +149,31 @@ typedef struct {
     //uint16_t current_spindle_pwm;  // todo remove
     float current_spindle_rpm;
 
+    // Arc blocks. The arc is stepped as chords of arc.segment_mm, each with stepper block data of its
+    // own, and segments take their steps from the current chord the way they do from a line.
+    prep_real_t arc_dt_segment;       // Segment time that keeps segments no longer than a chord
+    float       arc_steps_per_mm[3];  // Of axis_0, axis_1 and axis_linear
+    int32_t     arc_steps[3];         // Where the current chord starts, on those axes
+    int32_t     arc_target[3];        // Where the current chord ends
+    uint32_t    arc_chord;            // Index of the current chord
+    uint32_t    arc_chords;           // Number of chords in the arc
+    float       arc_chord_end_mm;     // Where the current chord ends, from the end of the arc
+    bool        arc_chord_loaded;     // The current chord has been given a stepper block
+    bool        arc_st_block_used;    // st_prep_block already holds an earlier chord
+
+    // Jerk-limited ramps, each over the distance the velocity profile gives it.
+    bool  ramp_shaped;       // The current ramp_type has been set up below
+    bool  ramp_hold;         // The ramps are a feed hold's, which may go on into the next block
+    float ramp_start_speed;  // (mm/min)
+    float ramp_end_speed;    // (mm/min)
+    float ramp_start_mm;     // Where the ramp starts and ends, measured from end of block (mm)
+    float ramp_end_mm;
+    float ramp_time;         // (min)
+    float ramp_elapsed;      // (min)
+    float ramp_jerk_time;    // Time the acceleration takes to rise and again to fall (min)
+    float ramp_peak;         // Peak acceleration, negative when slowing down (mm/min^2)
+    float hold_end_mm;       // Where a feed hold comes to a stop, measured from end of block (mm)
+
 } st_prep_t;
 static st_prep_t prep;
 
@@ -193,6 +244,26 @@ stepper_id_t current_stepper = DEFAULT_STEPPER;
 
 static void stepper_pulse_func();
 
+#ifdef STEPPER_ISR_STATS
+static void IRAM_ATTR isr_stats_record(uint32_t cycles) {
+    isr_stats.count++;
+    isr_stats.total_cycles += cycles;
+    if (cycles < isr_stats.min_cycles) {
+        isr_stats.min_cycles = cycles;
+    }
+    if (cycles > isr_stats.max_cycles) {
+        isr_stats.max_cycles = cycles;
+    }
+    uint32_t us  = cycles / isr_stats.cycles_per_us;
+    int      bin = us ? 32 - __builtin_clz(us) : 0;
+    isr_stats.histogram[bin < ISR_HISTOGRAM_BINS ? bin : ISR_HISTOGRAM_BINS - 1]++;
+    // The timer reloads at the alarm, so the next ISR is due one period after this one started.
+    if (cycles * ticksPerMicrosecond > uint32_t(isr_period_ticks) * isr_stats.cycles_per_us) {
+        isr_stats.missed++;
+    }
+}
+#endif
+
 // TODO: Replace direct updating of the int32 position counters in the ISR somehow. Perhaps use smaller
 // int8 variables and update position counters only when a segment completes. This can get complicated
 // with probing and homing cycles that require true real-time positions.
@@ -204,11 +275,23 @@ void IRAM_ATTR onStepperDriverTimer(
         return;  // The busy-flag is used to avoid reentering this interrupt
     }
     busy = true;
+#ifdef STEPPER_ISR_STATS
+    uint32_t isr_start = xthal_get_ccount();
+#endif
 
     stepper_pulse_func();
 
+#ifdef STEPPER_ISR_STATS
+    isr_stats_record(xthal_get_ccount() - isr_start);
+#endif
     TIMERG0.hw_timer[STEP_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
     busy                                               = false;
+#ifdef SEGMENT_PREP_TASK
+    if (prep_task_woken) {
+        prep_task_woken = pdFALSE;
+        portYIELD_FROM_ISR();
+    }
+#endif
 }
 
 /**
@@ -236,6 +319,12 @@ static void stepper_pulse_func() {
         if (segment_buffer_head != segment_buffer_tail) {
             // Initialize new step segment and load number of steps to execute
             st.exec_segment = &segment_buffer[segment_buffer_tail];
+#ifdef REALTIME_LATENCY_STATS
+            if (segment_buffer_tail == latency_segment) {
+                rt_latency_reached_isr(RtLatencyCmd::FeedHold, RtLatencyStage::Step);
+                latency_segment = NO_LATENCY_SEGMENT;
+            }
+#endif
             // Initialize step segment timing per step and load number of steps to execute.
             Stepper_Timer_WritePeriod(st.exec_segment->isrPeriod);
             st.step_count = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
@@ -257,6 +346,10 @@ static void stepper_pulse_func() {
             // Set real-time spindle output as segment is loaded, just prior to the first step.
             spindle->set_rpm(st.exec_segment->spindle_rpm);
         } else {
+            // Prep still owes steps for a block that is not on hold, so the ISR got ahead of it.
+            if (!sys.step_control.endMotion && prep_owes_steps) {
+                segment_underruns++;
+            }
             // Segment buffer empty. Shutdown.
             st_go_idle();
             if (sys.state != State::Jog) {  // added to prevent ... jog after probing crash
@@ -298,9 +391,23 @@ static void stepper_pulse_func() {
     if (st.step_count == 0) {
         // Segment is complete. Discard current segment and advance segment indexing.
         st.exec_segment = NULL;
-        if (++segment_buffer_tail == SEGMENT_BUFFER_SIZE) {
+        if (++segment_buffer_tail == segment_buffer_size) {
             segment_buffer_tail = 0;
         }
+#ifdef SEGMENT_PREP_TASK
+        // Wake the prep task once the buffer has drained to half its depth.
+        int queued = segment_buffer_head - segment_buffer_tail;
+        if (queued < 0) {
+            queued += segment_buffer_size;
+        }
+        if (segmentPrepTaskHandle != NULL && queued < segment_buffer_size / 2) {
+            if (xPortInIsrContext()) {
+                vTaskNotifyGiveFromISR(segmentPrepTaskHandle, &prep_task_woken);  // Yielded on by onStepperDriverTimer()
+            } else {
+                xTaskNotifyGive(segmentPrepTaskHandle);  // Called back from i2sOutTask in I2S stream mode
+            }
+        }
+#endif
     }
 
     switch (current_stepper) {
@@ -332,8 +439,79 @@ void stepper_init() {
 #endif
     // Other stepper use timer interrupt
     Stepper_Timer_Init();
+#ifdef STEPPER_ISR_STATS
+    st_reset_isr_stats();
+#endif
+#ifdef SEGMENT_PREP_TASK
+    prep_mutex = xSemaphoreCreateRecursiveMutex();
+    // Same core as the main loop, so the lock hand-off is a plain preemption.
+    xTaskCreatePinnedToCore(segmentPrepTask,    // task
+                            "segmentPrepTask",  // name for task
+                            4096,               // size of task stack
+                            NULL,               // parameters
+                            3,                  // priority, above the main loop and serialCheckTask
+                            &segmentPrepTaskHandle,
+                            xPortGetCoreID()  // core
+    );
+#endif
+}
+
+#ifdef SEGMENT_PREP_TASK
+// Refills the segment buffer whenever the stepper ISR reports it half empty. Also polls, so
+// that a buffer the ISR has not started on yet gets filled too.
+static void segmentPrepTask(void* pvParameters) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, SEGMENT_PREP_POLL_MS / portTICK_PERIOD_MS);
+        // Same states as protocol_execute_realtime().
+        switch (sys.state) {
+            case State::Cycle:
+            case State::Hold:
+            case State::SafetyDoor:
+            case State::Homing:
+            case State::Sleep:
+            case State::Jog:
+                st_prep_buffer();
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void st_prep_lock() {
+    if (prep_mutex != NULL) {
+        xSemaphoreTakeRecursive(prep_mutex, portMAX_DELAY);
+    }
 }
 
+void st_prep_unlock() {
+    if (prep_mutex != NULL) {
+        xSemaphoreGiveRecursive(prep_mutex);
+    }
+}
+#endif
+
+uint8_t st_get_segment_buffer_size() {
+    return segment_buffer_size;
+}
+
+uint32_t st_get_segment_underruns() {
+    return segment_underruns;
+}
+
+#ifdef STEPPER_ISR_STATS
+// The ISR updates these without locking, so a copy taken mid-ISR can be off by one sample.
+isr_stats_t st_get_isr_stats() {
+    return isr_stats;
+}
+
+void st_reset_isr_stats() {
+    memset(&isr_stats, 0, sizeof(isr_stats));
+    isr_stats.min_cycles    = UINT32_MAX;
+    isr_stats.cycles_per_us = ESP.getCpuFreqMHz();
+}
+#endif
+
 void stepper_switch(stepper_id_t new_stepper) {
     grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Debug, "Switch stepper: %s -> %s", stepper_names[current_stepper], stepper_names[new_stepper]);
     if (current_stepper == new_stepper) {
@@ -375,6 +553,7 @@ void st_reset() {
 #ifdef ESP_DEBUG
     //Serial.println("st_reset()");
 #endif
+    StPrepLock lock;
     // Initialize stepper driver idle state.
 #ifdef USE_I2S_STEPS
     if (current_stepper == ST_I2S_STREAM) {
@@ -387,10 +566,16 @@ void st_reset() {
     memset(&st, 0, sizeof(stepper_t));
     st.exec_segment     = NULL;
     pl_block            = NULL;  // Planner block pointer used by segment buffer
+    prep_owes_steps     = false;
+    segment_buffer_size = segment_buffer_depth->get();
     segment_buffer_tail = 0;
     segment_buffer_head = 0;  // empty = tail
     segment_next_head   = 1;
     busy                = false;
+#ifdef REALTIME_LATENCY_STATS
+    latency_segment = NO_LATENCY_SEGMENT;
+    rt_latency_dropped(RtLatencyCmd::FeedHold);
+#endif
     st.step_outbits     = 0;
     st.dir_outbits      = 0;  // Initialize direction bits to default.
     // TODO do we need to turn step pins off?
@@ -425,6 +610,7 @@ void st_go_idle() {
 
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters() {
+    StPrepLock lock;
     if (pl_block != NULL) {  // Ignore if at start of a new block.
         prep.recalculate_flag.recalculate = 1;
         pl_block->entry_speed_sqr         = prep.current_speed * prep.current_speed;  // Update entry speed.
@@ -435,6 +621,7 @@ void st_update_plan_block_parameters() {
 #ifdef PARKING_ENABLE
 // Changes the run state of the step segment buffer to execute the special parking motion.
 void st_parking_setup_buffer() {
+    StPrepLock lock;
     // Store step execution data of partially completed block, if necessary.
     if (prep.recalculate_flag.holdPartialBlock) {
         prep.last_st_block_index  = prep.st_block_index;
@@ -450,6 +637,7 @@ void st_parking_setup_buffer() {
 
 // Restores the step segment buffer to the normal run state after a parking motion.
 void st_parking_restore_buffer() {
+    StPrepLock lock;
     // Restore step execution data and flags of partially completed block, if necessary.
     if (prep.recalculate_flag.holdPartialBlock) {
         st_prep_block                          = &st_block_buffer[prep.last_st_block_index];
@@ -463,6 +651,8 @@ void st_parking_restore_buffer() {
     } else {
         prep.recalculate_flag = {};
     }
+    prep.ramp_shaped = false;  // The parking motion's ramps are over
+    prep.ramp_hold   = false;
 
     pl_block = NULL;  // Set to reload next block.
 }
@@ -471,7 +661,314 @@ void st_parking_restore_buffer() {
 // Increments the step segment buffer block data ring buffer.
 static uint8_t st_next_block_index(uint8_t block_index) {
     block_index++;
-    return block_index == (SEGMENT_BUFFER_SIZE - 1) ? 0 : block_index;
+    return block_index == (segment_buffer_size - 1) ? 0 : block_index;
+}
+
+// Sets prep.arc_target to the end of chord prep.arc_chord, and returns the number of step events on
+// the chord. The end is found from the start of the arc, never from where segments ended, so the
+// chords, and the steps along them, do not depend on how segment prep cuts up the arc.
+static uint32_t st_prep_arc_chord() {
+    const plan_arc_t& arc = pl_block->arc;
+    if (prep.arc_chord + 1 >= prep.arc_chords) {
+        memcpy(prep.arc_target, arc.end_steps, sizeof(prep.arc_target));  // Exactly where the planner ended it
+        prep.arc_chord_end_mm = 0.0;
+    } else {
+        float mm              = (prep.arc_chord + 1) * arc.segment_mm;
+        float fraction        = mm / arc.length;
+        float angle           = arc.angular_travel * fraction;
+        float cos_a           = cosf(angle);
+        float sin_a           = sinf(angle);
+        prep.arc_target[0]    = lroundf((arc.center[0] + arc.start[0] * cos_a - arc.start[1] * sin_a) * prep.arc_steps_per_mm[0]);
+        prep.arc_target[1]    = lroundf((arc.center[1] + arc.start[0] * sin_a + arc.start[1] * cos_a) * prep.arc_steps_per_mm[1]);
+        prep.arc_target[2]    = lroundf((arc.linear_start + arc.linear_travel * fraction) * prep.arc_steps_per_mm[2]);
+        prep.arc_chord_end_mm = MAX(arc.length - mm, 0.0f);
+    }
+    uint32_t step_event_count = 0;
+    for (int i = 0; i < 3; i++) {
+        step_event_count = MAX(step_event_count, uint32_t(labs(prep.arc_target[i] - prep.arc_steps[i])));
+    }
+    return step_event_count;
+}
+
+// Starts the chord at prep.arc_chord, or the first one after it with a step, and gives it the
+// Bresenham data of a stepper block. Called as a segment is about to be prepped, when the segment
+// buffer has room, so the stepper block it takes is free. Every chord but the first takes the next
+// stepper block, as the ISR may still be on the previous one.
+static void st_prep_arc_load_chord() {
+    const plan_arc_t& arc              = pl_block->arc;
+    float             start_mm         = prep.arc_chord_end_mm;
+    uint32_t          step_event_count = st_prep_arc_chord();
+    while (step_event_count == 0 && prep.arc_chord + 1 < prep.arc_chords) {
+        prep.arc_chord++;
+        step_event_count = st_prep_arc_chord();
+    }
+    prep.arc_chord_loaded = true;
+    prep.steps_remaining  = step_event_count;
+    if (step_event_count == 0) {  // No steps left in the arc
+        prep.step_per_mm = 0.0;
+        return;
+    }
+    prep.step_per_mm = step_event_count / (start_mm - prep.arc_chord_end_mm);
+
+    if (prep.arc_st_block_used) {
+        uint8_t is_pwm_rate_adjusted        = st_prep_block->is_pwm_rate_adjusted;
+        prep.st_block_index                 = st_next_block_index(prep.st_block_index);
+        st_prep_block                       = &st_block_buffer[prep.st_block_index];
+        st_prep_block->is_pwm_rate_adjusted = is_pwm_rate_adjusted;
+    }
+    prep.arc_st_block_used = true;
+
+    const uint8_t axes[3] = { arc.axis_0, arc.axis_1, arc.axis_linear };
+    memset(st_prep_block->steps, 0, sizeof(st_prep_block->steps));
+    st_prep_block->direction_bits = 0;
+    for (int i = 0; i < 3; i++) {
+        int32_t delta = prep.arc_target[i] - prep.arc_steps[i];
+        if (delta < 0) {
+            st_prep_block->direction_bits |= bit(axes[i]);
+            delta = -delta;
+        }
+        st_prep_block->steps[axes[i]] = uint32_t(delta) << maxAmassLevel;
+        prep.arc_steps[i]             = prep.arc_target[i];
+    }
+    st_prep_block->step_event_count = step_event_count << maxAmassLevel;
+}
+
+// Sets up segment prep for a new arc block, on its first chord. The stepper block data
+// st_prep_block was loaded with goes to that chord.
+static void st_prep_arc_init() {
+    const plan_arc_t& arc         = pl_block->arc;
+    const uint8_t     axes[3]     = { arc.axis_0, arc.axis_1, arc.axis_linear };
+    float             step_per_mm = 0.0;
+    for (int i = 0; i < 3; i++) {
+        prep.arc_steps_per_mm[i] = axis_settings[axes[i]]->steps_per_mm->get();
+        prep.arc_steps[i]        = arc.start_steps[i];
+        step_per_mm              = MAX(step_per_mm, prep.arc_steps_per_mm[i]);  // Finest axis, for minimum_mm
+    }
+    prep.req_mm_increment  = REQ_MM_INCREMENT_SCALAR / step_per_mm;
+    prep.arc_chord         = 0;
+    prep.arc_chords        = arc.segment_mm < arc.length ? uint32_t(ceilf(arc.length / arc.segment_mm)) : 1;
+    prep.arc_chord_end_mm  = pl_block->millimeters;  // Where the first chord starts
+    prep.arc_st_block_used = false;
+    st_prep_arc_load_chord();
+}
+
+// Sets up a jerk-limited ramp of the current ramp_type from mm_start, where the speed is
+// prep.current_speed. The acceleration rises at the block's jerk limit, holds, and falls again, in
+// the time the ramp's distance takes at its average speed. The velocity profile gives every ramp at
+// least plan_jerk_ramp_mm(), so that even a small change in speed keeps to the jerk limit, as a
+// triangle that peaks at sqrt(jerk * change).
+static void st_prep_ramp_init(float mm_start) {
+    prep.ramp_shaped      = true;
+    prep.ramp_start_speed = prep.current_speed;
+    prep.ramp_start_mm    = mm_start;
+    if (prep.ramp_hold) {
+        prep.ramp_end_speed = 0.0;
+        prep.ramp_end_mm    = prep.hold_end_mm;
+    } else if (prep.ramp_type == RAMP_DECEL) {
+        prep.ramp_end_speed = prep.exit_speed;
+        prep.ramp_end_mm    = prep.mm_complete;
+    } else {  // RAMP_ACCEL or RAMP_DECEL_OVERRIDE
+        prep.ramp_end_speed = prep.maximum_speed;
+        prep.ramp_end_mm    = prep.accelerate_until;
+    }
+    float delta_speed = prep.ramp_end_speed - prep.ramp_start_speed;
+    float total_speed = prep.ramp_end_speed + prep.ramp_start_speed;
+    float ramp_time   = total_speed > 0.0f ? 2.0f * (mm_start - prep.ramp_end_mm) / total_speed : 0.0f;
+    float change      = fabsf(delta_speed);
+    float jerk_time   = 0.0;
+    // With jerk time tj, the speed changes by peak * (ramp_time - tj) and peak = jerk * tj. The shortest
+    // ramp the profile gives has tj = ramp_time / 2, which rounding may take a hair past.
+    float discriminant = ramp_time * ramp_time - 4.0f * change / pl_block->jerk;
+    if (change > 0.0f && discriminant >= -0.01f * ramp_time * ramp_time) {
+        jerk_time = 2.0f * change / (pl_block->jerk * (ramp_time + sqrtf(MAX(discriminant, 0.0f))));
+        // A change large enough to reach the acceleration limit holds it there for longer instead.
+        if (change > pl_block->acceleration * (ramp_time - jerk_time)) {
+            jerk_time = MAX(0.0f, ramp_time - change / pl_block->acceleration);
+        }
+    }
+    prep.ramp_time      = ramp_time;
+    prep.ramp_elapsed   = 0.0;
+    prep.ramp_jerk_time = jerk_time;
+    prep.ramp_peak      = ramp_time > 0.0f ? delta_speed / (ramp_time - jerk_time) : 0.0f;
+}
+
+// Returns the speed t into the ramp, and sets *mm to the distance covered by then.
+static float st_prep_ramp_at(float t, float* mm) {
+    float tj   = prep.ramp_jerk_time;
+    float peak = prep.ramp_peak;
+    float v0   = prep.ramp_start_speed;
+    float v1   = prep.ramp_end_speed;
+    float left = prep.ramp_time - t;
+    if (t < tj) {  // Acceleration rising
+        *mm = t * (v0 + peak * t * t / (6.0f * tj));
+        return v0 + peak * t * t / (2.0f * tj);
+    }
+    if (left < tj) {  // Acceleration falling, the mirror image of the above
+        *mm = 0.5f * (v0 + v1) * prep.ramp_time - left * (v1 - peak * left * left / (6.0f * tj));
+        return v1 - peak * left * left / (2.0f * tj);
+    }
+    *mm = t * (v0 + 0.5f * peak * (t - tj)) + peak * tj * tj / 6.0f;
+    return v0 + peak * (t - 0.5f * tj);
+}
+
+// Returns the acceleration where the ramp has got to (mm/min^2).
+static float st_prep_ramp_accel() {
+    float tj   = prep.ramp_jerk_time;
+    float left = prep.ramp_time - prep.ramp_elapsed;
+    if (prep.ramp_elapsed < tj) {
+        return prep.ramp_peak * prep.ramp_elapsed / tj;
+    }
+    if (left < tj) {
+        return prep.ramp_peak * left / tj;
+    }
+    return prep.ramp_peak;
+}
+
+// Advances a jerk-limited ramp by time_var. Returns false if that takes it to its end, where
+// time_var is cut to the time that was left, or to the end of the block, which only a feed hold's
+// ramp goes on past. Such a ramp stops there, and the next block takes it up.
+static bool st_prep_ramp_step(float& time_var, float& mm_remaining) {
+    float t = MIN(prep.ramp_elapsed + time_var, prep.ramp_time);
+    float mm;
+    float speed = st_prep_ramp_at(t, &mm);
+    if (prep.ramp_end_mm < prep.mm_complete && prep.ramp_start_mm - mm <= prep.mm_complete) {
+        float mm_block = prep.ramp_start_mm - prep.mm_complete;
+        float early    = prep.ramp_elapsed;
+        for (int i = 0; i < 20; i++) {  // Find when the ramp reaches the end of the block
+            float mid = 0.5f * (early + t);
+            st_prep_ramp_at(mid, &mm);
+            if (mm < mm_block) {
+                early = mid;
+            } else {
+                t = mid;
+            }
+        }
+        time_var           = t - prep.ramp_elapsed;
+        mm_remaining       = prep.mm_complete;
+        prep.current_speed = st_prep_ramp_at(t, &mm);
+        prep.ramp_elapsed  = t;
+        return false;
+    }
+    if (prep.ramp_elapsed + time_var < prep.ramp_time) {
+        prep.current_speed = speed;
+        prep.ramp_elapsed  = t;
+        mm_remaining       = MAX(prep.ramp_start_mm - mm, prep.ramp_end_mm);
+        return true;
+    }
+    time_var           = prep.ramp_time - prep.ramp_elapsed;
+    mm_remaining       = prep.ramp_end_mm;
+    prep.current_speed = prep.ramp_end_speed;
+    prep.ramp_shaped   = false;
+    return false;
+}
+
+// Starts a feed hold in a block with a jerk limit, from mm_start. A ramp that is speeding up has its
+// acceleration fall back to zero at the jerk limit, as in the second half of a triangle, and one that
+// is slowing down runs to its end. The speed then ramps down to a stop at prep.hold_end_mm, which may
+// be in a later block.
+static void st_prep_hold_init(float mm_start) {
+    float speed    = prep.current_speed;
+    float accel    = prep.ramp_shaped ? st_prep_ramp_accel() : 0.0f;
+    prep.ramp_hold = true;
+    if (accel > 0.0f) {
+        float jerk_time       = accel / pl_block->jerk;
+        float delta_speed     = 0.5f * accel * jerk_time;
+        prep.ramp_start_speed = speed - delta_speed;
+        prep.ramp_end_speed   = speed + delta_speed;
+        prep.ramp_time        = 2.0f * jerk_time;
+        prep.ramp_elapsed     = jerk_time;
+        prep.ramp_jerk_time   = jerk_time;
+        prep.ramp_peak        = accel;
+        float mm;
+        st_prep_ramp_at(jerk_time, &mm);
+        prep.ramp_start_mm = mm_start + mm;
+        prep.ramp_end_mm   = prep.ramp_start_mm - speed * prep.ramp_time;
+    } else if (accel == 0.0f) {
+        prep.ramp_shaped = false;
+    }
+    if (prep.ramp_shaped) {
+        mm_start = prep.ramp_end_mm;
+        speed    = prep.ramp_end_speed;
+    }
+    prep.hold_end_mm = mm_start - plan_jerk_ramp_mm(pl_block, speed, 0.0);
+}
+
+// Returns the lowest speed, down to floor, that a ramp can slow down to from speed within mm.
+static float st_prep_ramp_down_speed(float speed, float floor, float mm) {
+    if (plan_jerk_ramp_mm(pl_block, speed, floor) <= mm) {
+        return floor;
+    }
+    for (int i = 0; i < 20; i++) {  // The distance is not monotonic, so this finds one that fits
+        float mid = 0.5f * (floor + speed);
+        if (plan_jerk_ramp_mm(pl_block, speed, mid) <= mm) {
+            speed = mid;
+        } else {
+            floor = mid;
+        }
+    }
+    return speed;
+}
+
+// Computes the velocity profile of a block with a jerk limit, like the linear one in st_prep_buffer()
+// but with every ramp as long as plan_jerk_ramp_mm() makes it.
+static void st_prep_jerk_profile(float nominal_speed) {
+    float mm          = pl_block->millimeters;
+    float entry_speed = sqrtf(pl_block->entry_speed_sqr);
+    float exit_speed  = prep.exit_speed;
+    if (entry_speed > nominal_speed) {  // Only occurs during override reductions.
+        float to_nominal = plan_jerk_ramp_mm(pl_block, entry_speed, nominal_speed);
+        float to_exit    = plan_jerk_ramp_mm(pl_block, nominal_speed, exit_speed);
+        if (to_nominal + to_exit <= mm) {
+            prep.accelerate_until = mm - to_nominal;
+            prep.decelerate_after = to_exit;
+            prep.maximum_speed    = nominal_speed;
+            prep.ramp_type        = RAMP_DECEL_OVERRIDE;
+        } else {
+            // Slows down all the way, past the nominal speed, and if even that is too short, the next
+            // block carries on slowing down.
+            prep.ramp_type = RAMP_DECEL;
+            if (to_nominal >= mm) {
+                prep.exit_speed                     = st_prep_ramp_down_speed(entry_speed, nominal_speed, mm);
+                prep.recalculate_flag.decelOverride = 1;
+            }
+        }
+        return;
+    }
+    float top_speed = MAX(entry_speed, exit_speed);
+    if (plan_jerk_ramp_mm(pl_block, entry_speed, exit_speed) >= mm) {
+        if (entry_speed >= exit_speed) {  // Deceleration-only type
+            prep.ramp_type = RAMP_DECEL;
+        } else {  // Acceleration-only type
+            prep.accelerate_until = 0.0;
+            prep.maximum_speed    = exit_speed;
+        }
+        return;
+    }
+    float to_top = plan_jerk_ramp_mm(pl_block, entry_speed, nominal_speed);
+    float to_end = plan_jerk_ramp_mm(pl_block, nominal_speed, exit_speed);
+    if (to_top + to_end > mm) {
+        // Triangle type. The distance grows with the top speed, which is found by bisection. What is
+        // left over cruises at it.
+        float low  = top_speed;
+        float high = nominal_speed;
+        for (int i = 0; i < 20; i++) {
+            float mid = 0.5f * (low + high);
+            if (plan_jerk_ramp_mm(pl_block, entry_speed, mid) + plan_jerk_ramp_mm(pl_block, mid, exit_speed) <= mm) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        nominal_speed = low;
+        to_top        = plan_jerk_ramp_mm(pl_block, entry_speed, nominal_speed);
+        to_end        = plan_jerk_ramp_mm(pl_block, nominal_speed, exit_speed);
+    }
+    prep.maximum_speed    = nominal_speed;
+    prep.decelerate_after = to_end;
+    prep.accelerate_until = mm - to_top;
+    if (entry_speed == nominal_speed) {  // Cruise-deceleration or cruise-only type.
+        prep.ramp_type = RAMP_CRUISE;
+    }
 }
 
 /* Prepares step segment buffer. Continuously called from main program.
@@ -488,6 +985,7 @@ static uint8_t st_next_block_index(uint8_t block_index) {
    NOTE: Computation units are in steps, millimeters, and minutes.
 */
 void st_prep_buffer() {
+    StPrepLock lock;
     // Block step prep buffer, while in a suspend state and there is no suspend motion to execute.
     if (sys.step_control.endMotion) {
         return;
@@ -503,6 +1001,7 @@ void st_prep_buffer() {
                 pl_block = plan_get_current_block();
             }
 
+            prep_owes_steps = pl_block != NULL;
             if (pl_block == NULL) {
                 return;  // No planner blocks. Exit.
             }
@@ -542,10 +1041,24 @@ void st_prep_buffer() {
                 prep.step_per_mm      = prep.steps_remaining / pl_block->millimeters;
                 prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR / prep.step_per_mm;
                 prep.dt_remainder     = 0.0;  // Reset for new segment block
+                if (prep.ramp_hold && sys.step_control.executeHold && pl_block->jerk > 0.0f) {
+                    // A feed hold's ramp that went past the last block goes on here.
+                    prep.ramp_start_mm += pl_block->millimeters;
+                    prep.ramp_end_mm += pl_block->millimeters;
+                    prep.hold_end_mm += pl_block->millimeters;
+                } else {
+                    prep.ramp_shaped = false;
+                    prep.ramp_hold   = false;
+                }
+                if (pl_block->motion.arcMotion) {
+                    st_prep_arc_init();
+                }
                 if ((sys.step_control.executeHold) || prep.recalculate_flag.decelOverride) {
                     // New block loaded mid-hold. Override planner block entry speed to enforce deceleration.
-                    prep.current_speed                  = prep.exit_speed;
-                    pl_block->entry_speed_sqr           = prep.exit_speed * prep.exit_speed;
+                    if (!prep.ramp_hold) {  // A feed hold's ramp has left current_speed where it got to
+                        prep.current_speed = prep.exit_speed;
+                    }
+                    pl_block->entry_speed_sqr           = prep.current_speed * prep.current_speed;
                     prep.recalculate_flag.decelOverride = 0;
                 } else {
                     prep.current_speed = sqrt(pl_block->entry_speed_sqr);
@@ -554,11 +1067,12 @@ void st_prep_buffer() {
                 if (spindle->isRateAdjusted()) {  //   laser_mode->get() {
                     if (pl_block->spindle == SpindleState::Ccw) {
                         // Pre-compute inverse programmed rate to speed up PWM updating per step segment.
-                        prep.inv_rate                       = 1.0 / pl_block->programmed_rate;
+                        prep.inv_rate                       = prep_real_t(1.0) / pl_block->programmed_rate;
                         st_prep_block->is_pwm_rate_adjusted = true;
                     }
                 }
             }
+            uint8_t last_ramp_type = prep.ramp_type;
             /* ---------------------------------------------------------------------------------
              Compute the velocity profile of a new planner block based on its entry and exit
              speeds, or recompute the profile of a partially-completed planner block if the
@@ -566,14 +1080,20 @@ void st_prep_buffer() {
              hold, override the planner velocities and decelerate to the target exit speed.
             */
             prep.mm_complete  = 0.0;  // Default velocity profile complete at 0.0mm from end of block.
-            float inv_2_accel = 0.5 / pl_block->acceleration;
+            float inv_2_accel = prep_real_t(0.5) / pl_block->acceleration;
             if (sys.step_control.executeHold) {  // [Forced Deceleration to Zero Velocity]
                 // Compute velocity profile parameters for a feed hold in-progress. This profile overrides
                 // the planner block profile, enforcing a deceleration to zero speed.
                 prep.ramp_type = RAMP_DECEL;
                 // Compute decelerate distance relative to end of block.
                 float decel_dist = pl_block->millimeters - inv_2_accel * pl_block->entry_speed_sqr;
-                if (decel_dist < 0.0) {
+                if (pl_block->jerk > 0.0f) {
+                    if (!prep.ramp_hold) {
+                        st_prep_hold_init(pl_block->millimeters);
+                    }
+                    prep.mm_complete = MAX(prep.hold_end_mm, 0.0f);  // Or the end of the block, if the stop is past it
+                    prep.exit_speed  = 0.0;
+                } else if (decel_dist < 0.0f) {
                     // Deceleration through entire planner block. End of feed hold is not in this block.
                     prep.exit_speed = sqrt(pl_block->entry_speed_sqr - 2 * pl_block->acceleration * pl_block->millimeters);
                 } else {
@@ -583,6 +1103,7 @@ void st_prep_buffer() {
             } else {  // [Normal Operation]
                 // Compute or recompute velocity profile parameters of the prepped planner block.
                 prep.ramp_type        = RAMP_ACCEL;  // Initialize as acceleration ramp.
+                prep.ramp_hold        = false;
                 prep.accelerate_until = pl_block->millimeters;
                 float exit_speed_sqr;
                 float nominal_speed;
@@ -595,10 +1116,12 @@ void st_prep_buffer() {
 
                 nominal_speed            = plan_compute_profile_nominal_speed(pl_block);
                 float nominal_speed_sqr  = nominal_speed * nominal_speed;
-                float intersect_distance = 0.5 * (pl_block->millimeters + inv_2_accel * (pl_block->entry_speed_sqr - exit_speed_sqr));
-                if (pl_block->entry_speed_sqr > nominal_speed_sqr) {  // Only occurs during override reductions.
+                float intersect_distance = prep_real_t(0.5) * (pl_block->millimeters + inv_2_accel * (pl_block->entry_speed_sqr - exit_speed_sqr));
+                if (pl_block->jerk > 0.0f) {
+                    st_prep_jerk_profile(nominal_speed);
+                } else if (pl_block->entry_speed_sqr > nominal_speed_sqr) {  // Only occurs during override reductions.
                     prep.accelerate_until = pl_block->millimeters - inv_2_accel * (pl_block->entry_speed_sqr - nominal_speed_sqr);
-                    if (prep.accelerate_until <= 0.0) {  // Deceleration-only.
+                    if (prep.accelerate_until <= 0.0f) {  // Deceleration-only.
                         prep.ramp_type = RAMP_DECEL;
                         // prep.decelerate_after = pl_block->millimeters;
                         // prep.maximum_speed = prep.current_speed;
@@ -614,7 +1137,7 @@ void st_prep_buffer() {
                         prep.maximum_speed    = nominal_speed;
                         prep.ramp_type        = RAMP_DECEL_OVERRIDE;
                     }
-                } else if (intersect_distance > 0.0) {
+                } else if (intersect_distance > 0.0f) {
                     if (intersect_distance < pl_block->millimeters) {  // Either trapezoid or triangle types
                         // NOTE: For acceleration-cruise and cruise-only types, following calculation will be 0.0.
                         prep.decelerate_after = inv_2_accel * (nominal_speed_sqr - exit_speed_sqr);
@@ -630,7 +1153,7 @@ void st_prep_buffer() {
                         } else {  // Triangle type
                             prep.accelerate_until = intersect_distance;
                             prep.decelerate_after = intersect_distance;
-                            prep.maximum_speed    = sqrt(2.0 * pl_block->acceleration * intersect_distance + exit_speed_sqr);
+                            prep.maximum_speed    = sqrt(prep_real_t(2.0) * pl_block->acceleration * intersect_distance + exit_speed_sqr);
                         }
                     } else {  // Deceleration-only type
                         prep.ramp_type = RAMP_DECEL;
@@ -644,9 +1167,38 @@ void st_prep_buffer() {
                 }
             }
 
+            if (prep.ramp_shaped && !prep.ramp_hold) {
+                // The planner recalculates the block whenever new blocks raise its exit speed. Carry on
+                // with a jerk-limited ramp that still heads for the same speed, rather than dropping its
+                // acceleration to zero to start over from here.
+                bool same = prep.ramp_type == last_ramp_type;
+                if (prep.ramp_type == RAMP_DECEL) {
+                    same = same && prep.exit_speed == prep.ramp_end_speed && prep.mm_complete == prep.ramp_end_mm;
+                } else {
+                    same = same && prep.maximum_speed == prep.ramp_end_speed && prep.decelerate_after <= prep.ramp_end_mm;
+                    if (same) {
+                        prep.accelerate_until = prep.ramp_end_mm;
+                    }
+                }
+                prep.ramp_shaped = same;
+            }
+
+            if (pl_block->motion.arcMotion) {
+                // Shorten segments that would be longer than a chord at the block's top speed.
+                float top_speed     = MAX(prep.current_speed, plan_compute_profile_nominal_speed(pl_block));
+                prep.arc_dt_segment = DT_SEGMENT;
+                if (pl_block->arc.segment_mm < top_speed * DT_SEGMENT) {
+                    prep.arc_dt_segment = pl_block->arc.segment_mm / top_speed;
+                }
+            }
+
             sys.step_control.updateSpindleRpm = true;  // Force update whenever updating block.
         }
 
+        if (pl_block->motion.arcMotion && !prep.arc_chord_loaded) {
+            st_prep_arc_load_chord();
+        }
+
         // Initialize new segment
         segment_t* prep_segment = &segment_buffer[segment_buffer_head];
 
@@ -667,82 +1219,101 @@ void st_prep_buffer() {
           the end of planner block (typical) or mid-block at the end of a forced deceleration,
           such as from a feed hold.
         */
-        float dt_max   = DT_SEGMENT;                                // Maximum segment time
-        float dt       = 0.0;                                       // Initialize segment time
-        float time_var = dt_max;                                    // Time worker variable
-        float mm_var;                                               // mm-Distance worker variable
-        float speed_var;                                            // Speed worker variable
-        float mm_remaining = pl_block->millimeters;                 // New segment distance from end of block.
-        float minimum_mm   = mm_remaining - prep.req_mm_increment;  // Guarantee at least one step.
-
-        if (minimum_mm < 0.0) {
+        bool        is_arc     = pl_block->motion.arcMotion;
+        prep_real_t dt_segment = is_arc ? prep.arc_dt_segment : DT_SEGMENT;
+        float       dt_max     = dt_segment;                                  // Maximum segment time
+        float       dt         = 0.0;                                         // Initialize segment time
+        float       time_var   = dt_max;                                      // Time worker variable
+        float       mm_var;                                                   // mm-Distance worker variable
+        float       speed_var;                                                // Speed worker variable
+        float       mm_remaining = pl_block->millimeters;                     // New segment distance from end of block.
+        float       minimum_mm   = mm_remaining - prep.req_mm_increment;      // Guarantee at least one step.
+
+        if (minimum_mm < 0.0f) {
             minimum_mm = 0.0;
         }
 
-        do {
-            switch (prep.ramp_type) {
-                case RAMP_DECEL_OVERRIDE:
-                    speed_var = pl_block->acceleration * time_var;
-                    mm_var    = time_var * (prep.current_speed - 0.5 * speed_var);
-                    mm_remaining -= mm_var;
-                    if ((mm_remaining < prep.accelerate_until) || (mm_var <= 0)) {
-                        // Cruise or cruise-deceleration types only for deceleration override.
-                        mm_remaining       = prep.accelerate_until;  // NOTE: 0.0 at EOB
-                        time_var           = 2.0 * (pl_block->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
-                        prep.ramp_type     = RAMP_CRUISE;
-                        prep.current_speed = prep.maximum_speed;
-                    } else {  // Mid-deceleration override ramp.
-                        prep.current_speed -= speed_var;
+        // An arc's last segments may start with nothing left but the steps of the chords the segment
+        // before went past. Those go out in the time it spent past them.
+        while (mm_remaining > prep.mm_complete) {
+            if (pl_block->jerk > 0.0f && prep.ramp_type != RAMP_CRUISE) {
+                if (!prep.ramp_shaped) {
+                    st_prep_ramp_init(mm_remaining);
+                }
+                if (!st_prep_ramp_step(time_var, mm_remaining)) {  // End of ramp
+                    if (prep.ramp_type == RAMP_ACCEL) {
+                        prep.ramp_type = mm_remaining == prep.decelerate_after ? RAMP_DECEL : RAMP_CRUISE;
+                    } else if (prep.ramp_type == RAMP_DECEL_OVERRIDE) {
+                        prep.ramp_type = RAMP_CRUISE;
                     }
-                    break;
-                case RAMP_ACCEL:
-                    // NOTE: Acceleration ramp only computes during first do-while loop.
-                    speed_var = pl_block->acceleration * time_var;
-                    mm_remaining -= time_var * (prep.current_speed + 0.5 * speed_var);
-                    if (mm_remaining < prep.accelerate_until) {  // End of acceleration ramp.
-                        // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
-                        mm_remaining = prep.accelerate_until;  // NOTE: 0.0 at EOB
-                        time_var     = 2.0 * (pl_block->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
-                        if (mm_remaining == prep.decelerate_after) {
-                            prep.ramp_type = RAMP_DECEL;
-                        } else {
-                            prep.ramp_type = RAMP_CRUISE;
+                }
+            } else {
+                switch (prep.ramp_type) {
+                    case RAMP_DECEL_OVERRIDE:
+                        speed_var = pl_block->acceleration * time_var;
+                        mm_var    = time_var * (prep.current_speed - prep_real_t(0.5) * speed_var);
+                        mm_remaining -= mm_var;
+                        if ((mm_remaining < prep.accelerate_until) || (mm_var <= 0)) {
+                            // Cruise or cruise-deceleration types only for deceleration override.
+                            mm_remaining       = prep.accelerate_until;  // NOTE: 0.0 at EOB
+                            time_var           = prep_real_t(2.0) * (pl_block->millimeters - mm_remaining) /
+                                       (prep.current_speed + prep.maximum_speed);
+                            prep.ramp_type     = RAMP_CRUISE;
+                            prep.current_speed = prep.maximum_speed;
+                        } else {  // Mid-deceleration override ramp.
+                            prep.current_speed -= speed_var;
                         }
-                        prep.current_speed = prep.maximum_speed;
-                    } else {  // Acceleration only.
-                        prep.current_speed += speed_var;
-                    }
-                    break;
-                case RAMP_CRUISE:
-                    // NOTE: mm_var used to retain the last mm_remaining for incomplete segment time_var calculations.
-                    // NOTE: If maximum_speed*time_var value is too low, round-off can cause mm_var to not change. To
-                    //   prevent this, simply enforce a minimum speed threshold in the planner.
-                    mm_var = mm_remaining - prep.maximum_speed * time_var;
-                    if (mm_var < prep.decelerate_after) {  // End of cruise.
-                        // Cruise-deceleration junction or end of block.
-                        time_var       = (mm_remaining - prep.decelerate_after) / prep.maximum_speed;
-                        mm_remaining   = prep.decelerate_after;  // NOTE: 0.0 at EOB
-                        prep.ramp_type = RAMP_DECEL;
-                    } else {  // Cruising only.
-                        mm_remaining = mm_var;
-                    }
-                    break;
-                default:  // case RAMP_DECEL:
-                    // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
-                    speed_var = pl_block->acceleration * time_var;  // Used as delta speed (mm/min)
-                    if (prep.current_speed > speed_var) {           // Check if at or below zero speed.
-                        // Compute distance from end of segment to end of block.
-                        mm_var = mm_remaining - time_var * (prep.current_speed - 0.5 * speed_var);  // (mm)
-                        if (mm_var > prep.mm_complete) {                                            // Typical case. In deceleration ramp.
+                        break;
+                    case RAMP_ACCEL:
+                        // NOTE: Acceleration ramp only computes during first do-while loop.
+                        speed_var = pl_block->acceleration * time_var;
+                        mm_remaining -= time_var * (prep.current_speed + prep_real_t(0.5) * speed_var);
+                        if (mm_remaining < prep.accelerate_until) {  // End of acceleration ramp.
+                            // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
+                            mm_remaining = prep.accelerate_until;  // NOTE: 0.0 at EOB
+                            time_var     = prep_real_t(2.0) * (pl_block->millimeters - mm_remaining) /
+                                       (prep.current_speed + prep.maximum_speed);
+                            if (mm_remaining == prep.decelerate_after) {
+                                prep.ramp_type = RAMP_DECEL;
+                            } else {
+                                prep.ramp_type = RAMP_CRUISE;
+                            }
+                            prep.current_speed = prep.maximum_speed;
+                        } else {  // Acceleration only.
+                            prep.current_speed += speed_var;
+                        }
+                        break;
+                    case RAMP_CRUISE:
+                        // NOTE: mm_var used to retain the last mm_remaining for incomplete segment time_var calculations.
+                        // NOTE: If maximum_speed*time_var value is too low, round-off can cause mm_var to not change. To
+                        //   prevent this, simply enforce a minimum speed threshold in the planner.
+                        mm_var = mm_remaining - prep.maximum_speed * time_var;
+                        if (mm_var < prep.decelerate_after) {  // End of cruise.
+                            // Cruise-deceleration junction or end of block.
+                            time_var       = (mm_remaining - prep.decelerate_after) / prep.maximum_speed;
+                            mm_remaining   = prep.decelerate_after;  // NOTE: 0.0 at EOB
+                            prep.ramp_type = RAMP_DECEL;
+                        } else {  // Cruising only.
                             mm_remaining = mm_var;
-                            prep.current_speed -= speed_var;
-                            break;  // Segment complete. Exit switch-case statement. Continue do-while loop.
                         }
-                    }
-                    // Otherwise, at end of block or end of forced-deceleration.
-                    time_var           = 2.0 * (mm_remaining - prep.mm_complete) / (prep.current_speed + prep.exit_speed);
-                    mm_remaining       = prep.mm_complete;
-                    prep.current_speed = prep.exit_speed;
+                        break;
+                    default:  // case RAMP_DECEL:
+                        // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
+                        speed_var = pl_block->acceleration * time_var;  // Used as delta speed (mm/min)
+                        if (prep.current_speed > speed_var) {           // Check if at or below zero speed.
+                            // Compute distance from end of segment to end of block.
+                            mm_var = mm_remaining - time_var * (prep.current_speed - prep_real_t(0.5) * speed_var);  // (mm)
+                            if (mm_var > prep.mm_complete) {  // Typical case. In deceleration ramp.
+                                mm_remaining = mm_var;
+                                prep.current_speed -= speed_var;
+                                break;  // Segment complete. Exit switch-case statement. Continue do-while loop.
+                            }
+                        }
+                        // Otherwise, at end of block or end of forced-deceleration.
+                        time_var           = prep_real_t(2.0) * (mm_remaining - prep.mm_complete) / (prep.current_speed + prep.exit_speed);
+                        mm_remaining       = prep.mm_complete;
+                        prep.current_speed = prep.exit_speed;
+                }
             }
 
             dt += time_var;  // Add computed ramp time to total segment time.
@@ -752,13 +1323,13 @@ void st_prep_buffer() {
                 if (mm_remaining > minimum_mm) {  // Check for very slow segments with zero steps.
                     // Increase segment time to ensure at least one step in segment. Override and loop
                     // through distance calculations until minimum_mm or mm_complete.
-                    dt_max += DT_SEGMENT;
+                    dt_max += dt_segment;
                     time_var = dt_max - dt;
                 } else {
                     break;  // **Complete** Exit loop. Segment execution time maxed.
                 }
             }
-        } while (mm_remaining > prep.mm_complete);  // **Complete** Exit loop. Profile complete.
+        }  // **Complete** Exit loop. Profile complete.
 
         /* -----------------------------------------------------------------------------------
           Compute spindle speed PWM output for step segment
@@ -794,10 +1365,20 @@ void st_prep_buffer() {
            Fortunately, this scenario is highly unlikely and unrealistic in CNC machines
            supported by Grbl (i.e. exceeding 10 meters axis travel at 200 step/mm).
         */
-        float step_dist_remaining    = prep.step_per_mm * mm_remaining;             // Convert mm_remaining to steps
-        float n_steps_remaining      = ceil(step_dist_remaining);                   // Round-up current steps remaining
-        float last_n_steps_remaining = ceil(prep.steps_remaining);                  // Round-up last steps remaining
-        prep_segment->n_step         = last_n_steps_remaining - n_steps_remaining;  // Compute number of steps to execute.
+        float step_dist_remaining    = 0.0;
+        float n_steps_remaining      = 0.0;
+        float last_n_steps_remaining = 0.0;
+        if (is_arc) {
+            // Arc segments step along the current chord as far as they reach, but not past its end.
+            // The time spent past it goes to the next segment, which takes the steps of the next chord.
+            step_dist_remaining = prep.step_per_mm * (mm_remaining - prep.arc_chord_end_mm);
+            n_steps_remaining   = MAX(ceil(step_dist_remaining), 0.0f);
+        } else {
+            step_dist_remaining = prep.step_per_mm * mm_remaining;  // Convert mm_remaining to steps
+            n_steps_remaining   = ceil(step_dist_remaining);        // Round-up current steps remaining
+        }
+        last_n_steps_remaining = ceil(prep.steps_remaining);                  // Round-up last steps remaining
+        prep_segment->n_step   = last_n_steps_remaining - n_steps_remaining;  // Compute number of steps to execute.
 
         // Bail if we are at the end of a feed hold and don't have a step to execute.
         if (prep_segment->n_step == 0) {
@@ -812,6 +1393,16 @@ void st_prep_buffer() {
 #endif
                 return;  // Segment not generated, but current step data still retained.
             }
+            if (is_arc) {
+                // A segment too short for a step. Its time goes to the next segment, which is longer.
+                prep.dt_remainder += dt;
+                pl_block->millimeters = mm_remaining;
+                if (mm_remaining == 0.0f) {  // Already at the end of the arc
+                    pl_block = NULL;
+                    plan_discard_current_block();
+                }
+                continue;
+            }
         }
 
         // Compute segment step rate. Since steps are integers and mm distances traveled are not,
@@ -847,18 +1438,30 @@ void st_prep_buffer() {
         prep_segment->isrPeriod = timerTicks > 0xffff ? 0xffff : timerTicks;
 
         // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
+#ifdef REALTIME_LATENCY_STATS
+        if (sys.step_control.executeHold && rt_latency_reached(RtLatencyCmd::FeedHold, RtLatencyStage::Prep)) {
+            latency_segment = segment_buffer_head;
+        }
+#endif
         segment_buffer_head = segment_next_head;
-        if (++segment_next_head == SEGMENT_BUFFER_SIZE) {
+        if (++segment_next_head == segment_buffer_size) {
             segment_next_head = 0;
         }
         // Update the appropriate planner and segment data.
         pl_block->millimeters = mm_remaining;
         prep.steps_remaining  = n_steps_remaining;
         prep.dt_remainder     = (n_steps_remaining - step_dist_remaining) * inv_rate;
+        if (is_arc && n_steps_remaining == 0.0f && prep.arc_chord + 1 < prep.arc_chords) {
+            prep.arc_chord++;
+            prep.arc_chord_loaded = false;
+            if (mm_remaining == 0.0f) {
+                continue;  // The segment went past the end of the arc, whose last chords still have to go out
+            }
+        }
         // Check for exit conditions and flag to load next planner block.
         if (mm_remaining == prep.mm_complete) {
             // End of planner block or forced-termination. No more distance to be executed.
-            if (mm_remaining > 0.0) {  // At end of forced-termination.
+            if (mm_remaining > 0.0f) {  // At end of forced-termination.
                 // Reset prep parameters for resuming and then bail. Allow the stepper ISR to complete
                 // the segment queue, where realtime protocol will set new state upon receiving the
                 // cycle stop flag from the ISR. Prep_segment is blocked until then.
@@ -911,6 +1514,9 @@ void IRAM_ATTR Stepper_Timer_WritePeriod(uint16_t timerTicks) {
     } else {
         timer_set_alarm_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, (uint64_t)timerTicks);
     }
+#ifdef STEPPER_ISR_STATS
+    isr_period_ticks = timerTicks;
+#endif
 }
 
 void IRAM_ATTR Stepper_Timer_Init() {
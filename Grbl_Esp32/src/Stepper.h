@@ -24,16 +24,31 @@
   along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+// Default depth of the step segment ring. $Stepper/SegmentBuffer changes it at run time,
+// up to SEGMENT_BUFFER_MAX, which sets the memory reserved for it.
 #ifndef SEGMENT_BUFFER_SIZE
 #    define SEGMENT_BUFFER_SIZE 6
 #endif
+#ifndef SEGMENT_BUFFER_MAX
+#    define SEGMENT_BUFFER_MAX 128
+#endif
+
+static_assert(SEGMENT_BUFFER_MAX <= 255, "Segment buffer indices are 8 bits");
+static_assert(SEGMENT_BUFFER_SIZE >= 3 && SEGMENT_BUFFER_SIZE <= SEGMENT_BUFFER_MAX, "SEGMENT_BUFFER_SIZE must be 3 to SEGMENT_BUFFER_MAX");
 
 #include "Grbl.h"
 #include "Config.h"
 
+// Precision of the intermediate ramp math in st_prep_buffer(). See STEPPER_SINGLE_PRECISION_PREP.
+#ifdef STEPPER_SINGLE_PRECISION_PREP
+typedef float prep_real_t;
+#else
+typedef double prep_real_t;
+#endif
+
 // Some useful constants.
-const double DT_SEGMENT              = (1.0 / (ACCELERATION_TICKS_PER_SECOND * 60.0));  // min/segment
-const double REQ_MM_INCREMENT_SCALAR = 1.25;
+const prep_real_t DT_SEGMENT              = (1.0 / (ACCELERATION_TICKS_PER_SECOND * 60.0));  // min/segment
+const prep_real_t REQ_MM_INCREMENT_SCALAR = 1.25;
 const int    RAMP_ACCEL              = 0;
 const int    RAMP_CRUISE             = 1;
 const int    RAMP_DECEL              = 2;
@@ -121,9 +136,32 @@ void st_prep_buffer();
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters();
 
+// Serializes segment prep against the planner. With SEGMENT_PREP_TASK, st_prep_buffer() can
+// preempt the main loop, so anything that changes the planner buffer or the prep state holds
+// this lock. It is recursive, and does nothing when segments are only prepped from the main loop.
+#ifdef SEGMENT_PREP_TASK
+void st_prep_lock();
+void st_prep_unlock();
+#else
+inline void st_prep_lock() {}
+inline void st_prep_unlock() {}
+#endif
+
+class StPrepLock {
+public:
+    StPrepLock() { st_prep_lock(); }
+    ~StPrepLock() { st_prep_unlock(); }
+};
+
 // Called by realtime status reporting if realtime rate reporting is enabled in config.h.
 float st_get_realtime_rate();
 
+// Depth of the step segment ring in use. Reloaded from $Stepper/SegmentBuffer by st_reset().
+uint8_t st_get_segment_buffer_size();
+
+// Number of times the step ISR found the segment ring empty in the middle of a motion.
+uint32_t st_get_segment_underruns();
+
 // disable (or enable) steppers via STEPPERS_DISABLE_PIN
 bool get_stepper_disable();  // returns the state of the pin
 
@@ -134,3 +172,21 @@ void Stepper_Timer_WritePeriod(uint16_t timerTicks);
 void Stepper_Timer_Init();
 void Stepper_Timer_Start();
 void Stepper_Timer_Stop();
+
+#ifdef STEPPER_ISR_STATS
+// Stepper ISR timing, in CPU cycles. Histogram bin 0 counts ISRs shorter than 1us, bin n
+// those from 2^(n-1) up to 2^n us, and the last bin everything longer.
+const int ISR_HISTOGRAM_BINS = 8;
+typedef struct {
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t missed;  // ISRs that took longer than the step period that followed them
+    uint32_t histogram[ISR_HISTOGRAM_BINS];
+    uint32_t cycles_per_us;
+} isr_stats_t;
+
+isr_stats_t st_get_isr_stats();
+void        st_reset_isr_stats();
+#endif
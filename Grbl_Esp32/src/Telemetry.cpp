@@ -0,0 +1,157 @@
+/*
+  Telemetry.cpp - binary machine state frames pushed to subscribed clients
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+#ifdef ENABLE_TELEMETRY
+
+// Offset of the fields that are compared to tell whether a frame changed, after sequence and time
+static const int TELEMETRY_STATE_OFFSET = 6;
+static const int TELEMETRY_MAX_PAYLOAD  = TELEMETRY_STATE_OFFSET + 3 + (MAX_N_AXIS + 1) * 4 + 4 + 3 + 1 + 2 + 4;
+
+struct telemetry_client_t {
+    uint32_t period_ms;  // 0 when not subscribed
+    bool     on_change;
+    uint8_t  sequence;
+    int64_t  next_us;  // When the next frame is due
+    int64_t  last_us;  // When the last frame was sent
+    uint8_t  last[TELEMETRY_MAX_PAYLOAD];
+    uint8_t  last_length;
+};
+
+static telemetry_client_t telemetry[CLIENT_COUNT];
+static uint8_t            subscribed;  // Bit per client, so polling costs nothing while there are none
+
+Error telemetry_subscribe(uint8_t client, uint32_t period_ms, bool on_change) {
+    if (client >= CLIENT_COUNT || client == CLIENT_INPUT) {
+        return Error::InvalidStatement;
+    }
+    if (period_ms != 0 && (period_ms < TELEMETRY_MIN_PERIOD_MS || period_ms > TELEMETRY_MAX_PERIOD_MS)) {
+        return Error::InvalidValue;
+    }
+    telemetry_client_t& t = telemetry[client];
+    t.period_ms           = period_ms;
+    t.on_change           = on_change;
+    t.next_us             = esp_timer_get_time();  // First frame right away
+    t.last_length         = 0;
+    if (period_ms) {
+        subscribed |= bit(client);
+    } else {
+        subscribed &= ~bit(client);
+    }
+    return Error::Ok;
+}
+
+void telemetry_report(uint8_t client) {
+    if (client >= CLIENT_COUNT) {
+        return;
+    }
+    telemetry_client_t& t = telemetry[client];
+    grbl_sendf(client, "[TM:%u%s]\r\n", t.period_ms, t.period_ms && t.on_change ? ",C" : "");
+}
+
+template <typename T>
+static inline uint8_t* put(uint8_t* p, T value) {
+    memcpy(p, &value, sizeof(value));  // Both the ESP32 and the hosts that read this are little endian
+    return p + sizeof(value);
+}
+
+// Fills in everything but sequence and time, which are only known when the frame goes out.
+static size_t telemetry_payload(uint8_t* payload, uint8_t client) {
+    int32_t current_position[MAX_N_AXIS];
+    float   mpos[MAX_N_AXIS];
+    memcpy(current_position, sys_position, sizeof(sys_position));
+    system_convert_array_steps_to_mpos(mpos, current_position);
+
+    int32_t line = 0;
+#    ifdef USE_LINE_NUMBERS
+    plan_block_t* cur_block = plan_get_current_block();
+    if (cur_block != NULL) {
+        line = cur_block->line_number;
+    }
+#    endif
+    auto n_axis = number_axis->get();
+
+    uint8_t* p = payload;
+    p          = put<uint8_t>(p, TELEMETRY_VERSION);
+    p          = put<uint8_t>(p, 0);   // sequence
+    p          = put<uint32_t>(p, 0);  // time
+    p          = put<uint8_t>(p, static_cast<uint8_t>(sys.state));
+    p          = put<uint8_t>(p, sys.suspend.value);
+    p          = put<uint8_t>(p, n_axis);
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        p = put<float>(p, mpos[idx]);
+    }
+    p = put<float>(p, st_get_realtime_rate());
+    p = put<uint32_t>(p, sys.spindle_speed);
+    p = put<uint8_t>(p, sys.f_override);
+    p = put<uint8_t>(p, sys.r_override);
+    p = put<uint8_t>(p, sys.spindle_speed_ovr);
+    p = put<uint8_t>(p, plan_get_block_buffer_available());
+    p = put<uint16_t>(p, serial_get_rx_buffer_available(client));
+    p = put<int32_t>(p, line);
+    return p - payload;
+}
+
+void telemetry_poll() {
+    if (!subscribed) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        telemetry_client_t& t = telemetry[client];
+        if (!bit_istrue(subscribed, bit(client)) || now < t.next_us) {
+            continue;
+        }
+        t.next_us = now + t.period_ms * 1000;
+
+        uint8_t  frame[TELEMETRY_MAX_PAYLOAD + 3];
+        uint8_t* payload = frame + 2;
+        size_t   length  = telemetry_payload(payload, client);
+        if (t.on_change && length == t.last_length && now - t.last_us < TELEMETRY_KEEPALIVE_MS * 1000 &&
+            memcmp(payload + TELEMETRY_STATE_OFFSET, t.last + TELEMETRY_STATE_OFFSET, length - TELEMETRY_STATE_OFFSET) == 0) {
+            continue;
+        }
+        memcpy(t.last, payload, length);
+        t.last_length = length;
+        t.last_us     = now;
+
+        payload[1] = t.sequence++;
+        put<uint32_t>(payload + 2, uint32_t(now / 1000));
+        uint8_t check = 0;
+        for (size_t i = 0; i < length; i++) {
+            check ^= payload[i];
+        }
+        frame[0]          = TELEMETRY_FRAME_START;
+        frame[1]          = length;
+        frame[2 + length] = check;
+        serial_send_frame(client, frame, length + 3);
+    }
+}
+
+#else
+
+Error telemetry_subscribe(uint8_t client, uint32_t period_ms, bool on_change) {
+    return Error::InvalidStatement;
+}
+
+void telemetry_report(uint8_t client) {}
+
+void telemetry_poll() {}
+
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+  Telemetry.h - binary machine state frames pushed to subscribed clients
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// A frame is sent between text messages on the client's connection:
+//
+//   0xC0  length  payload[length]  check
+//
+// 0xC0 is not valid anywhere in UTF-8, so it never starts a line of Grbl's text output, and check
+// is the XOR of the payload bytes. The payload is little endian:
+//
+//   uint8   version        TELEMETRY_VERSION
+//   uint8   sequence       counts frames sent to this client, wrapping at 256
+//   uint32  time           milliseconds since startup
+//   uint8   state          State, Idle = 0 to Sleep = 8
+//   uint8   suspend        Suspend bits
+//   uint8   n_axis
+//   float   mpos[n_axis]   machine position in mm
+//   float   feed           realtime feed rate in mm/min
+//   uint32  spindle_speed  in RPM
+//   uint8   overrides[3]   feed, rapid and spindle percent
+//   uint8   planner        free planner blocks
+//   uint16  rx             RX credits of this client, as in |Bf:
+//   int32   line           line number of the running block, or 0
+//
+// Fields are only ever added at the end, and the version changes when existing ones do.
+//
+// Frames can go to the UART, Bluetooth, telnet and WebUI clients, but not to CLIENT_INPUT, which
+// has no connection to send them on. A 3 axis frame is 42 bytes, so at 115200 baud 100Hz takes over a third of the UART; use
+// 20ms or more there if the client also streams g-code. The WebUI gets each frame as one websocket
+// message as soon as it is sent, which WiFi keeps up with at 100Hz, but like its other output the
+// frames are dropped rather than waited for when its TX ring is full.
+const uint8_t  TELEMETRY_FRAME_START   = 0xC0;
+const uint8_t  TELEMETRY_VERSION       = 1;
+const uint32_t TELEMETRY_MIN_PERIOD_MS = 10;     // 100Hz
+const uint32_t TELEMETRY_MAX_PERIOD_MS = 60000;
+const uint32_t TELEMETRY_KEEPALIVE_MS  = 1000;   // $TM=ms,C sends a frame at least this often
+
+// Starts frames every period_ms for client, or only when their contents changed if on_change is set.
+// A period of 0 stops them.
+Error telemetry_subscribe(uint8_t client, uint32_t period_ms, bool on_change);
+
+// Sends [TM:period] or [TM:period,C] for client, as set by telemetry_subscribe().
+void telemetry_report(uint8_t client);
+
+// Sends the frames that are due. Called from the protocol loop.
+void telemetry_poll();
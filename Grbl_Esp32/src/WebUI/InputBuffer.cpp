@@ -110,6 +110,21 @@ namespace WebUI {
         }
     }
 
+    size_t InputBuffer::read(uint8_t* buffer, size_t length) {
+        if (length > _RXbufferSize) {
+            length = _RXbufferSize;
+        }
+        for (size_t i = 0; i < length; i++) {
+            buffer[i] = _RXbuffer[_RXbufferpos];
+            _RXbufferpos++;
+            if (_RXbufferpos > (RXBUFFERSIZE - 1)) {
+                _RXbufferpos = 0;
+            }
+        }
+        _RXbufferSize -= length;
+        return length;
+    }
+
     void InputBuffer::flush(void) {
         //No need currently
         //keep for compatibility
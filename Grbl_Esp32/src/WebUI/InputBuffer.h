@@ -41,6 +41,7 @@ namespace WebUI {
         int           availableforwrite();
         int           peek(void);
         int           read(void);
+        size_t        read(uint8_t* buffer, size_t length);
         bool          push(const char* data);
         void          flush(void);
 
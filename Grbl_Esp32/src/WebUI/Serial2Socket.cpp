@@ -31,20 +31,29 @@ namespace WebUI {
     Serial_2_Socket Serial2Socket;
 
     Serial_2_Socket::Serial_2_Socket() {
-        _web_socket   = NULL;
+        _web_socket  = NULL;
+        _holding     = false;
+        _bytes_sent  = 0;
+        _frames_sent = 0;
+#    ifndef SERIAL_TX_TASK
         _TXbufferSize = 0;
+#    endif
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
     }
 
     void Serial_2_Socket::begin(long speed) {
+#    ifndef SERIAL_TX_TASK
         _TXbufferSize = 0;
+#    endif
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
     }
 
     void Serial_2_Socket::end() {
+#    ifndef SERIAL_TX_TASK
         _TXbufferSize = 0;
+#    endif
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
     }
@@ -53,8 +62,10 @@ namespace WebUI {
 
     bool Serial_2_Socket::attachWS(WebSocketsServer* web_socket) {
         if (web_socket) {
-            _web_socket   = web_socket;
+            _web_socket = web_socket;
+#    ifndef SERIAL_TX_TASK
             _TXbufferSize = 0;
+#    endif
             return true;
         }
         return false;
@@ -89,6 +100,10 @@ namespace WebUI {
         }
 
 #    if defined(ENABLE_SERIAL2SOCKET_OUT)
+#        ifdef SERIAL_TX_TASK
+        // Output from Grbl comes through sendFrom(), which holds it back in the TX ring instead
+        sendFrame(const_cast<uint8_t*>(buffer), size);
+#        else
         if (_TXbufferSize == 0) {
             _lastflush = millis();
         }
@@ -98,17 +113,46 @@ namespace WebUI {
             flush();
         }
 
-        //need periodic check to force to flush in case of no end
         for (int i = 0; i < size; i++) {
             _TXbuffer[_TXbufferSize] = buffer[i];
             _TXbufferSize++;
         }
         log_i("[SOCKET]buffer size %d", _TXbufferSize);
-        handle_flush();
+        if (_TXbufferSize > 0 &&
+            flushDue(_TXbufferSize,
+                     _TXbuffer[_TXbufferSize - 1],
+                     _TXbufferSize >= 3 ? _TXbuffer[_TXbufferSize - 3] : 0,
+                     millis() - _lastflush)) {
+            flush();
+        }
+#        endif
 #    endif
         return size;
     }
 
+    bool Serial_2_Socket::flushDue(size_t pending, uint8_t last, uint8_t before_eol, uint32_t waited_ms) {
+        if (pending >= SERIAL2SOCKET_FLUSH_BYTES || waited_ms >= SERIAL2SOCKET_FLUSH_MS) {
+            return true;
+        }
+        if (last != '\n') {
+            return false;
+        }
+        switch (SERIAL2SOCKET_FLUSH_POLICY) {
+            case SocketFlush::Newline:
+                return true;
+            case SocketFlush::Status:
+                return before_eol == '>';  // Status reports end with >\r\n
+            default:
+                return false;
+        }
+    }
+
+    void Serial_2_Socket::sendFrame(uint8_t* data, size_t length) {
+        _web_socket->broadcastBIN(data, length);
+        _bytes_sent += length;
+        _frames_sent++;
+    }
+
     int Serial_2_Socket::peek(void) {
         if (_RXbufferSize > 0) {
             return _RXbuffer[_RXbufferpos];
@@ -135,6 +179,7 @@ namespace WebUI {
             }
 
             _RXbufferSize += strlen(data);
+            serial_notify();
             return true;
         }
         return false;
@@ -158,16 +203,34 @@ namespace WebUI {
         }
     }
 
+    size_t Serial_2_Socket::read(uint8_t* buffer, size_t length) {
+        if (length > _RXbufferSize) {
+            length = _RXbufferSize;
+        }
+        for (size_t i = 0; i < length; i++) {
+            buffer[i] = _RXbuffer[_RXbufferpos];
+            _RXbufferpos++;
+            if (_RXbufferpos > (RXBUFFERSIZE - 1)) {
+                _RXbufferpos = 0;
+            }
+        }
+        _RXbufferSize -= length;
+        return length;
+    }
+
     void Serial_2_Socket::handle_flush() {
-        if (_TXbufferSize > 0 && ((_TXbufferSize >= TXBUFFERSIZE) || ((millis() - _lastflush) > FLUSHTIMEOUT))) {
+#    ifndef SERIAL_TX_TASK
+        if (_TXbufferSize > 0 && ((_TXbufferSize >= TXBUFFERSIZE) || ((millis() - _lastflush) >= SERIAL2SOCKET_FLUSH_MS))) {
             log_i("[SOCKET]need flush, buffer size %d", _TXbufferSize);
             flush();
         }
+#    endif
     }
     void Serial_2_Socket::flush(void) {
-        if (_TXbufferSize > 0) {
+#    ifndef SERIAL_TX_TASK
+        if (_TXbufferSize > 0 && _web_socket) {
             log_i("[SOCKET]flush data, buffer size %d", _TXbufferSize);
-            _web_socket->broadcastBIN(_TXbuffer, _TXbufferSize);
+            sendFrame(_TXbuffer, _TXbufferSize);
 
             //refresh timout
             _lastflush = millis();
@@ -175,13 +238,16 @@ namespace WebUI {
             //reset buffer
             _TXbufferSize = 0;
         }
+#    endif
     }
 
     Serial_2_Socket::~Serial_2_Socket() {
         if (_web_socket) {
             detachWS();
         }
+#    ifndef SERIAL_TX_TASK
         _TXbufferSize = 0;
+#    endif
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
     }
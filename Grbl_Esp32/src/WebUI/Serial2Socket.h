@@ -20,16 +20,35 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include "../SpscRing.h"
 #include <Print.h>
 #include <cstring>
 
 class WebSocketsServer;
 
+namespace WebUI {
+    // When output to the websocket goes out as a frame, besides the byte and time targets below
+    enum class SocketFlush : uint8_t {
+        Newline,  // At the end of each line, for the lowest latency
+        Status,   // At the end of a status report, which other output waits for
+        Size,     // Only on the byte and time targets, for the fewest frames
+    };
+}
+
+#ifndef SERIAL2SOCKET_FLUSH_POLICY
+#    define SERIAL2SOCKET_FLUSH_POLICY WebUI::SocketFlush::Newline
+#endif
+#ifndef SERIAL2SOCKET_FLUSH_MS
+#    define SERIAL2SOCKET_FLUSH_MS 50  // Longest time output waits for a frame
+#endif
+#ifndef SERIAL2SOCKET_FLUSH_BYTES
+#    define SERIAL2SOCKET_FLUSH_BYTES 512  // Output that goes out as a frame whatever the policy
+#endif
+
 namespace WebUI {
     class Serial_2_Socket : public Print {
         static const int TXBUFFERSIZE = 1200;
         static const int RXBUFFERSIZE = 256;
-        static const int FLUSHTIMEOUT = 500;
 
     public:
         Serial_2_Socket();
@@ -43,28 +62,87 @@ namespace WebUI {
         inline size_t write(unsigned int n) { return write((uint8_t)n); }
         inline size_t write(int n) { return write((uint8_t)n); }
 
-        long baudRate();
-        void begin(long speed);
-        void end();
-        int  available();
-        int  peek(void);
-        int  read(void);
-        bool push(const char* data);
-        void flush(void);
-        void handle_flush();
-        bool attachWS(WebSocketsServer* web_socket);
-        bool detachWS();
+        long   baudRate();
+        void   begin(long speed);
+        void   end();
+        int    available();
+        int    peek(void);
+        int    read(void);
+        size_t read(uint8_t* buffer, size_t length);
+        bool   push(const char* data);
+        void   flush(void);
+        void   handle_flush();
+        bool   attachWS(WebSocketsServer* web_socket);
+        bool   detachWS();
+
+        // Sends the output waiting in ring in one frame, once the flush policy says so or at once
+        // if urgent. It goes straight from the ring, unless it wraps around the end. Returns how many
+        // ms the output left in the ring may still wait, or 0 if none was left.
+        template <size_t Size>
+        uint32_t sendFrom(SpscRing<Size>& ring, bool urgent) {
+            size_t pending = ring.available();
+            if (pending == 0) {
+                _holding = false;
+                return 0;
+            }
+            uint32_t now = millis();
+            if (!_holding) {
+                _holding    = true;
+                _held_since = now;
+            }
+            uint32_t waited = now - _held_since;
+            if (_web_socket && !urgent && !flushDue(pending, ring.at(pending - 1), pending >= 3 ? ring.at(pending - 3) : 0, waited)) {
+                return SERIAL2SOCKET_FLUSH_MS - waited;
+            }
+            uint8_t* data;
+            size_t   length = ring.peek(&data);
+            if (length < pending) {
+                // Joined into one frame, so that no message, such as a telemetry frame, reaches
+                // the client split in two.
+                static uint8_t joined[Size];
+                memcpy(joined, data, length);
+                ring.skip(length);
+                ring.peek(&data);
+                memcpy(joined + length, data, pending - length);
+                ring.skip(pending - length);
+                data = joined;
+            } else {
+                ring.skip(pending);
+            }
+            if (_web_socket) {
+                sendFrame(data, pending);
+            }
+            ring.release();
+            _holding = false;
+            return 0;
+        }
+
+        // Output sent since startup
+        uint32_t bytesSent() const { return _bytes_sent; }
+        uint32_t framesSent() const { return _frames_sent; }
 
         operator bool() const;
 
         ~Serial_2_Socket();
 
     private:
+        // Whether pending bytes of output, ending in last and with before_eol two bytes before
+        // that, should go out now, after the first of them has waited waited_ms.
+        bool flushDue(size_t pending, uint8_t last, uint8_t before_eol, uint32_t waited_ms);
+        void sendFrame(uint8_t* data, size_t length);
+
         uint32_t          _lastflush;
         WebSocketsServer* _web_socket;
 
+        bool     _holding;  // Output is waiting in the ring given to sendFrom()
+        uint32_t _held_since;
+        uint32_t _bytes_sent;
+        uint32_t _frames_sent;
+
+#ifndef SERIAL_TX_TASK
         uint8_t  _TXbuffer[TXBUFFERSIZE];
         uint16_t _TXbufferSize;
+#endif
 
         uint8_t  _RXbuffer[RXBUFFERSIZE];
         uint16_t _RXbufferSize;
@@ -177,8 +177,6 @@ namespace WebUI {
 
     int Telnet_Server::available() { return _RXbufferSize; }
 
-    int Telnet_Server::get_rx_buffer_available() { return TELNETRXBUFFERSIZE - _RXbufferSize; }
-
     bool Telnet_Server::push(uint8_t data) {
         log_i("[TELNET]push %c", data);
         if ((1 + _RXbufferSize) <= TELNETRXBUFFERSIZE) {
@@ -192,6 +190,7 @@ namespace WebUI {
             _RXbuffer[current] = data;
             _RXbufferSize++;
             log_i("[TELNET]buffer size %d", _RXbufferSize);
+            serial_notify();
             return true;
         }
         return false;
@@ -217,6 +216,7 @@ namespace WebUI {
                 //vTaskDelay(1 / portTICK_RATE_MS);  // Yield to other tasks
             }
             _RXbufferSize += data_processed;
+            serial_notify();
             return true;
         }
         return false;
@@ -237,6 +237,21 @@ namespace WebUI {
         }
     }
 
+    size_t Telnet_Server::read(uint8_t* buffer, size_t length) {
+        if (length > _RXbufferSize) {
+            length = _RXbufferSize;
+        }
+        for (size_t i = 0; i < length; i++) {
+            buffer[i] = _RXbuffer[_RXbufferpos];
+            _RXbufferpos++;
+            if (_RXbufferpos > (TELNETRXBUFFERSIZE - 1)) {
+                _RXbufferpos = 0;
+            }
+        }
+        _RXbufferSize -= length;
+        return length;
+    }
+
     Telnet_Server::~Telnet_Server() { end(); }
 }
 #endif  // Enable TELNET && ENABLE_WIFI
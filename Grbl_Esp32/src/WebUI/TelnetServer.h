@@ -41,9 +41,9 @@ namespace WebUI {
         void   handle();
         size_t write(const uint8_t* buffer, size_t size);
         int    read(void);
+        size_t read(uint8_t* buffer, size_t length);
         int    peek(void);
         int    available();
-        int    get_rx_buffer_available();
         bool   push(uint8_t data);
         bool   push(const uint8_t* data, int datasize);
 
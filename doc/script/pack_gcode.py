@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""\
+Converts g-code files to Grbl_ESP32 packed lines
+
+A packed line starts with '@' and holds the words of a g-code line already
+split, so the controller skips comment stripping, case conversion and
+decimal digit parsing. Each word is:
+
+  an upper case letter
+  '-' if the value is negative
+  the decimal places: w, x, y, z for 1 to 4 places each, adding up
+  the value without its decimal point, in base 32 digits (0-9 a-v)
+
+"G1 X10.5 F800" packs to "@G1Xw39Fp0". See GC_PACKED_LINE in
+Grbl_Esp32/src/GCode.h.
+
+Numbers keep the digits Grbl's read_float() keeps, and the controller scales
+them the same way, so a packed line executes exactly like the original.
+Trailing zeros after the point are dropped where the value stays the same.
+Comments are dropped. '$' and '[' lines, blank lines, lines Grbl would reject
+and lines with numbers of more than 8 digits before the point are copied
+unchanged.
+
+Usage: pack_gcode.py [-o out.nc] [file.nc]    (stdin/stdout by default)
+"""
+
+import argparse
+import math
+import struct
+import sys
+
+DIGITS = "0123456789abcdefghijklmnopqrstuv"
+PLACES = "wxyz"
+MAX_INT_DIGITS = 8     # NutsBolts.h
+LINE_BUFFER_SIZE = 256  # Protocol.h
+MAX_WORDS = 40         # GC_MAX_WORDS in GCode.h
+
+
+def to_float32(value):
+    try:
+        return struct.unpack("<f", struct.pack("<f", value))[0]
+    except OverflowError:
+        return math.copysign(math.inf, value)
+
+
+def collapse(line):
+    """Mirrors collapseGCode(): drops whitespace and comments, upper cases."""
+    out = []
+    in_comment = False
+    for c in line:
+        if c.isspace():
+            continue
+        if c == ")":
+            in_comment = False
+        elif c == "(":
+            in_comment = True
+        elif c == ";":
+            break
+        elif c in "%\r":
+            continue
+        elif not in_comment:
+            out.append(c.upper())
+    return "".join(out)
+
+
+def decimal_to_float(intval, exp):
+    """Mirrors decimal_to_float(): float times double constant, rounded back to float, as in C."""
+    fval = to_float32(intval)
+    if fval != 0:
+        while exp <= -2:
+            fval = to_float32(fval * 0.01)
+            exp += 2
+        if exp < 0:
+            fval = to_float32(fval * 0.1)
+        while exp > 0:
+            fval = to_float32(fval * 10.0)
+            exp -= 1
+    return fval
+
+
+def read_float(line, pos):
+    """Mirrors read_float(). Returns (negative, digits, exponent, next position) or None."""
+    negative = False
+    if pos < len(line) and line[pos] in "+-":
+        negative = line[pos] == "-"
+        pos += 1
+    intval = 0
+    exp = 0
+    ndigit = 0
+    decimal = False
+    while pos < len(line):
+        c = line[pos]
+        if c.isdigit():
+            ndigit += 1
+            if ndigit <= MAX_INT_DIGITS:
+                if decimal:
+                    exp -= 1
+                intval = intval * 10 + int(c)
+            elif not decimal:
+                exp += 1
+        elif c == "." and not decimal:
+            decimal = True
+        else:
+            break
+        pos += 1
+    if not ndigit:
+        return None
+    return negative, intval, exp, pos
+
+
+def pack_word(letter, negative, intval, exp):
+    """Returns the packed word, or None for values that need a positive exponent."""
+    if exp > 0 or not math.isfinite(decimal_to_float(intval, exp)):
+        return None
+    # Drop trailing zeros after the point where that leaves the value unchanged.
+    value = decimal_to_float(intval, exp)
+    while exp < 0 and intval % 10 == 0 and decimal_to_float(intval // 10, exp + 1) == value:
+        intval //= 10
+        exp += 1
+    word = letter + ("-" if negative else "")
+    places = -exp
+    while places > 0:
+        word += PLACES[min(places, 4) - 1]
+        places -= min(places, 4)
+    digits = ""
+    while True:
+        digits = DIGITS[intval & 31] + digits
+        intval >>= 5
+        if not intval:
+            break
+    return word + digits
+
+
+def pack_line(line):
+    """Returns the packed form of a g-code line, or None to send it as is."""
+    text = collapse(line)
+    if not text or text[0] in "$[":
+        return None
+    words = []
+    pos = 0
+    while pos < len(text):
+        letter = text[pos]
+        if not "A" <= letter <= "Z":
+            return None
+        number = read_float(text, pos + 1)
+        if number is None:
+            return None
+        negative, intval, exp, pos = number
+        word = pack_word(letter, negative, intval, exp)
+        if word is None:
+            return None
+        words.append(word)
+    if len(words) > MAX_WORDS:
+        return None
+    packed = "@" + "".join(words)
+    if len(packed) >= LINE_BUFFER_SIZE:
+        return None
+    return packed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert g-code to Grbl_ESP32 packed lines.")
+    parser.add_argument("input", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+    parser.add_argument("-o", "--output", type=argparse.FileType("w"), default=sys.stdout)
+    args = parser.parse_args()
+
+    for line in args.input:
+        line = line.rstrip("\r\n")
+        packed = pack_line(line)
+        args.output.write((packed if packed is not None else line) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -10,7 +10,13 @@ from the serial buffer and does not have to wait for a
 response from the computer. This effectively adds another
 buffer layer to prevent buffer starvation.
 
+With -r, the number of characters in flight is taken from Grbl_ESP32's
+RX credits instead: the buffer size comes from $RX, and after $RX=ON
+every 'ok' carries the count of input bytes Grbl has freed, so nothing
+is guessed. --compare streams the file both ways and prints both times.
+
 CHANGELOG:
+- 20201201: RX credit streaming (-r) and --compare for Grbl_ESP32.
 - 20170531: Status report feedback at 1.0 second intervals.
     Configurable baudrate and report intervals. Bug fixes.
 - 20161212: Added push message feedback for simple streaming
@@ -71,6 +77,10 @@ parser.add_argument('-s','--settings',action='store_true', default=False,
         help='settings write mode')        
 parser.add_argument('-c','--check',action='store_true', default=False,
         help='stream in check mode')
+parser.add_argument('-r','--credits',action='store_true', default=False,
+        help='stream with the RX credits reported by Grbl_ESP32')
+parser.add_argument('--compare',action='store_true', default=False,
+        help='stream with character counting, then with RX credits, and compare times')
 args = parser.parse_args()
 
 # Periodic timer to query for status reports
@@ -102,6 +112,90 @@ s.write("\r\n\r\n")
 time.sleep(2)
 s.flushInput()
 
+# Reads one response. Returns the freed byte count of an 'ok:<freed>', True for any other
+# 'ok' or 'error', and None for anything else.
+def read_response(count):
+    global error_count
+    out_temp = s.readline().strip() # Wait for grbl response
+    if out_temp.find('ok') < 0 and out_temp.find('error') < 0 :
+        print "    MSG: \""+out_temp+"\"" # Debug response
+        return None
+    if out_temp.find('error') >= 0 : error_count += 1
+    if verbose: print "  REC<"+str(count)+": \""+out_temp+"\""
+    if out_temp.startswith('ok:') : return int(out_temp[3:])
+    return True
+
+# Send g-code program via a more agressive streaming protocol that forces characters into
+# Grbl's serial read buffer to ensure Grbl has immediate access to the next g-code command
+# rather than wait for the call-response serial protocol to finish. This is done by careful
+# counting of the number of characters sent by the streamer to Grbl and tracking Grbl's 
+# responses, such that we never overflow Grbl's serial read buffer. 
+def stream_counting():
+    start = time.time()
+    l_count = 0
+    g_count = 0
+    c_line = []
+    for line in f:
+        l_count += 1 # Iterate line counter
+        l_block = re.sub('\s|\(.*?\)','',line).upper() # Strip comments/spaces/new line and capitalize
+        # l_block = line.strip()
+        c_line.append(len(l_block)+1) # Track number of characters in grbl serial read buffer
+        while sum(c_line) >= RX_BUFFER_SIZE-1 | s.inWaiting() :
+            if read_response(g_count + 1) is not None :
+                g_count += 1 # Iterate g-code counter
+                del c_line[0] # Delete the block character count corresponding to the last 'ok'
+        s.write(l_block + '\n') # Send g-code block to grbl
+        if verbose: print "SND>"+str(l_count)+": \"" + l_block + "\""
+    # Wait until all responses have been received.
+    while l_count > g_count :
+        if read_response(g_count + 1) is not None :
+            g_count += 1 # Iterate g-code counter
+            del c_line[0] # Delete the block character count corresponding to the last 'ok'
+    return time.time() - start
+
+# Same, but with Grbl_ESP32's RX credits. $RX reports the buffer size and how many input bytes
+# Grbl has freed so far, and after $RX=ON every 'ok' reports the latter again, including the
+# line it answers. Lines are sent while the bytes sent and not yet freed fit the buffer, so the
+# sender never has to guess. A line too long for the buffer is only sent once all are answered.
+def stream_credits():
+    start = time.time()
+    s.write("$RX\n")
+    rx = None
+    while rx is None :
+        out_temp = s.readline().strip()
+        if out_temp.startswith('[RX:') :
+            rx = [int(v) for v in out_temp[4:-1].split(',')]
+        elif out_temp.find('error') >= 0 :
+            print "  Grbl does not report RX credits:",out_temp
+            quit()
+    while read_response(0) is None : pass # The 'ok' for $RX
+    size = rx[0]
+    freed = rx[2]
+    sent = freed + len("$RX\n") # $RX was still in the buffer when it reported
+    s.write("$RX=ON\n")
+    sent += len("$RX=ON\n")
+    if verbose: print "RX credits: buffer",size,"bytes"
+    l_count = 0
+    g_count = 0
+    for line in f:
+        l_count += 1 # Iterate line counter
+        l_block = re.sub('\s|\(.*?\)','',line).upper() # Strip comments/spaces/new line and capitalize
+        while l_count > g_count and ((sent + len(l_block) + 1 - freed) % 2**32 > size or s.inWaiting()) :
+            response = read_response(g_count)
+            if response is not None :
+                g_count += 1
+                if response is not True : freed = response
+        s.write(l_block + '\n') # Send g-code block to grbl
+        sent += len(l_block) + 1
+        if verbose: print "SND>"+str(l_count)+": \"" + l_block + "\""
+    # Wait until all responses have been received, including the one for $RX=ON.
+    while l_count + 1 > g_count :
+        if read_response(g_count) is not None :
+            g_count += 1
+    s.write("$RX=OFF\n")
+    while read_response(g_count) is None : pass
+    return time.time() - start
+
 if check_mode :
     print "Enabling Grbl Check-Mode: SND: [$C]",
     s.write("$C\n")
@@ -147,41 +241,17 @@ if settings_mode:
                 break
             else:
                 print "    MSG: \""+grbl_out+"\""
-else:    
-    # Send g-code program via a more agressive streaming protocol that forces characters into
-    # Grbl's serial read buffer to ensure Grbl has immediate access to the next g-code command
-    # rather than wait for the call-response serial protocol to finish. This is done by careful
-    # counting of the number of characters sent by the streamer to Grbl and tracking Grbl's 
-    # responses, such that we never overflow Grbl's serial read buffer. 
-    g_count = 0
-    c_line = []
-    for line in f:
-        l_count += 1 # Iterate line counter
-        l_block = re.sub('\s|\(.*?\)','',line).upper() # Strip comments/spaces/new line and capitalize
-        # l_block = line.strip()
-        c_line.append(len(l_block)+1) # Track number of characters in grbl serial read buffer
-        grbl_out = '' 
-        while sum(c_line) >= RX_BUFFER_SIZE-1 | s.inWaiting() :
-            out_temp = s.readline().strip() # Wait for grbl response
-            if out_temp.find('ok') < 0 and out_temp.find('error') < 0 :
-                print "    MSG: \""+out_temp+"\"" # Debug response
-            else :
-                if out_temp.find('error') >= 0 : error_count += 1
-                g_count += 1 # Iterate g-code counter
-                if verbose: print "  REC<"+str(g_count)+": \""+out_temp+"\""
-                del c_line[0] # Delete the block character count corresponding to the last 'ok'
-        s.write(l_block + '\n') # Send g-code block to grbl
-        if verbose: print "SND>"+str(l_count)+": \"" + l_block + "\""
-    # Wait until all responses have been received.
-    while l_count > g_count :
-        out_temp = s.readline().strip() # Wait for grbl response
-        if out_temp.find('ok') < 0 and out_temp.find('error') < 0 :
-            print "    MSG: \""+out_temp+"\"" # Debug response
-        else :
-            if out_temp.find('error') >= 0 : error_count += 1
-            g_count += 1 # Iterate g-code counter
-            del c_line[0] # Delete the block character count corresponding to the last 'ok'
-            if verbose: print "  REC<"+str(g_count)+": \""+out_temp + "\""
+else:
+    if args.compare :
+        counting_time = stream_counting()
+        f.seek(0)
+        credits_time = stream_credits()
+        print "\nCharacter counting:",counting_time,"s, RX credits:",credits_time,"s"
+        print " RX credits took", "%.1f%%" % (100.0 * credits_time / counting_time), "of the time"
+    elif args.credits :
+        stream_credits()
+    else :
+        stream_counting()
 
 # Wait for user input after streaming is completed
 print "\nG-code streaming finished!"
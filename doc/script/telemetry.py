@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""\
+Reads Grbl_ESP32 telemetry frames
+
+After $TM=ms, Grbl_ESP32 pushes a binary frame with the machine position,
+state, feed rate, overrides and buffer fill every ms milliseconds, between
+the text lines it sends. $TM=ms,C sends one only when something changed.
+Each frame is
+
+  0xC0  length  payload[length]  check
+
+where check is the XOR of the payload bytes. See Grbl_Esp32/src/Telemetry.h
+for the payload. This script subscribes, prints every frame as it arrives,
+and passes the text lines through. Ctrl-C stops the frames again.
+
+Usage: telemetry.py [-p ms] [-c] [-b baud] port
+       telemetry.py -          (decode a captured stream from stdin)
+"""
+
+import argparse
+import struct
+import sys
+
+FRAME_START = 0xC0
+VERSION = 1
+STATES = ["Idle", "Alarm", "Check", "Home", "Run", "Hold", "Jog", "Door", "Sleep"]
+
+
+def decode(payload):
+    """Returns the fields of a payload as a dict, or None if it is not one this script knows."""
+    if len(payload) < 9 or payload[0] != VERSION:
+        return None
+    version, sequence, time, state, suspend, n_axis = struct.unpack_from("<BBIBBB", payload)
+    pos = 9
+    if len(payload) < pos + 4 * n_axis + 18:
+        return None
+    mpos = struct.unpack_from("<%df" % n_axis, payload, pos)
+    pos += 4 * n_axis
+    feed, spindle, f_ovr, r_ovr, s_ovr, planner, rx, line = struct.unpack_from("<fIBBBBHi", payload, pos)
+    return {
+        "sequence": sequence,
+        "time": time,
+        "state": STATES[state] if state < len(STATES) else str(state),
+        "suspend": suspend,
+        "mpos": mpos,
+        "feed": feed,
+        "spindle": spindle,
+        "overrides": (f_ovr, r_ovr, s_ovr),
+        "planner": planner,
+        "rx": rx,
+        "line": line,
+    }
+
+
+def frames(read):
+    """Splits a stream into text lines and frames. read(n) returns up to n bytes, or b"" at the end.
+    Yields ("text", str) and ("frame", dict) items, and ("bad", bytes) for frames that fail the check."""
+    text = bytearray()
+    while True:
+        c = read(1)
+        if not c:
+            return
+        if c[0] == FRAME_START and not text:
+            header = read(1)
+            if not header:
+                return
+            length = header[0]
+            body = bytearray()
+            while len(body) < length + 1:
+                chunk = read(length + 1 - len(body))
+                if not chunk:
+                    return
+                body += chunk
+            payload, check = bytes(body[:length]), body[length]
+            x = 0
+            for b in payload:
+                x ^= b
+            fields = decode(payload) if x == check else None
+            yield ("frame", fields) if fields else ("bad", payload)
+        elif c == b"\n":
+            yield "text", text.decode("utf-8", "replace").rstrip("\r")
+            text = bytearray()
+        else:
+            text += c
+
+
+def show(frame, last):
+    axes = " ".join("%.3f" % v for v in frame["mpos"])
+    lost = (frame["sequence"] - last - 1) & 0xFF if last is not None else 0
+    print("%10.3f %-5s %s F%.0f S%d Ov:%d,%d,%d Bf:%d,%d Ln:%d%s" % (
+        frame["time"] / 1000.0, frame["state"], axes, frame["feed"], frame["spindle"],
+        frame["overrides"][0], frame["overrides"][1], frame["overrides"][2],
+        frame["planner"], frame["rx"], frame["line"], " (%d lost)" % lost if lost else ""))
+
+
+def run(read):
+    last = None
+    for kind, item in frames(read):
+        if kind == "frame":
+            show(item, last)
+            last = item["sequence"]
+        elif kind == "bad":
+            print("bad frame: %s" % item.hex())
+        elif item:
+            print(item)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Show Grbl_ESP32 telemetry frames.")
+    parser.add_argument("port", help="serial port, or - to decode stdin")
+    parser.add_argument("-p", "--period", type=int, default=100, help="milliseconds between frames (10-60000)")
+    parser.add_argument("-c", "--changes", action="store_true", help="only send frames when something changed")
+    parser.add_argument("-b", "--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    if args.port == "-":
+        run(sys.stdin.buffer.read)
+        return
+
+    import serial
+    s = serial.Serial(args.port, args.baud, timeout=None)
+    s.write(("$TM=%d%s\n" % (args.period, ",C" if args.changes else "")).encode())
+    try:
+        run(s.read)
+    except KeyboardInterrupt:
+        s.write(b"$TM=0\n")
+    finally:
+        s.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,224 @@
+/*
+  BenchReport.cpp - host benchmark of the realtime status report builder
+
+  Builds typical '<...>' status reports, with a changing position and the
+  WCO and Ov fields every tenth report, and prints reports per second for:
+
+    printf  the previous builder, strcat() of snprintf() output for every
+            field into a stack buffer
+    writer  ReportWriter, with format_float() for the axis values and the
+            WCO and Ov fields kept formatted while they do not change
+
+  Both must produce the same text. Before that, format_float() is checked
+  against printf("%.Nf") on random values with every number of decimals.
+  The host has a double FPU and a fast printf, so the difference on the
+  ESP32 is larger than measured here.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/ReportWriter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unistd.h>
+
+static const char* usage =
+    "Usage: bench_report [-n reports] [-a axes]\n"
+    "  -n N   reports to build (default 1000000)\n"
+    "  -a N   axes in each position (default 3)\n";
+
+static const int MAX_AXES = 6;
+
+static long n_reports = 1000000;
+static int  n_axes    = 3;
+
+struct Snapshot {
+    float    mpos[MAX_AXES];
+    float    wco[MAX_AXES];
+    int      planner;
+    int      rx;
+    float    rate;
+    uint32_t spindle_speed;
+    bool     slow_fields;  // WCO and Ov are due
+};
+
+static void check_format_float() {
+    std::mt19937 rng(1);
+    char         expected[64];
+    char         actual[FLOAT_TEXT_SIZE + 1];
+    for (long i = 0; i < 2000000; i++) {
+        float value;
+        if (i & 1) {
+            uint32_t bits = rng();
+            memcpy(&value, &bits, sizeof(value));
+        } else {
+            value = float(int32_t(rng()) % 2000000) / 1024;  // Exact ties at every decimal count
+        }
+        for (int decimals = 0; decimals <= 6; decimals++) {
+            int length = snprintf(expected, sizeof(expected), "%.*f", decimals, value);
+            if (length > FLOAT_TEXT_SIZE) {
+                continue;
+            }
+            format_float(actual, value, decimals);
+            if (strcmp(expected, actual) != 0) {
+                fprintf(stderr, "[bench] format_float(%a, %d) gave %s, printf gave %s\n", value, decimals, actual, expected);
+                exit(1);
+            }
+        }
+    }
+    printf("[bench] format_float matches printf\n");
+}
+
+static void axes_printf(char* status, const float* values) {
+    char text[20];
+    for (int idx = 0; idx < n_axes; idx++) {
+        snprintf(text, sizeof(text) - 1, "%4.3f", values[idx]);
+        strcat(status, text);
+        if (idx < n_axes - 1) {
+            strcat(status, ",");
+        }
+    }
+}
+
+static void report_printf(char* status, const Snapshot& s) {
+    char temp[MAX_AXES * 20];
+    strcpy(status, "<");
+    strcat(status, "Run");
+    strcat(status, "|MPos:");
+    axes_printf(status, s.mpos);
+    sprintf(temp, "|Bf:%d,%d", s.planner, s.rx);
+    strcat(status, temp);
+    sprintf(temp, "|FS:%.0f,%d", s.rate, int(s.spindle_speed));
+    strcat(status, temp);
+    if (s.slow_fields) {
+        strcat(status, "|WCO:");
+        axes_printf(status, s.wco);
+        sprintf(temp, "|Ov:%d,%d,%d", 100, 100, 100);
+        strcat(status, temp);
+        strcat(status, "|A:");
+        strcat(status, "S");
+    }
+    strcat(status, ">\r\n");
+}
+
+static void axes_writer(ReportWriter& rpt, const float* values) {
+    for (int idx = 0; idx < n_axes; idx++) {
+        if (idx > 0) {
+            rpt.add(',');
+        }
+        rpt.addFloat(values[idx], 3);
+    }
+}
+
+static void report_writer(char* status, size_t size, const Snapshot& s) {
+    static float  cached_wco[MAX_AXES];
+    static char   wco_text[MAX_AXES * 20];
+    static size_t wco_length;
+    static char   ovr_text[32];
+    static size_t ovr_length;
+
+    ReportWriter rpt(status, size);
+    rpt.add('<').add("Run").add("|MPos:");
+    axes_writer(rpt, s.mpos);
+    rpt.add("|Bf:").addInt(s.planner).add(',').addInt(s.rx);
+    rpt.add("|FS:").addFloat(s.rate, 0).add(',').addInt(s.spindle_speed);
+    if (s.slow_fields) {
+        if (wco_length == 0 || memcmp(cached_wco, s.wco, n_axes * sizeof(float)) != 0) {
+            memcpy(cached_wco, s.wco, n_axes * sizeof(float));
+            ReportWriter text(wco_text, sizeof(wco_text));
+            axes_writer(text, s.wco);
+            wco_length = text.length();
+        }
+        rpt.add("|WCO:").add(wco_text, wco_length);
+        if (ovr_length == 0) {
+            ReportWriter text(ovr_text, sizeof(ovr_text));
+            text.add("|Ov:").addInt(100).add(',').addInt(100).add(',').addInt(100).add("|A:").add('S');
+            ovr_length = text.length();
+        }
+        rpt.add(ovr_text, ovr_length);
+    }
+    rpt.add(">\r\n");
+}
+
+static Snapshot snapshot(long i) {
+    Snapshot s = {};
+    for (int idx = 0; idx < n_axes; idx++) {
+        s.mpos[idx] = (i % 100000) * 0.0125f * (idx + 1) - 300;
+        s.wco[idx]  = -12.5f * (idx + 1);
+    }
+    s.planner       = i % 16;
+    s.rx            = 256 - i % 97;
+    s.rate          = 1500.0f - (i % 300) * 0.7f;
+    s.spindle_speed = 12000;
+    s.slow_fields   = i % 10 == 0;
+    return s;
+}
+
+template <typename Build>
+static double run(const char* name, Build build) {
+    using clock    = std::chrono::steady_clock;
+    size_t   bytes = 0;
+    char     status[200];
+    auto     start = clock::now();
+    for (long i = 0; i < n_reports; i++) {
+        build(status, snapshot(i));
+        bytes += strlen(status);
+    }
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    double rate    = n_reports / seconds;
+    printf("[bench] %-6s %10.0f reports/s, %.2f us/report, %zu bytes\n", name, rate, 1e6 / rate, bytes);
+    return rate;
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:a:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                n_reports = strtol(optarg, nullptr, 0);
+                break;
+            case 'a':
+                n_axes = atoi(optarg);
+                break;
+            default:
+                fputs(usage, opt == 'h' ? stdout : stderr);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (n_reports < 1 || n_axes < 1 || n_axes > MAX_AXES) {
+        fputs(usage, stderr);
+        return 2;
+    }
+
+    check_format_float();
+    for (long i = 0; i < 100000; i++) {
+        char a[200], b[200];
+        report_printf(a, snapshot(i));
+        report_writer(b, sizeof(b), snapshot(i));
+        if (strcmp(a, b) != 0) {
+            fprintf(stderr, "[bench] reports differ:\n  printf %s  writer %s", a, b);
+            return 1;
+        }
+    }
+
+    printf("[bench] %ld reports, %d axes\n", n_reports, n_axes);
+    double old_rate = run("printf", [](char* status, const Snapshot& s) { report_printf(status, s); });
+    double new_rate = run("writer", [](char* status, const Snapshot& s) { report_writer(status, 200, s); });
+    printf("[bench] writer is %.1fx printf\n", new_rate / old_rate);
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+  BenchSerial.cpp - host benchmark of the client input buffers
+
+  Streams g-code through one buffer per client, from a writer thread that
+  stands in for serialCheckTask to a reader thread that stands in for the
+  protocol loop, and reports the bytes per second each client gets. Two
+  buffers are compared:
+
+    locked  the previous WebUI::InputBuffer, written and read a character
+            at a time, each inside a spinlock like vTaskEnterCritical()
+    ring    SpscRing, written in blocks of SERIAL_READ_CHUNK characters and
+            read a character at a time without a lock
+
+  Both scan every character for realtime commands, as serial_receive() does.
+  On the ESP32 a critical section also masks interrupts, which a host cannot
+  model, so the difference there is larger than measured here.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/Grbl.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+static const char* usage =
+    "Usage: bench_serial [-c clients] [-n bytes]\n"
+    "  -c N   clients streaming at once (default CLIENT_COUNT)\n"
+    "  -n N   bytes sent to each client (default 16 MB)\n";
+
+static int    n_clients = CLIENT_COUNT;
+static size_t n_bytes   = 16 << 20;
+
+static const char sample[] = "G1 X12.345 Y-67.890 F1500\nG2 X10 Y5 I-2.5 J0.25\nM3 S1000\nG0 Z5\n";
+
+// Same test as is_realtime_command(), which the benchmark does not link.
+static inline bool is_realtime(uint8_t data) {
+    auto cmd = static_cast<Cmd>(data);
+    return data >= 0x80 || cmd == Cmd::Reset || cmd == Cmd::StatusReport || cmd == Cmd::CycleStart || cmd == Cmd::FeedHold;
+}
+
+// Returns the i-th character of the endless stream sent to every client.
+static inline uint8_t stream_char(size_t i) {
+    return sample[i % (sizeof(sample) - 1)];
+}
+
+class SpinLock {
+public:
+    void lock() {
+        while (_flag.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+    void unlock() { _flag.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag _flag = ATOMIC_FLAG_INIT;
+};
+
+// The previous scheme: one critical section per character on each side.
+struct LockedBuffers {
+    WebUI::InputBuffer buffer[CLIENT_COUNT];
+    SpinLock           mutex;
+
+    size_t write(int client, const uint8_t* data, size_t length) {
+        size_t n = 0;
+        for (; n < length; n++) {
+            if (is_realtime(data[n])) {
+                continue;
+            }
+            mutex.lock();
+            bool full = buffer[client].availableforwrite() == 0;
+            if (!full) {
+                buffer[client].write(data[n]);
+            }
+            mutex.unlock();
+            if (full) {
+                break;
+            }
+        }
+        return n;
+    }
+
+    int read(int client) {
+        mutex.lock();
+        int data = buffer[client].read();
+        mutex.unlock();
+        return data;
+    }
+};
+
+// The current scheme: blocks in, characters out, no lock.
+struct RingBuffers {
+    SpscRing<RX_BUFFER_SIZE> buffer[CLIENT_COUNT];
+
+    size_t write(int client, const uint8_t* data, size_t length) {
+        size_t space = buffer[client].availableForWrite();
+        if (length > space) {
+            length = space;
+        }
+        size_t start = 0;
+        for (size_t i = 0; i < length; i++) {
+            if (is_realtime(data[i])) {
+                buffer[client].write(data + start, i - start);
+                start = i + 1;
+            }
+        }
+        return start + buffer[client].write(data + start, length - start);
+    }
+
+    int read(int client) { return buffer[client].read(); }
+};
+
+template <typename Buffers>
+static double run(const char* name) {
+    static Buffers buffers;
+    uint64_t       checksum[CLIENT_COUNT] = {};
+    using clock                           = std::chrono::steady_clock;
+    auto start                            = clock::now();
+
+    std::thread writer([&] {
+        size_t  sent[CLIENT_COUNT] = {};
+        uint8_t chunk[SERIAL_READ_CHUNK];
+        for (bool busy = true; busy;) {
+            busy          = false;
+            bool progress = false;
+            for (int client = 0; client < n_clients; client++) {
+                size_t length = n_bytes - sent[client];
+                if (length == 0) {
+                    continue;
+                }
+                busy   = true;
+                length = length < SERIAL_READ_CHUNK ? length : SERIAL_READ_CHUNK;
+                for (size_t i = 0; i < length; i++) {
+                    chunk[i] = stream_char(sent[client] + i);
+                }
+                size_t n = buffers.write(client, chunk, length);
+                sent[client] += n;
+                progress |= n != 0;
+            }
+            if (!progress) {
+                std::this_thread::yield();  // Every buffer is full
+            }
+        }
+    });
+
+    size_t received[CLIENT_COUNT] = {};
+    for (bool busy = true; busy;) {
+        busy          = false;
+        bool progress = false;
+        for (int client = 0; client < n_clients; client++) {
+            if (received[client] == n_bytes) {
+                continue;
+            }
+            busy = true;
+            int c;
+            while ((c = buffers.read(client)) >= 0) {
+                checksum[client] += c ^ stream_char(received[client]++);
+                progress = true;
+            }
+        }
+        if (busy && !progress) {
+            std::this_thread::yield();  // Every buffer is empty
+        }
+    }
+    writer.join();
+
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    double rate    = n_bytes / seconds;
+    for (int client = 0; client < n_clients; client++) {
+        if (checksum[client] != 0) {
+            fprintf(stderr, "[bench] %s: client %d received corrupted data\n", name, client);
+            exit(1);
+        }
+    }
+    printf("[bench] %-6s %8.2f MB/s per client, %8.2f MB/s total\n", name, rate / 1e6, rate * n_clients / 1e6);
+    return rate;
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:h")) != -1) {
+        switch (opt) {
+            case 'c':
+                n_clients = atoi(optarg);
+                break;
+            case 'n':
+                n_bytes = strtoul(optarg, nullptr, 0);
+                break;
+            default:
+                fputs(usage, opt == 'h' ? stdout : stderr);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (n_clients < 1 || n_clients > CLIENT_COUNT || n_bytes == 0) {
+        fputs(usage, stderr);
+        return 2;
+    }
+    printf("[bench] %d clients, %zu bytes each, %d byte blocks, %d byte buffers\n", n_clients, n_bytes, SERIAL_READ_CHUNK, RX_BUFFER_SIZE);
+    double locked = run<LockedBuffers>("locked");
+    double ring   = run<RingBuffers>("ring");
+    printf("[bench] ring is %.1fx locked\n", ring / locked);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+  Sim.h - shared state of the host simulator
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstdio>
+
+// Simulated time, in nanoseconds since start. Nothing in the simulator reads
+// the host clock except the throughput statistics, so two runs of the same
+// input produce identical traces.
+extern uint64_t sim_time_ns;
+
+// Advance simulated time to `until_ns`, firing every step timer alarm, serial
+// tick and scheduled realtime command that falls due on the way.
+void sim_advance(uint64_t until_ns);
+
+// Block the way firmware blocks: run the step ISR until it loads the next
+// segment or stops, or let an idle tick pass if the step timer is paused.
+void sim_wait();
+
+bool     sim_step_timer_running();
+uint32_t sim_step_timer_alarms();   // Number of step ISRs run
+uint32_t sim_step_timer_periods();  // Number of periods written, one per segment loaded
+
+// Called by the step timer emulation for each step event. Writes the trace.
+void sim_record_step(uint8_t step_mask, uint8_t dir_mask);
+
+// Segment prep bookkeeping, provided by SimStepper.cpp which sees the statics of Stepper.cpp.
+uint8_t sim_segment_buffer_head();
+
+// Called once per simulated FreeRTOS tick, standing in for serialCheckTask.
+void sim_serial_tick();
+
+// Called when sim_wait() lets an idle tick pass. Ends a run that cannot progress.
+void sim_idle_tick();
+
+// Realtime commands scheduled from the command line, fired by sim_advance().
+void sim_fire_scheduled(uint64_t now_ns);
+bool sim_next_scheduled(uint64_t* when_ns);
+
+// Set by -q to discard Grbl's responses.
+extern bool sim_quiet;
+
+const uint64_t SIM_IDLE_TICK_NS = 1000000;  // One FreeRTOS tick
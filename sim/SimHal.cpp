@@ -0,0 +1,594 @@
+/*
+  SimHal.cpp - Arduino, ESP-IDF and FreeRTOS services for the host simulator
+
+  The simulator runs Grbl in a single host thread. Tasks are never started,
+  so the only concurrency left is the step timer interrupt, which is fired
+  synchronously whenever simulated time is advanced past its alarm.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Sim.h"
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <SD.h>
+#include <driver/timer.h>
+#include <xtensa/hal.h>
+#include <esp_task_wdt.h>
+#include <nvs.h>
+#include <WiFi.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+uint64_t sim_time_ns = 0;
+bool     sim_quiet   = false;
+
+// ============================ Step timer ================================
+
+// The step timer counts at fTimers / divider. Grbl runs it at 20MHz.
+static const uint64_t TIMER_TICK_NS = 50;
+
+static void (*timer_isr)(void*) = nullptr;
+static void*    timer_isr_arg   = nullptr;
+static bool     timer_running   = false;
+static bool     in_isr          = false;
+static uint64_t timer_alarm     = 0;  // In timer ticks
+static uint64_t timer_next_ns   = 0;  // When the running timer next fires
+static uint32_t alarm_count     = 0;
+static uint32_t period_count    = 0;
+
+timg_dev_t TIMERG0;
+
+esp_err_t timer_init(timer_group_t group, timer_idx_t idx, const timer_config_t* config) {
+    return ESP_OK;
+}
+
+esp_err_t timer_set_counter_value(timer_group_t group, timer_idx_t idx, uint64_t value) {
+    if (timer_running) {
+        timer_next_ns = sim_time_ns + (timer_alarm - value) * TIMER_TICK_NS;
+    }
+    return ESP_OK;
+}
+
+esp_err_t timer_set_alarm_value(timer_group_t group, timer_idx_t idx, uint64_t value) {
+    timer_alarm = value;
+    period_count++;
+    return ESP_OK;
+}
+
+esp_err_t timer_enable_intr(timer_group_t group, timer_idx_t idx) {
+    return ESP_OK;
+}
+
+esp_err_t timer_start(timer_group_t group, timer_idx_t idx) {
+    // The counter is always cleared before the timer is started.
+    if (!timer_running) {
+        timer_running = true;
+        timer_next_ns = sim_time_ns + timer_alarm * TIMER_TICK_NS;
+    }
+    return ESP_OK;
+}
+
+esp_err_t timer_pause(timer_group_t group, timer_idx_t idx) {
+    timer_running = false;
+    return ESP_OK;
+}
+
+esp_err_t timer_isr_register(timer_group_t       group,
+                             timer_idx_t         idx,
+                             void                (*fn)(void*),
+                             void*               arg,
+                             int                 intr_alloc_flags,
+                             timer_isr_handle_t* handle) {
+    timer_isr     = fn;
+    timer_isr_arg = arg;
+    return ESP_OK;
+}
+
+bool sim_step_timer_running() {
+    return timer_running;
+}
+
+uint32_t sim_step_timer_alarms() {
+    return alarm_count;
+}
+
+uint32_t sim_step_timer_periods() {
+    return period_count;
+}
+
+// Fire the step ISR at its alarm time. The timer auto-reloads, so the counter
+// restarts at the alarm and the next interrupt comes one (possibly rewritten)
+// alarm value later, independent of how long the ISR itself took.
+static void fire_step_timer() {
+    uint64_t fired = timer_next_ns;
+    sim_time_ns    = fired;
+    alarm_count++;
+    in_isr = true;
+    timer_isr(timer_isr_arg);
+    in_isr = false;
+    if (timer_running) {
+        timer_next_ns = fired + timer_alarm * TIMER_TICK_NS;
+        if (timer_next_ns < sim_time_ns) {
+            timer_next_ns = sim_time_ns;  // ISR overran its period
+        }
+    }
+}
+
+static uint64_t next_tick_ns = SIM_IDLE_TICK_NS;
+
+void sim_advance(uint64_t until_ns) {
+    if (in_isr) {
+        // Busy waits inside the ISR only move time forward.
+        if (until_ns > sim_time_ns) {
+            sim_time_ns = until_ns;
+        }
+        return;
+    }
+    while (true) {
+        // Run whichever event comes first, the step ISR winning ties.
+        uint64_t when;
+        bool     have_step = timer_running && timer_isr && timer_next_ns <= until_ns;
+        uint64_t step_ns   = have_step ? timer_next_ns : until_ns;
+        if (sim_next_scheduled(&when) && when <= step_ns && when <= next_tick_ns) {
+            sim_time_ns = when > sim_time_ns ? when : sim_time_ns;
+            sim_fire_scheduled(sim_time_ns);
+        } else if (next_tick_ns <= step_ns && next_tick_ns <= until_ns && !(have_step && timer_next_ns == next_tick_ns)) {
+            sim_time_ns = next_tick_ns;
+            next_tick_ns += SIM_IDLE_TICK_NS;
+            sim_serial_tick();
+        } else if (have_step) {
+            fire_step_timer();
+        } else {
+            break;
+        }
+    }
+    if (until_ns > sim_time_ns) {
+        sim_time_ns = until_ns;
+    }
+}
+
+void sim_wait() {
+    if (timer_running && timer_isr) {
+        uint32_t periods = period_count;
+        while (timer_running && period_count == periods) {
+            sim_advance(timer_next_ns);
+        }
+    } else {
+        sim_advance(sim_time_ns + SIM_IDLE_TICK_NS);
+        sim_idle_tick();
+    }
+}
+
+// ============================= Arduino ==================================
+
+void sim_nop() {
+    sim_advance(sim_time_ns + TIMER_TICK_NS);
+}
+
+int64_t esp_timer_get_time() {
+    return sim_time_ns / 1000;
+}
+
+unsigned xthal_get_ccount() {
+    using namespace std::chrono;
+    auto ns = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    return uint32_t(ns * ESP.getCpuFreqMHz() / 1000);
+}
+
+unsigned long millis() {
+    return sim_time_ns / 1000000;
+}
+
+unsigned long micros() {
+    return sim_time_ns / 1000;
+}
+
+void delay(uint32_t ms) {
+    sim_advance(sim_time_ns + uint64_t(ms) * 1000000);
+}
+
+void delayMicroseconds(uint32_t us) {
+    sim_advance(sim_time_ns + uint64_t(us) * 1000);
+}
+
+static uint8_t pin_levels[256];
+
+void __pinMode(uint8_t pin, uint8_t mode) {}
+
+void __digitalWrite(uint8_t pin, uint8_t val) {
+    pin_levels[pin] = val;
+}
+
+int __digitalRead(uint8_t pin) {
+    return pin_levels[pin];
+}
+
+int analogRead(uint8_t pin) {
+    return 0;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {}
+void detachInterrupt(uint8_t pin) {}
+
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits) {
+    return freq;
+}
+
+static uint32_t ledc_duty[16];
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+    ledc_duty[channel & 15] = duty;
+}
+
+uint32_t ledcRead(uint8_t channel) {
+    return ledc_duty[channel & 15];
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) {}
+void ledcDetachPin(uint8_t pin) {}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+EspClass ESP;
+
+void EspClass::restart() {
+    fflush(stdout);
+    exit(0);
+}
+
+bool psramFound() {
+    return false;
+}
+
+void* ps_malloc(size_t size) {
+    return malloc(size);
+}
+
+// Grbl's responses go to stdout; input is injected by Simulator.cpp.
+HardwareSerial Serial;
+
+int HardwareSerial::available() {
+    return 0;
+}
+
+int HardwareSerial::read() {
+    return -1;
+}
+
+int HardwareSerial::peek() {
+    return -1;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    return sim_quiet ? size : fwrite(buffer, 1, size, stdout);
+}
+
+fs::SDFS SD;
+
+WiFiClass WiFi;
+
+// ============================== EEPROM ==================================
+
+static std::vector<uint8_t> eeprom_data;
+
+EEPROMClass EEPROM;
+
+bool EEPROMClass::begin(size_t size) {
+    eeprom_data.assign(size, 0xff);
+    return true;
+}
+
+uint8_t EEPROMClass::read(int address) {
+    return size_t(address) < eeprom_data.size() ? eeprom_data[address] : 0xff;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+    if (size_t(address) < eeprom_data.size()) {
+        eeprom_data[address] = value;
+    }
+}
+
+uint8_t* EEPROMClass::getDataPtr() {
+    return eeprom_data.data();
+}
+
+// =============================== NVS ====================================
+
+static std::map<std::string, std::vector<uint8_t>> nvs_data;
+
+static esp_err_t nvs_get(const char* key, void* out, size_t size) {
+    auto it = nvs_data.find(key);
+    if (it == nvs_data.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (it->second.size() != size) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, it->second.data(), size);
+    return ESP_OK;
+}
+
+static esp_err_t nvs_set(const char* key, const void* value, size_t size) {
+    auto p        = static_cast<const uint8_t*>(value);
+    nvs_data[key] = std::vector<uint8_t>(p, p + size);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode open_mode, nvs_handle* out_handle) {
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_i8(nvs_handle handle, const char* key, int8_t* out_value) {
+    return nvs_get(key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_set_i8(nvs_handle handle, const char* key, int8_t value) {
+    return nvs_set(key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_i32(nvs_handle handle, const char* key, int32_t* out_value) {
+    return nvs_get(key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_set_i32(nvs_handle handle, const char* key, int32_t value) {
+    return nvs_set(key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_str(nvs_handle handle, const char* key, char* out_value, size_t* length) {
+    auto it = nvs_data.find(key);
+    if (it == nvs_data.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value == nullptr) {
+        *length = it->second.size();
+        return ESP_OK;
+    }
+    if (*length < it->second.size()) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, it->second.data(), it->second.size());
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle handle, const char* key, const char* value) {
+    return nvs_set(key, value, strlen(value) + 1);
+}
+
+// Like the real NVS, a blob is only returned if it fits the buffer. Grbl
+// sometimes passes an uninitialized length, so the stored size is used.
+esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* out_value, size_t* length) {
+    auto it = nvs_data.find(key);
+    if (it == nvs_data.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *length = it->second.size();
+    if (out_value) {
+        memcpy(out_value, it->second.data(), it->second.size());
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void* value, size_t length) {
+    return nvs_set(key, value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char* key) {
+    return nvs_data.erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle handle) {
+    nvs_data.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle handle) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats) {
+    nvs_stats->used_entries    = nvs_data.size();
+    nvs_stats->total_entries   = 630;
+    nvs_stats->free_entries    = nvs_stats->total_entries - nvs_stats->used_entries;
+    nvs_stats->namespace_count = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle handle) {}
+
+// ============================= FreeRTOS =================================
+
+// Tasks are recorded but never run. The simulator drives Grbl's input and
+// time itself, which keeps every run deterministic.
+static std::vector<std::string> task_names;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t      pvTaskCode,
+                                   const char*         pcName,
+                                   uint32_t            usStackDepth,
+                                   void*               pvParameters,
+                                   UBaseType_t         uxPriority,
+                                   TaskHandle_t* const pvCreatedTask,
+                                   BaseType_t          xCoreID) {
+    task_names.push_back(pcName);
+    if (pvCreatedTask) {
+        *pvCreatedTask = reinterpret_cast<TaskHandle_t>(task_names.size());
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t      pvTaskCode,
+                       const char*         pcName,
+                       uint32_t            usStackDepth,
+                       void*               pvParameters,
+                       UBaseType_t         uxPriority,
+                       TaskHandle_t* const pvCreatedTask) {
+    return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {}
+
+void vTaskDelay(TickType_t ticks) {
+    sim_advance(sim_time_ns + uint64_t(ticks) * SIM_IDLE_TICK_NS);
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    *previousWakeTime += increment;
+    uint64_t wake = uint64_t(*previousWakeTime) * SIM_IDLE_TICK_NS;
+    sim_advance(wake > sim_time_ns ? wake : sim_time_ns);
+}
+
+TickType_t xTaskGetTickCount() {
+    return sim_time_ns / SIM_IDLE_TICK_NS;
+}
+
+TickType_t xTaskGetTickCountFromISR() {
+    return xTaskGetTickCount();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return nullptr;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {}
+
+// Notifications are dropped, since the tasks they would wake never run.
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t wait) {
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {}
+
+uint32_t xPortGetFreeHeapSize() {
+    return ESP.getFreeHeap();
+}
+
+int xPortGetCoreID() {
+    return 1;
+}
+
+extern "C" esp_err_t esp_task_wdt_reset() {
+    return ESP_OK;
+}
+
+struct SimQueue {
+    size_t                            itemSize;
+    size_t                            length;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new SimQueue { itemSize, length, {} };
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+    auto q = static_cast<SimQueue*>(queue);
+    if (q->items.size() >= q->length) {
+        return pdFAIL;
+    }
+    auto p = static_cast<const uint8_t*>(item);
+    q->items.emplace_back(p, p + q->itemSize);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) {
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) {
+    auto q = static_cast<SimQueue*>(queue);
+    if (q->items.empty()) {
+        return pdFAIL;
+    }
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return static_cast<SimQueue*>(queue)->items.size();
+}
+
+void xQueueReset(QueueHandle_t queue) {
+    static_cast<SimQueue*>(queue)->items.clear();
+}
+
+struct SimSemaphore {
+    int count;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new SimSemaphore { 1 };
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return new SimSemaphore { 0 };
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+    auto s = static_cast<SimSemaphore*>(sem);
+    if (s->count == 0) {
+        return pdFAIL;
+    }
+    s->count--;
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    static_cast<SimSemaphore*>(sem)->count = 1;
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken) {
+    return xSemaphoreGive(sem);
+}
+
+// With a single thread the holder is always the caller, so only the depth is tracked.
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return new SimSemaphore { 0 };
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait) {
+    static_cast<SimSemaphore*>(sem)->count++;
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+    auto s = static_cast<SimSemaphore*>(sem);
+    if (s->count == 0) {
+        return pdFAIL;
+    }
+    s->count--;
+    return pdPASS;
+}
@@ -0,0 +1,59 @@
+/*
+  SimMotors.cpp - motor group API for the host simulator
+
+  Replaces Motors/Motors.cpp. Instead of driving pins, every step event is
+  handed to the trace writer in Simulator.cpp.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Sim.h"
+
+#include "src/Grbl.h"
+
+void init_motors() {
+    grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Simulated motors, %d axes", number_axis->get());
+    motors_set_disable(true);
+}
+
+uint8_t get_next_trinamic_driver_index() {
+    return 0;
+}
+
+void readSgTask(void* pvParameters) {}
+
+void servoUpdateTask(void* pvParameters) {}
+
+void motors_read_settings() {}
+
+uint8_t motors_set_homing_mode(uint8_t homing_mask, bool isHoming) {
+    return homing_mask;
+}
+
+void motors_set_disable(bool disable) {}
+
+void motors_step(uint8_t step_mask, uint8_t dir_mask) {
+    if (step_mask) {
+        sim_record_step(step_mask, dir_mask);
+    }
+}
+
+void motors_unstep() {}
+
+#ifdef STEPPER_ISR_STATS
+// Host cycles mean nothing for the ESP32, so there is no step timing to report.
+MotorsStepTime motors_take_step_time() {
+    return {};
+}
+#endif
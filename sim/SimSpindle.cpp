@@ -0,0 +1,45 @@
+/*
+  SimSpindle.cpp - spindle selection for the host simulator
+
+  Replaces Spindles/Spindle.cpp. Only the null spindle is built, so spindle
+  commands are accepted but have no effect on the trace.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/Grbl.h"
+#include "src/Spindles/NullSpindle.h"
+
+namespace Spindles {
+    Null null;
+
+    void Spindle::select() {
+        spindle = &null;
+        spindle->init();
+    }
+
+    bool Spindle::isRateAdjusted() {
+        return false;
+    }
+
+    void Spindle::sync(SpindleState state, uint32_t rpm) {
+        if (sys.state == State::CheckMode) {
+            return;
+        }
+        protocol_buffer_synchronize();
+        set_state(state, rpm);
+    }
+}
+
+Spindles::Spindle* spindle;
@@ -0,0 +1,27 @@
+/*
+  SimStepper.cpp - the stepper module as built for the host simulator
+
+  Stepper.cpp is compiled unchanged. It is included here so the simulator can
+  see how far segment prep has filled the segment buffer.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Sim.h"
+
+#include "src/Stepper.cpp"
+
+uint8_t sim_segment_buffer_head() {
+    return segment_buffer_head;
+}
@@ -0,0 +1,33 @@
+/*
+  SimStubs.cpp - firmware modules the host simulator leaves out
+
+  The web settings, SD card and I2S output need hardware or libraries the
+  host does not have. These are the few entry points the rest of Grbl calls.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/Grbl.h"
+
+namespace WebUI {
+    void make_web_settings() {}
+}
+
+uint32_t sd_get_current_line_number() {
+    return 0;
+}
+
+uint32_t i2s_out_push_sample(uint32_t usec) {
+    return 0;
+}
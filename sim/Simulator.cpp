@@ -0,0 +1,587 @@
+/*
+  Simulator.cpp - runs Grbl_ESP32 on a Linux host
+
+  G-code is read from files or stdin and fed to the serial client as fast as
+  Grbl accepts it. Grbl's own protocol loop, parser, planner, segment prep and
+  step ISR run unchanged; only the hardware underneath is simulated (see
+  SimHal.cpp). Time is simulated too, so the step/dir trace is identical
+  from run to run and from host to host.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Sim.h"
+
+#include "src/Grbl.h"
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// The simulator hooks these firmware entry points with the linker's --wrap
+// option, so the firmware sources stay untouched.
+extern "C" {
+uint8_t __real__Z11serial_readh(uint8_t client);
+int     __real__Z16serial_read_linehPPc(uint8_t client, char** line);
+void    __real__Z11serial_sendhPKcm(uint8_t client, const char* text, size_t length);
+void    __real__Z14st_prep_bufferv();
+uint8_t __real__Z16plan_buffer_linePfP16plan_line_data_t(float* target, plan_line_data_t* pl_data);
+uint8_t __real__Z15plan_buffer_arcPfP16plan_line_data_tP10plan_arc_t(float* target, plan_line_data_t* pl_data, plan_arc_t* arc);
+}
+
+static const char* usage =
+    "Usage: grbl_sim [options] [file.nc ...]\n"
+    "  -t FILE     write the step/dir trace to FILE\n"
+    "  -r MS:CMD   inject realtime command CMD (a character or 0xNN) at MS milliseconds\n"
+    "  -d MS       send one input line every MS milliseconds instead of streaming\n"
+    "  -q          do not print Grbl's responses\n"
+    "  -b BLOCKS   time plan_buffer_line() on BLOCKS generated blocks, then exit\n"
+    "  -k MOVES    time inverse kinematics on MOVES generated moves, then exit\n"
+    "  -g PASSES   time gc_tokenize_line() on PASSES passes over the input lines, then exit\n"
+    "  -h          show this help\n"
+    "With no files, g-code is read from stdin.\n";
+
+static FILE*                            trace = nullptr;
+static std::vector<FILE*>               inputs;
+static size_t                           input_index   = 0;
+static bool                             input_done    = false;
+static bool                             at_line_start = true;
+static uint64_t                         line_delay_ns = 0;
+static uint64_t                         next_line_ns  = 0;
+static std::multimap<uint64_t, uint8_t> scheduled;
+
+const uint64_t STALL_LIMIT_NS = 10000000000ULL;  // 10 seconds
+
+static int32_t position[MAX_N_AXIS];
+
+struct SimStats {
+    uint32_t lines;
+    uint32_t blocks;
+    uint32_t segments;
+    uint64_t steps;
+    double   plan_seconds;
+    double   prep_seconds;
+};
+static SimStats stats;
+
+static double host_seconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ============================ Step trace ================================
+
+void sim_record_step(uint8_t step_mask, uint8_t dir_mask) {
+    auto n_axis = number_axis->get();
+    for (int axis = 0; axis < n_axis; axis++) {
+        if (bitnum_istrue(step_mask, axis)) {
+            position[axis] += bitnum_istrue(dir_mask, axis) ? -1 : 1;
+            stats.steps++;
+        }
+    }
+    if (trace) {
+        fprintf(trace, "%llu.%03llu %02x %02x", sim_time_ns / 1000ULL, sim_time_ns % 1000ULL, step_mask, dir_mask);
+        for (int axis = 0; axis < n_axis; axis++) {
+            fprintf(trace, " %d", position[axis]);
+        }
+        fputc('\n', trace);
+    }
+}
+
+// ======================= Scheduled realtime input ========================
+
+void sim_fire_scheduled(uint64_t now_ns) {
+    while (!scheduled.empty() && scheduled.begin()->first <= now_ns) {
+        uint8_t cmd = scheduled.begin()->second;
+        scheduled.erase(scheduled.begin());
+        execute_realtime_command(static_cast<Cmd>(cmd), CLIENT_SERIAL);
+    }
+}
+
+bool sim_next_scheduled(uint64_t* when_ns) {
+    if (scheduled.empty()) {
+        return false;
+    }
+    *when_ns = scheduled.begin()->first;
+    return true;
+}
+
+static bool parse_schedule(const char* arg) {
+    char*  end;
+    double ms = strtod(arg, &end);
+    if (end == arg || *end != ':' || ms < 0) {
+        return false;
+    }
+    const char* cmd = end + 1;
+    uint8_t     c;
+    if (strlen(cmd) == 1) {
+        c = cmd[0];
+    } else if (strncmp(cmd, "0x", 2) == 0) {
+        c = strtoul(cmd, &end, 16);
+        if (*end) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    if (!is_realtime_command(c)) {
+        return false;
+    }
+    scheduled.emplace(uint64_t(ms * 1000000.0), c);
+    return true;
+}
+
+// ============================= Statistics ================================
+
+static void print_stats() {
+    double machine_seconds = sim_time_ns / 1e9;
+    fprintf(stderr, "[sim] lines %u, planner blocks %u, segments %u, step ISRs %u, steps %llu\n",
+            stats.lines,
+            stats.blocks,
+            stats.segments,
+            sim_step_timer_alarms(),
+            (unsigned long long)stats.steps);
+    fprintf(stderr, "[sim] machine time %.6f s\n", machine_seconds);
+    fprintf(stderr, "[sim] host planner %.6f s (%.3f us/block)\n",
+            stats.plan_seconds,
+            stats.blocks ? stats.plan_seconds * 1e6 / stats.blocks : 0.0);
+    plan_stats_t plan_stats = plan_get_stats();
+    fprintf(stderr, "[sim] planner recalculations %u, deferred %u, completed %u\n",
+            plan_stats.recalculations,
+            plan_stats.deferred,
+            plan_stats.completed);
+    mc_smooth_stats_t smooth = mc_get_smooth_stats();
+    if (smooth.moves) {
+        fprintf(stderr,
+                "[sim] path smoothing %u moves, %u blocks (%u removed), %u arcs\n",
+                smooth.moves,
+                smooth.blocks,
+                smooth.moves - smooth.blocks,
+                smooth.arcs);
+    }
+    fprintf(stderr, "[sim] segment buffer %u, underruns %u\n", st_get_segment_buffer_size(), st_get_segment_underruns());
+    fprintf(stderr, "[sim] host segment prep %.6f s (%.3f us/segment, %.0f segments/s)\n",
+            stats.prep_seconds,
+            stats.segments ? stats.prep_seconds * 1e6 / stats.segments : 0.0,
+            stats.prep_seconds > 0 ? stats.segments / stats.prep_seconds : 0.0);
+#ifdef REALTIME_LATENCY_STATS
+    static const char* cmd_names[]   = { "hold", "cycle start", "reset" };
+    static const char* stage_names[] = { "protocol", "prep", "step" };
+    for (int cmd = 0; cmd < int(RtLatencyCmd::Count); cmd++) {
+        for (int stage = 0; stage < int(RtLatencyStage::Count); stage++) {
+            rt_latency_stats_t latency = rt_latency_get_stats(RtLatencyCmd(cmd), RtLatencyStage(stage));
+            if (latency.count) {
+                fprintf(stderr, "[sim] %s to %s latency: %u, avg %.3f ms, max %.3f ms\n",
+                        cmd_names[cmd],
+                        stage_names[stage],
+                        latency.count,
+                        latency.total_us / 1000.0 / latency.count,
+                        latency.max_us / 1000.0);
+            }
+        }
+    }
+#endif
+}
+
+static void finish() {
+    if (sys.state != State::Idle) {
+        fprintf(stderr, "[sim] input ended in state %d\n", int(sys.state));
+    }
+    print_stats();
+    if (trace) {
+        fclose(trace);
+    }
+    fflush(stdout);
+    exit(sys.state == State::Alarm ? 1 : 0);
+}
+
+// =========================== Firmware hooks =============================
+
+// Returns the next input character, or EOF once every input is exhausted.
+// A missing newline at the end of a file is supplied.
+static int next_input_char() {
+    static int last = '\n';
+    while (input_index < inputs.size()) {
+        int c = fgetc(inputs[input_index]);
+        if (c != EOF) {
+            return last = c;
+        }
+        if (inputs[input_index] != stdin) {
+            fclose(inputs[input_index]);
+        }
+        input_index++;
+        if (last != '\n') {
+            return last = '\n';
+        }
+    }
+    return EOF;
+}
+
+// Move input into the serial client's buffer through serial_receive(), in
+// blocks like serialCheckTask: realtime characters are acted on at once and
+// the rest is buffered. The sender keeps the buffer full, or with -d sends
+// one line per interval like a terminal paste.
+static void pump_input() {
+    uint8_t data[SERIAL_READ_CHUNK];
+    size_t  length   = 0;
+    size_t  buffered = 0;
+    size_t  space    = client_buffer[CLIENT_SERIAL].availableForWrite();
+    while (!input_done && buffered < space) {
+        if (at_line_start && sim_time_ns < next_line_ns) {
+            break;
+        }
+        int c = next_input_char();
+        if (c == EOF) {
+            input_done = true;
+            break;
+        }
+        at_line_start = c == '\n';
+        if (at_line_start) {
+            stats.lines++;
+            next_line_ns = sim_time_ns + line_delay_ns;
+        }
+        data[length++] = c;
+        if (!is_realtime_command(c)) {
+            buffered++;
+        }
+        if (length == SERIAL_READ_CHUNK) {
+            serial_receive(CLIENT_SERIAL, data, length);
+            length = 0;
+        }
+    }
+    serial_receive(CLIENT_SERIAL, data, length);
+}
+
+// serialCheckTask runs once per FreeRTOS tick, so realtime characters in
+// the input are seen even while the protocol loop is blocked.
+void sim_serial_tick() {
+    pump_input();
+}
+
+// The step timer is stopped and nothing is happening. If that lasts with no
+// input or scheduled command left to change it, Grbl is waiting for a cycle
+// start or reset that will never come.
+void sim_idle_tick() {
+    static uint64_t stalled_since = 0;
+    uint64_t        when;
+    if (!input_done || sim_next_scheduled(&when)) {
+        stalled_since = 0;
+        return;
+    }
+    if (stalled_since == 0) {
+        stalled_since = sim_time_ns;
+    } else if (sim_time_ns - stalled_since > STALL_LIMIT_NS) {
+        fprintf(stderr, "[sim] stalled with no input left\n");
+        finish();
+    }
+}
+
+// The protocol loop found no input to act on. Send more, and if there is
+// still none and nothing is moving, skip ahead to the next line or scheduled
+// command. Lines are only held back whole, so any input left is a line. A
+// cycle stop the protocol loop has yet to see counts as moving, so a hold is
+// complete before a scheduled resume arrives, and so do moves held back for
+// path smoothing, which the protocol loop sends on once it runs out of input.
+static void wait_for_input() {
+    pump_input();
+    bool moving = sim_step_timer_running() || sys.state == State::Cycle || cycle_stop || mc_smooth_pending() ||
+                  (plan_get_current_block() != NULL && sys.state == State::Idle);
+    if (!client_buffer[CLIENT_SERIAL].available() && !moving) {
+        // Nothing to do until the next line or scheduled command is due.
+        uint64_t when = UINT64_MAX;
+        sim_next_scheduled(&when);
+        if (!input_done && next_line_ns < when) {
+            when = next_line_ns;
+        }
+        if (when == UINT64_MAX) {
+            finish();
+        }
+        sim_advance(when);
+        pump_input();
+    }
+}
+
+extern "C" uint8_t __wrap__Z11serial_readh(uint8_t client) {
+    if (client == CLIENT_SERIAL && !client_buffer[CLIENT_SERIAL].available()) {
+        wait_for_input();
+    }
+    return __real__Z11serial_readh(client);
+}
+
+extern "C" int __wrap__Z16serial_read_linehPPc(uint8_t client, char** line) {
+    int len = __real__Z16serial_read_linehPPc(client, line);
+    if (client == CLIENT_SERIAL && len == SERIAL_LINE_NONE) {
+        wait_for_input();
+        len = __real__Z16serial_read_linehPPc(client, line);
+    }
+    return len;
+}
+
+// serialTxTask never runs, so the output it would write is written as soon as it is queued.
+extern "C" void __wrap__Z11serial_sendhPKcm(uint8_t client, const char* text, size_t length) {
+    __real__Z11serial_sendhPKcm(client, text, length);
+    serial_tx_drain();
+}
+
+// Segment prep runs as fast as the host allows. When it can make no progress,
+// because the segment buffer is full or the planner is empty, the firmware
+// would spin until the step ISR drains a segment, so simulated time moves on.
+extern "C" void __wrap__Z14st_prep_bufferv() {
+    uint8_t head  = sim_segment_buffer_head();
+    double  start = host_seconds();
+    __real__Z14st_prep_bufferv();
+    double  elapsed  = host_seconds() - start;
+    uint8_t size     = st_get_segment_buffer_size();
+    uint8_t produced = (sim_segment_buffer_head() + size - head) % size;
+    if (produced) {
+        stats.segments += produced;
+        stats.prep_seconds += elapsed;
+    } else {
+        sim_wait();
+    }
+}
+
+// Set by bench_kinematics(), which counts the lines it sends here instead of planning them.
+static bool     bench_kinematics_lines = false;
+static uint32_t bench_kinematics_count = 0;
+
+extern "C" uint8_t __wrap__Z16plan_buffer_linePfP16plan_line_data_t(float* target, plan_line_data_t* pl_data) {
+    if (bench_kinematics_lines) {
+        bench_kinematics_count++;
+        return PLAN_OK;
+    }
+    double  start  = host_seconds();
+    uint8_t result = __real__Z16plan_buffer_linePfP16plan_line_data_t(target, pl_data);
+    stats.plan_seconds += host_seconds() - start;
+    if (result == PLAN_OK) {
+        stats.blocks++;
+    }
+    return result;
+}
+
+extern "C" uint8_t __wrap__Z15plan_buffer_arcPfP16plan_line_data_tP10plan_arc_t(float* target, plan_line_data_t* pl_data, plan_arc_t* arc) {
+    double  start  = host_seconds();
+    uint8_t result = __real__Z15plan_buffer_arcPfP16plan_line_data_tP10plan_arc_t(target, pl_data, arc);
+    stats.plan_seconds += host_seconds() - start;
+    if (result == PLAN_OK) {
+        stats.blocks++;
+    }
+    return result;
+}
+
+// Plans blocks through random points straight into the planner, without stepping them, and
+// prints blocks per second. Each block turns a corner, so every one computes a junction speed and
+// replans. The oldest block is dropped whenever the buffer fills, as if it had been stepped.
+static void bench_planner(uint32_t n_blocks) {
+    plan_line_data_t pl_data            = {};
+    float            target[MAX_N_AXIS] = {};
+    uint32_t         seed               = 1;
+    uint32_t         planned            = 0;
+    auto             n_axis             = number_axis->get();
+
+    sys.f_override = FeedOverride::Default;
+    sys.r_override = RapidOverride::Default;
+    plan_reset();
+    st_reset();
+    plan_sync_position();
+    double start = host_seconds();
+    for (uint32_t i = 0; i < n_blocks; i++) {
+        for (int axis = 0; axis < n_axis; axis++) {
+            seed         = seed * 1103515245 + 12345;
+            target[axis] = (seed >> 16) % 20000 / 100.0f;  // 0-200mm
+        }
+        pl_data.feed_rate = 500.0f + i % 4 * 500.0f;
+        if (plan_check_full_buffer()) {
+            plan_discard_current_block();
+        }
+        if (__real__Z16plan_buffer_linePfP16plan_line_data_t(target, &pl_data) == PLAN_OK) {
+            planned++;
+        }
+    }
+    double elapsed = host_seconds() - start;
+    fprintf(stderr,
+            "[sim] planner benchmark %u blocks in %.6f s, %.0f blocks/s (%.3f us/block)\n",
+            planned,
+            elapsed,
+            planned / elapsed,
+            elapsed * 1e6 / planned);
+}
+
+#ifdef USE_KINEMATICS
+// Sends moves between random points within 10mm of where the motors' zero puts the tool through
+// inverse_kinematics(), and prints the segments per second that reach plan_buffer_line(). The
+// segments are counted, not planned, so this times splitting moves and converting the segments.
+static void bench_kinematics(uint32_t n_moves) {
+    plan_line_data_t pl_data              = {};
+    float            center[MAX_N_AXIS]   = {};
+    float            position[MAX_N_AXIS] = {};
+    float            target[MAX_N_AXIS]   = {};
+    float            from[MAX_N_AXIS];
+    uint32_t         seed = 1;
+
+    plan_reset();
+    st_reset();
+    forward_kinematics(center);
+    memcpy(position, center, sizeof(position));
+    memcpy(target, center, sizeof(target));
+    pl_data.feed_rate      = 1000.0f;
+    bench_kinematics_lines = true;
+    double start           = host_seconds();
+    for (uint32_t i = 0; i < n_moves; i++) {
+        for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+            seed         = seed * 1103515245 + 12345;
+            target[axis] = center[axis] + (seed >> 16) % 2000 / 100.0f - 10.0f;
+        }
+        memcpy(from, position, sizeof(from));  // inverse_kinematics() may change it
+        inverse_kinematics(target, &pl_data, from);
+        memcpy(position, target, sizeof(position));
+    }
+    double elapsed         = host_seconds() - start;
+    bench_kinematics_lines = false;
+    fprintf(stderr,
+            "[sim] kinematics benchmark %s: %u moves, %u segments in %.6f s, %.0f segments/s (%.3f us/segment)\n",
+            MACHINE_NAME,
+            n_moves,
+            bench_kinematics_count,
+            elapsed,
+            bench_kinematics_count / elapsed,
+            elapsed * 1e6 / bench_kinematics_count);
+}
+#endif
+
+// Splits every input line into words with gc_tokenize_line(), passes times over, and prints the
+// time per line. The lines are read into memory first, so this times the tokenizer alone.
+static void bench_tokenize(uint32_t passes) {
+    std::vector<std::string> lines;
+    char                     line[LINE_BUFFER_SIZE];
+    size_t                   bytes = 0;
+    for (FILE* in : inputs) {
+        while (fgets(line, sizeof(line), in)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            lines.push_back(line);
+            bytes += lines.back().size() + 1;
+        }
+    }
+    if (lines.empty()) {
+        fputs("[sim] -g needs input lines\n", stderr);
+        return;
+    }
+    gc_tokens_t tokens;
+    uint32_t    words = 0;
+    double      start = host_seconds();
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        for (const std::string& text : lines) {
+            memcpy(line, text.c_str(), text.size() + 1);  // The tokenizer changes the line in place
+            gc_tokenize_line(line, CLIENT_SERIAL, &tokens);
+            words += tokens.n_words;
+        }
+    }
+    double   elapsed = host_seconds() - start;
+    uint64_t total   = uint64_t(passes) * lines.size();
+    fprintf(stderr,
+            "[sim] tokenizer benchmark: %zu lines, %zu bytes, %u words per pass, %.6f s for %u passes (%.3f us/line)\n",
+            lines.size(),
+            bytes,
+            words / passes,
+            elapsed,
+            passes,
+            elapsed * 1e6 / total);
+}
+
+// ================================ main ==================================
+
+int main(int argc, char* argv[]) {
+    int      opt;
+    uint32_t bench_blocks = 0;
+    uint32_t bench_moves  = 0;
+    uint32_t bench_passes = 0;
+    while ((opt = getopt(argc, argv, "t:r:d:qb:k:g:h")) != -1) {
+        switch (opt) {
+            case 't':
+                trace = fopen(optarg, "w");
+                if (!trace) {
+                    perror(optarg);
+                    return 2;
+                }
+                break;
+            case 'r':
+                if (!parse_schedule(optarg)) {
+                    fprintf(stderr, "Bad realtime command %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'd':
+                line_delay_ns = uint64_t(atof(optarg) * 1000000.0);
+                break;
+            case 'q':
+                sim_quiet = true;
+                break;
+            case 'b':
+                bench_blocks = strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                bench_moves = strtoul(optarg, NULL, 0);
+                break;
+            case 'g':
+                bench_passes = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fputs(usage, opt == 'h' ? stdout : stderr);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        FILE* in = fopen(argv[i], "r");
+        if (!in) {
+            perror(argv[i]);
+            return 2;
+        }
+        inputs.push_back(in);
+    }
+    if (inputs.empty()) {
+        inputs.push_back(stdin);
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);  // Keep responses in step when driven interactively
+    grbl_init();
+    if (bench_blocks) {
+        bench_planner(bench_blocks);
+        return 0;
+    }
+    if (bench_passes) {
+        bench_tokenize(bench_passes);
+        return 0;
+    }
+    if (bench_moves) {
+#ifdef USE_KINEMATICS
+        bench_kinematics(bench_moves);
+        return 0;
+#else
+        fputs("[sim] -k needs a machine with USE_KINEMATICS\n", stderr);
+        return 2;
+#endif
+    }
+    if (trace) {
+        fprintf(trace, "# time_us step dir");
+        for (int axis = 0; axis < number_axis->get(); axis++) {
+            fprintf(trace, " %c", "XYZABC"[axis]);
+        }
+        fputc('\n', trace);
+    }
+    while (true) {
+        run_once();
+    }
+}
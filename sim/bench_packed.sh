@@ -0,0 +1,44 @@
+#!/bin/sh
+# Compares g-code text against packed lines (see GC_PACKED_LINE in GCode.h).
+#
+#   ./bench_packed.sh [file.nc ...]
+#
+# Without files, runs the raster and arc fixtures from Grbl_Esp32/src/tests.
+# Each file is packed with doc/script/pack_gcode.py. For both forms, prints
+# the size in bytes and the time gc_tokenize_line() takes per line, then
+# checks that both run to the same step trace, timestamps included.
+
+set -e
+cd "$(dirname "$0")"
+
+if [ $# -eq 0 ]; then
+    set -- ../Grbl_Esp32/src/tests/raster_tree.nc ../Grbl_Esp32/src/tests/arcs_arrows.nc
+fi
+passes=${PASSES:-100}
+
+make -s
+
+out=build/bench-packed
+mkdir -p $out
+status=0
+
+for file in "$@"; do
+    name=$(basename "$file" .nc)
+    cp "$file" $out/$name.text.nc
+    python3 ../doc/script/pack_gcode.py -o $out/$name.packed.nc "$file"
+    for form in text packed; do
+        ./grbl_sim -q -g $passes $out/$name.$form.nc 2>$out/$name.$form.stats
+        bytes=$(wc -c <$out/$name.$form.nc)
+        per_line=$(sed -n 's/.*(\(.*\) us\/line)$/\1/p' $out/$name.$form.stats)
+        echo "$name $form: $bytes bytes, $per_line us/line to tokenize"
+        ./grbl_sim -q -t $out/$name.$form.trace $out/$name.$form.nc 2>/dev/null
+    done
+    if cmp -s $out/$name.text.trace $out/$name.packed.trace; then
+        echo "$name: same step trace"
+    else
+        echo "$name: TRACES DIFFER, see $out/$name.*.trace"
+        status=1
+    fi
+done
+
+exit $status
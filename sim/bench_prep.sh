@@ -0,0 +1,50 @@
+#!/bin/sh
+# Compares the default segment prep against STEPPER_SINGLE_PRECISION_PREP.
+#
+#   ./bench_prep.sh [file.nc ...]
+#
+# Without files, runs the raster and arc fixtures from Grbl_Esp32/src/tests.
+# Both builds plan arcs with PLANNER_NATIVE_ARCS, so that arcs are stepped
+# along chords in segment prep; those chords must not move with the precision.
+# Both variants are built side by side under build/. For each file, prints
+# the host segment prep rate of each and checks that they emit the same
+# steps: the trace with the timestamps removed must be identical. The
+# largest difference in step time is printed as well.
+
+set -e
+cd "$(dirname "$0")"
+
+if [ $# -eq 0 ]; then
+    set -- ../Grbl_Esp32/src/tests/raster_tree.nc ../Grbl_Esp32/src/tests/arcs_arrows.nc
+fi
+
+# make does not rebuild when only CPPFLAGS change, so start both builds afresh.
+rm -rf build/prep-double build/prep-single
+make -s BUILD=build/prep-double PROGRAM=build/grbl_sim_double CPPFLAGS=-DPLANNER_NATIVE_ARCS
+make -s BUILD=build/prep-single PROGRAM=build/grbl_sim_single CPPFLAGS="-DPLANNER_NATIVE_ARCS -DSTEPPER_SINGLE_PRECISION_PREP"
+
+out=build/bench-prep
+mkdir -p $out
+status=0
+
+for file in "$@"; do
+    name=$(basename "$file" .nc)
+    for variant in double single; do
+        build/grbl_sim_$variant -q -t $out/$name.$variant.trace "$file" 2>$out/$name.$variant.stats
+        rate=$(sed -n 's/.*us\/segment, \([0-9]*\) segments\/s.*/\1/p' $out/$name.$variant.stats)
+        time=$(sed -n 's/^\[sim\] machine time \(.*\) s$/\1/p' $out/$name.$variant.stats)
+        echo "$name $variant: $rate segments/s, machine time $time s"
+    done
+    cut -d' ' -f2- $out/$name.double.trace >$out/$name.double.steps
+    cut -d' ' -f2- $out/$name.single.trace >$out/$name.single.steps
+    if cmp -s $out/$name.double.steps $out/$name.single.steps; then
+        drift=$(paste -d' ' $out/$name.double.trace $out/$name.single.trace |
+                    awk '$1 != "#" { d = $1 - $(NF / 2 + 1); if (d < 0) d = -d; if (d > m) m = d } END { printf "%.3f", m }')
+        echo "$name: same steps, largest step time difference $drift us"
+    else
+        echo "$name: STEPS DIFFER, see $out/$name.*.steps"
+        status=1
+    fi
+done
+
+exit $status
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Checks that PLANNER_REVERSE_PASS_LIMIT costs no machine time on a deep buffer.
+#
+#   ./check_planner.sh [blocks [limit]]
+#
+# Builds the simulator with a BLOCKS deep planner buffer (default 300), with
+# and without a reverse pass limit of LIMIT blocks (default 4), and runs a
+# path of 20000 0.05mm segments through both. Fails if the limited build
+# takes more than 1% longer in machine time than the unlimited one, or if
+# fewer than 99% of the reverse passes it cut short were later completed.
+
+set -e
+cd "$(dirname "$0")"
+
+blocks=${1:-300}
+limit=${2:-4}
+
+# make does not rebuild when only CPPFLAGS change, so start both builds afresh.
+rm -rf build/planner-full build/planner-limit
+make -s BUILD=build/planner-full PROGRAM=build/grbl_sim_planner_full \
+    CPPFLAGS="-DBLOCK_BUFFER_SIZE=$blocks -DPLANNER_REVERSE_PASS_LIMIT=$blocks"
+make -s BUILD=build/planner-limit PROGRAM=build/grbl_sim_planner_limit \
+    CPPFLAGS="-DBLOCK_BUFFER_SIZE=$blocks -DPLANNER_REVERSE_PASS_LIMIT=$limit"
+
+out=build/check-planner
+mkdir -p $out
+awk 'BEGIN {
+    print "G21 G90 G94"
+    print "F3000"
+    for (i = 0; i <= 20000; i++) {
+        x = i * 0.05
+        printf "G1 X%.4f Y%.4f\n", x, 5 * sin(x / 4)
+    }
+}' >$out/wave.nc
+
+for variant in full limit; do
+    build/grbl_sim_planner_$variant -q $out/wave.nc 2>$out/$variant.stats
+    sed -n 's/^\[sim\] machine time \(.*\) s$/\1/p' $out/$variant.stats >$out/$variant.time
+    echo "$variant: machine time $(cat $out/$variant.time) s"
+done
+
+full=$(cat $out/full.time)
+limited=$(cat $out/limit.time)
+if awk -v f="$full" -v l="$limited" 'BEGIN { exit !(l > f * 1.01) }'; then
+    echo "reverse pass limit $limit: machine time $limited s, more than 1% over $full s"
+    exit 1
+fi
+echo "reverse pass limit $limit: machine time within 1% of the whole buffer"
+
+passes=$(sed -n 's/^\[sim\] planner recalculations [0-9]*, deferred \([0-9]*\), completed \([0-9]*\)$/\1 \2/p' $out/limit.stats)
+set -- $passes
+echo "reverse pass limit $limit: $1 passes deferred, $2 completed"
+if [ "$1" -eq 0 ] || [ $(($2 * 100)) -lt $(($1 * 99)) ]; then
+    echo "reverse pass limit $limit: deferred passes were not completed"
+    exit 1
+fi
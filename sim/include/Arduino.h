@@ -0,0 +1,110 @@
+#pragma once
+
+// Arduino-ESP32 core replacement for the host simulator. Only the parts of the
+// API that the Grbl sources use are provided, implemented in sim/SimHal.cpp.
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "binary.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "WString.h"
+#include "Print.h"
+#include "HardwareSerial.h"
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define NOP() sim_nop()
+
+#define bit(b) (1UL << (b))
+#define bitRead(value, b) (((value) >> (b)) & 0x01)
+
+#ifndef PI
+#    define PI 3.1415926535897932384626433832795
+#endif
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define radians(deg) ((deg)*DEG_TO_RAD)
+#define degrees(rad) ((rad)*RAD_TO_DEG)
+
+using std::isnan;
+using std::isinf;
+
+void sim_nop();
+
+unsigned long millis();
+unsigned long micros();
+void          delay(uint32_t ms);
+void          delayMicroseconds(uint32_t us);
+
+// As in the ESP32 core, these are the raw GPIO versions. Grbl's Pins.cpp
+// provides the public ones on top of them.
+extern "C" {
+void __pinMode(uint8_t pin, uint8_t mode);
+void __digitalWrite(uint8_t pin, uint8_t val);
+int  __digitalRead(uint8_t pin);
+}
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+double   ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits);
+void     ledcWrite(uint8_t channel, uint32_t duty);
+void     ledcAttachPin(uint8_t pin, uint8_t channel);
+void     ledcDetachPin(uint8_t pin);
+uint32_t ledcRead(uint8_t channel);
+
+template <class T, class L, class H>
+auto constrain(T amt, L low, H high) -> decltype(amt + low + high) {
+    return amt < low ? low : (amt > high ? high : amt);
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+class EspClass {
+public:
+    const char* getSdkVersion() { return "host-sim"; }
+    uint32_t    getFreeHeap() { return 200000; }
+    uint32_t    getHeapSize() { return 320000; }
+    uint8_t     getChipRevision() { return 1; }
+    uint32_t    getCpuFreqMHz() { return 240; }
+    uint32_t    getFlashChipSize() { return 4 * 1024 * 1024; }
+    uint32_t    getFlashChipSpeed() { return 80000000; }
+    uint64_t    getEfuseMac() { return 0; }
+    void        restart();
+};
+extern EspClass ESP;
+
+bool  psramFound();
+void* ps_malloc(size_t size);
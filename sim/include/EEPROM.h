@@ -0,0 +1,17 @@
+#pragma once
+
+// Arduino EEPROM emulation over a RAM array (sim/SimHal.cpp).
+
+#include <cstddef>
+#include <cstdint>
+
+class EEPROMClass {
+public:
+    bool     begin(size_t size);
+    uint8_t  read(int address);
+    void     write(int address, uint8_t value);
+    bool     commit() { return true; }
+    uint8_t* getDataPtr();
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,33 @@
+#pragma once
+
+// Filesystem types referenced by the SD card interface. The simulator has no
+// filesystem; SD support is compiled out.
+
+#include "Arduino.h"
+
+namespace fs {
+    class File {
+    public:
+        operator bool() const { return false; }
+        bool        available() { return false; }
+        int         read() { return -1; }
+        size_t      size() { return 0; }
+        size_t      position() { return 0; }
+        void        close() {}
+        const char* name() { return ""; }
+        bool        isDirectory() { return false; }
+        File        openNextFile() { return File(); }
+    };
+
+    class FS {
+    public:
+        File open(const char* path, const char* mode = "r") { return File(); }
+        bool exists(const char* path) { return false; }
+        bool remove(const char* path) { return false; }
+        bool mkdir(const char* path) { return false; }
+        bool rmdir(const char* path) { return false; }
+    };
+}
+
+using fs::File;
+using fs::FS;
@@ -0,0 +1,22 @@
+#pragma once
+
+// The simulator's UART. Output goes to stdout; input is injected by the simulator.
+
+#include "Print.h"
+
+class HardwareSerial : public Stream {
+public:
+    void   begin(unsigned long baud) {}
+    void   end() {}
+    size_t setRxBufferSize(size_t size) { return size; }
+    int    available() override;
+    int    availableForWrite() { return 0x7fff; }
+    int    read() override;
+    int    peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
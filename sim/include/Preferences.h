@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class Preferences {
+public:
+    bool    begin(const char* name, bool readOnly = false) { return true; }
+    void    end() {}
+    bool    clear() { return true; }
+    int8_t  getChar(const char* key, int8_t defaultValue = 0) { return defaultValue; }
+    size_t  putChar(const char* key, int8_t value) { return 1; }
+    int32_t getInt(const char* key, int32_t defaultValue = 0) { return defaultValue; }
+    size_t  putInt(const char* key, int32_t value) { return 4; }
+};
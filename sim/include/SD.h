@@ -0,0 +1,19 @@
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+    class SDFS : public FS {
+    public:
+        bool     begin(uint8_t ssPin = 5) { return false; }
+        void     end() {}
+        uint8_t  cardType() { return 0; }
+        uint64_t cardSize() { return 0; }
+        uint64_t totalBytes() { return 0; }
+        uint64_t usedBytes() { return 0; }
+    };
+}
+
+extern fs::SDFS SD;
+
+#define CARD_NONE 0
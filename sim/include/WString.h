@@ -0,0 +1,145 @@
+#pragma once
+
+// Minimal Arduino String for the host simulator, backed by std::string.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v, unsigned char base = 10) { fmt_int(v, base); }
+    String(unsigned int v, unsigned char base = 10) { fmt_int(v, base); }
+    String(long v, unsigned char base = 10) { fmt_int(v, base); }
+    String(unsigned long v, unsigned char base = 10) { fmt_int(v, base); }
+    String(float v, unsigned char decimals = 2) { fmt_float(v, decimals); }
+    String(double v, unsigned char decimals = 2) { fmt_float(v, decimals); }
+
+    const char*  c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.length(); }
+    bool         reserve(unsigned int size) {
+        _s.reserve(size);
+        return true;
+    }
+
+    char  charAt(unsigned int i) const { return i < _s.length() ? _s[i] : 0; }
+    char  operator[](unsigned int i) const { return charAt(i); }
+    char& operator[](unsigned int i) { return _s[i]; }
+
+    String& operator+=(const String& rhs) {
+        _s += rhs._s;
+        return *this;
+    }
+    String& operator+=(const char* rhs) {
+        _s += rhs;
+        return *this;
+    }
+    String& operator+=(char rhs) {
+        _s += rhs;
+        return *this;
+    }
+    String& operator+=(int rhs) { return *this += String(rhs); }
+    String& operator+=(unsigned int rhs) { return *this += String(rhs); }
+    String& operator+=(long rhs) { return *this += String(rhs); }
+    String& operator+=(unsigned long rhs) { return *this += String(rhs); }
+    String& operator+=(float rhs) { return *this += String(rhs); }
+    String& operator+=(double rhs) { return *this += String(rhs); }
+
+    bool concat(const String& s) {
+        _s += s._s;
+        return true;
+    }
+
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend String operator+(const String& a, const char* b) { return String(a._s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b._s); }
+    friend String operator+(const String& a, char b) { return String(a._s + b); }
+    friend String operator+(const String& a, int b) { return a + String(b); }
+    friend String operator+(const String& a, unsigned int b) { return a + String(b); }
+    friend String operator+(const String& a, long b) { return a + String(b); }
+    friend String operator+(const String& a, unsigned long b) { return a + String(b); }
+    friend String operator+(const String& a, float b) { return a + String(b); }
+    friend String operator+(const String& a, double b) { return a + String(b); }
+
+    bool operator==(const String& rhs) const { return _s == rhs._s; }
+    bool operator==(const char* rhs) const { return _s == rhs; }
+    bool operator!=(const String& rhs) const { return _s != rhs._s; }
+    bool operator!=(const char* rhs) const { return _s != rhs; }
+    bool equals(const String& rhs) const { return _s == rhs._s; }
+    bool equalsIgnoreCase(const String& rhs) const { return strcasecmp(c_str(), rhs.c_str()) == 0; }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        auto pos = _s.find(c, from);
+        return pos == std::string::npos ? -1 : int(pos);
+    }
+    int indexOf(const String& s, unsigned int from = 0) const {
+        auto pos = _s.find(s._s, from);
+        return pos == std::string::npos ? -1 : int(pos);
+    }
+    int lastIndexOf(char c) const {
+        auto pos = _s.rfind(c);
+        return pos == std::string::npos ? -1 : int(pos);
+    }
+    bool   startsWith(const String& s) const { return _s.compare(0, s._s.length(), s._s) == 0; }
+    bool   endsWith(const String& s) const {
+        return _s.length() >= s._s.length() && _s.compare(_s.length() - s._s.length(), s._s.length(), s._s) == 0;
+    }
+    String substring(unsigned int from) const { return from < _s.length() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        return from < _s.length() && to > from ? String(_s.substr(from, to - from)) : String();
+    }
+    void replace(const String& from, const String& to) {
+        if (from._s.empty()) {
+            return;
+        }
+        for (size_t pos = 0; (pos = _s.find(from._s, pos)) != std::string::npos; pos += to._s.length()) {
+            _s.replace(pos, from._s.length(), to._s);
+        }
+    }
+    void remove(unsigned int index) { remove(index, _s.length()); }
+    void remove(unsigned int index, unsigned int count) {
+        if (index < _s.length()) {
+            _s.erase(index, count);
+        }
+    }
+    void trim() {
+        auto b = _s.find_first_not_of(" \t\r\n");
+        auto e = _s.find_last_not_of(" \t\r\n");
+        _s     = b == std::string::npos ? std::string() : _s.substr(b, e - b + 1);
+    }
+    void toUpperCase() {
+        for (auto& c : _s) {
+            c = toupper(c);
+        }
+    }
+    void toLowerCase() {
+        for (auto& c : _s) {
+            c = tolower(c);
+        }
+    }
+    long  toInt() const { return atol(c_str()); }
+    float toFloat() const { return atof(c_str()); }
+
+private:
+    std::string _s;
+
+    void fmt_int(long v, unsigned char base) {
+        char buf[40];
+        if (base == 16) {
+            snprintf(buf, sizeof(buf), "%lx", v);
+        } else {
+            snprintf(buf, sizeof(buf), "%ld", v);
+        }
+        _s = buf;
+    }
+    void fmt_float(double v, unsigned char decimals) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        _s = buf;
+    }
+};
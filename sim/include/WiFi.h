@@ -0,0 +1,44 @@
+#pragma once
+
+// IPAddress, used by the IP address settings. The simulator has no network.
+
+#include "Arduino.h"
+
+class IPAddress {
+public:
+    IPAddress() : _addr(0) {}
+    IPAddress(uint32_t addr) : _addr(addr) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr(a | (b << 8) | (c << 16) | (uint32_t(d) << 24)) {}
+
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        _addr = a | (b << 8) | (c << 16) | (d << 24);
+        return true;
+    }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _addr & 0xff, (_addr >> 8) & 0xff, (_addr >> 16) & 0xff, _addr >> 24);
+        return String(buf);
+    }
+    operator uint32_t() const { return _addr; }
+
+private:
+    uint32_t _addr;
+};
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+class WiFiClass {
+public:
+    void        persistent(bool persistent) {}
+    bool        disconnect(bool wifioff = false) { return true; }
+    bool        enableSTA(bool enable) { return true; }
+    bool        enableAP(bool enable) { return true; }
+    bool        mode(wifi_mode_t mode) { return true; }
+    wifi_mode_t getMode() { return WIFI_OFF; }
+};
+
+extern WiFiClass WiFi;
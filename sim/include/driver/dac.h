@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+typedef enum { DAC_CHANNEL_1 = 1, DAC_CHANNEL_2 = 2 } dac_channel_t;
+
+inline esp_err_t dac_output_enable(dac_channel_t channel) { return ESP_OK; }
+inline esp_err_t dac_output_voltage(dac_channel_t channel, uint8_t value) { return ESP_OK; }
@@ -0,0 +1,38 @@
+#pragma once
+
+// RMT peripheral types. The simulator never selects RMT stepping.
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+typedef enum { RMT_CHANNEL_0 = 0, RMT_CHANNEL_MAX = 8 } rmt_channel_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef struct {
+    int           rmt_mode;
+    rmt_channel_t channel;
+    uint8_t       clk_div;
+    int           gpio_num;
+    uint8_t       mem_block_num;
+    struct {
+        bool     loop_en;
+        uint32_t carrier_freq_hz;
+        uint8_t  carrier_duty_percent;
+        int      carrier_level;
+        bool     carrier_en;
+        int      idle_level;
+        bool     idle_output_en;
+    } tx_config;
+} rmt_config_t;
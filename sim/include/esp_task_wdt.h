@@ -0,0 +1,11 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+extern "C" {
+inline esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t task) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t task) { return ESP_OK; }
+esp_err_t esp_task_wdt_reset();
+}
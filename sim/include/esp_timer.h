@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// Microseconds of simulated time since start.
+int64_t esp_timer_get_time();
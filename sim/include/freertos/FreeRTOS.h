@@ -0,0 +1,51 @@
+#pragma once
+
+// FreeRTOS replacement for the host simulator. The simulator is single
+// threaded: created tasks are recorded but never run, critical sections are
+// no-ops and delays advance simulated time.
+
+#include <cstdint>
+
+typedef int           BaseType_t;
+typedef unsigned int  UBaseType_t;
+typedef uint32_t      TickType_t;
+typedef void*         TaskHandle_t;
+typedef void*         QueueHandle_t;
+typedef void*         SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY (TickType_t)0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7fffffff
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED \
+    { 0, 0 }
+
+#define portENTER_CRITICAL(mux) vTaskEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vTaskExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vTaskEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vTaskExitCritical(mux)
+#define portYIELD_FROM_ISR()
+#define taskYIELD()
+
+inline void vTaskEnterCritical(portMUX_TYPE* mux) {}
+inline void vTaskExitCritical(portMUX_TYPE* mux) {}
+
+uint32_t xPortGetFreeHeapSize();
+int      xPortGetCoreID();
+
+// The simulated step ISR runs on the main thread, and the task notifications it sends are dropped.
+inline BaseType_t xPortInIsrContext() {
+    return pdFALSE;
+}
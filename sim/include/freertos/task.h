@@ -0,0 +1,28 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t      pvTaskCode,
+                                   const char*         pcName,
+                                   uint32_t            usStackDepth,
+                                   void*               pvParameters,
+                                   UBaseType_t         uxPriority,
+                                   TaskHandle_t* const pvCreatedTask,
+                                   BaseType_t          xCoreID);
+BaseType_t xTaskCreate(TaskFunction_t      pvTaskCode,
+                       const char*         pcName,
+                       uint32_t            usStackDepth,
+                       void*               pvParameters,
+                       UBaseType_t         uxPriority,
+                       TaskHandle_t* const pvCreatedTask);
+void       vTaskDelete(TaskHandle_t task);
+void       vTaskDelay(TickType_t ticks);
+void       vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TickType_t xTaskGetTickCountFromISR();
+UBaseType_t  uxTaskGetStackHighWaterMark(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void         vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority);
+uint32_t     ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t wait);
+BaseType_t   xTaskNotifyGive(TaskHandle_t task);
+void         vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken);
@@ -0,0 +1,34 @@
+#pragma once
+
+// Non-volatile storage backed by an in-memory map (sim/SimHal.cpp), so every
+// simulator run starts from the compiled-in defaults.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode;
+
+typedef struct {
+    size_t used_entries;
+    size_t free_entries;
+    size_t total_entries;
+    size_t namespace_count;
+} nvs_stats_t;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode open_mode, nvs_handle* out_handle);
+esp_err_t nvs_get_i8(nvs_handle handle, const char* key, int8_t* out_value);
+esp_err_t nvs_set_i8(nvs_handle handle, const char* key, int8_t value);
+esp_err_t nvs_get_i32(nvs_handle handle, const char* key, int32_t* out_value);
+esp_err_t nvs_set_i32(nvs_handle handle, const char* key, int32_t value);
+esp_err_t nvs_get_str(nvs_handle handle, const char* key, char* out_value, size_t* length);
+esp_err_t nvs_set_str(nvs_handle handle, const char* key, const char* value);
+esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* out_value, size_t* length);
+esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void* value, size_t length);
+esp_err_t nvs_erase_key(nvs_handle handle, const char* key);
+esp_err_t nvs_erase_all(nvs_handle handle);
+esp_err_t nvs_commit(nvs_handle handle);
+esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats);
+void      nvs_close(nvs_handle handle);
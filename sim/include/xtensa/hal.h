@@ -0,0 +1,5 @@
+#pragma once
+
+// CPU cycle counter. On the host it counts wall clock time at the rate of
+// ESP.getCpuFreqMHz(), so ISR timings are those of the host CPU.
+extern "C" unsigned xthal_get_ccount(void);